@@ -0,0 +1,301 @@
+// Bytes on the wire and handler time for loading the web UI: the
+// original handler (fread in 512-byte chunks, chunked text/html, no
+// caching) against the cached, pre-compressed asset path, including a
+// 304 revalidation.
+//
+// Before that, boot time and first byte in both web UI modes, each in a
+// fresh process: embedded (page in the app image, LittleFS mounted in
+// the background after boot) and LittleFS (mounted by a boot stage, page
+// read from it). The boot steps sleep for their typical on-chip times
+// (RC_SIM_BOOT_MS), so the ready times compare the two stage graphs.
+
+#include "bench_support.h"
+#include "test_support.h"
+
+#include "asset_cache.h"
+#include "boot.h"
+#include "esp_http_server.h"
+#include "esp_littlefs.h"
+#include "esp_timer.h"
+#include "udp_control.h"
+#include "wifi_config.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <sys/wait.h>
+
+// The handler as it was before the asset cache, reading the same file
+static esp_err_t legacy_file_handler(httpd_req_t *req)
+{
+    FILE *f = fopen(WEB_ROOT "/index.html", "r");
+    if (!f)
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+
+    httpd_resp_set_type(req, "text/html");
+    char buf[512];
+    size_t r;
+    while ((r = fread(buf, 1, sizeof(buf), f)) > 0)
+        httpd_resp_send_chunk(req, buf, r);
+
+    fclose(f);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+static uint16_t start_legacy_server(void)
+{
+    httpd_handle_t server;
+    httpd_config_t cfg = HTTPD_DEFAULT_CONFIG();
+    cfg.uri_match_fn = httpd_uri_match_wildcard;
+    httpd_start(&server, &cfg);
+
+    httpd_uri_t files{};
+    files.uri = "/*";
+    files.method = HTTP_GET;
+    files.handler = legacy_file_handler;
+    httpd_register_uri_handler(server, &files);
+    return host_httpd_port();
+}
+
+// Reads one response on a kept-alive connection; returns the bytes it
+// took on the wire (status line, headers and body) or 0 on error
+static size_t read_response(int fd, std::string *etag)
+{
+    std::string head;
+    char c;
+    while (head.find("\r\n\r\n") == std::string::npos && test_recv_all(fd, &c, 1, 2000))
+        head += c;
+    if (head.empty())
+        return 0;
+    size_t wire = head.size();
+
+    const char *e = strcasestr(head.c_str(), "ETag: ");
+    if (e && etag)
+        *etag = std::string(e + 6, strcspn(e + 6, "\r"));
+
+    static char body[65536];
+    if (strcasestr(head.c_str(), "Transfer-Encoding: chunked")) {
+        for (;;) {
+            std::string line;
+            while (line.find("\r\n") == std::string::npos && test_recv_all(fd, &c, 1, 2000))
+                line += c;
+            size_t size = strtoul(line.c_str(), NULL, 16);
+            wire += line.size();
+            if (!test_recv_all(fd, body, size + 2, 2000))
+                return 0;
+            wire += size + 2;
+            if (size == 0)
+                break;
+        }
+    } else {
+        const char *cl = strcasestr(head.c_str(), "Content-Length:");
+        size_t size = cl ? strtoul(cl + 15, NULL, 10) : 0;
+        if (size > sizeof(body) || (size && !test_recv_all(fd, body, size, 2000)))
+            return 0;
+        wire += size;
+    }
+    return wire;
+}
+
+/* =====================================================
+ *              BOOT, BOTH MODES
+ * ===================================================== */
+
+// The stages of main.cpp, which keeps its own static
+static void stage_nvs(void)
+{
+    nvs_flash_init();
+    app_config_init();
+}
+
+static void stage_fs(void)
+{
+    esp_vfs_littlefs_conf_t fs{};
+    fs.base_path = "/littlefs";
+    fs.partition_label = "littlefs";
+    esp_vfs_littlefs_register(&fs);
+}
+
+static bool mount_fs(void)
+{
+    stage_fs();
+    return true;
+}
+
+static void stage_motor(void)
+{
+    app_config_t cfg;
+    app_config_get(&cfg);
+    motor_init();
+    motor_control_start(cfg.control_rate_hz);
+    failsafe_init(cfg.failsafe_timeout_ms, cfg.failsafe_ramp_ms);
+}
+
+static void stage_wifi(void)
+{
+    wifi_init_softap();
+}
+
+static void stage_server(void)
+{
+    start_server();
+}
+
+// LittleFS mode in an embedded build: start_server() registered the
+// linked-in page, and a fresh cache drops it again before any request
+static void stage_server_fs(void)
+{
+    start_server();
+    asset_cache_init(WEB_ROOT, ASSET_CACHE_MAX_BYTES);
+}
+
+static void stage_udp(void)
+{
+    udp_control_start(UDP_CONTROL_PORT);
+}
+
+static const boot_stage_t embedded_stages[] = {
+    {"nvs", stage_nvs, 0},
+    {"motor", stage_motor, BOOT_DEP(0)},
+    {"wifi", stage_wifi, BOOT_DEP(0)},
+    {"server", stage_server, BOOT_DEP(1) | BOOT_DEP(2)},
+    {"udp", stage_udp, BOOT_DEP(1) | BOOT_DEP(2)},
+};
+
+static const boot_stage_t littlefs_stages[] = {
+    {"nvs", stage_nvs, 0},
+    {"fs", stage_fs, 0},
+    {"motor", stage_motor, BOOT_DEP(0)},
+    {"wifi", stage_wifi, BOOT_DEP(0)},
+    {"server", stage_server_fs, BOOT_DEP(1) | BOOT_DEP(2) | BOOT_DEP(3)},
+    {"udp", stage_udp, BOOT_DEP(2) | BOOT_DEP(3)},
+};
+
+// Microseconds from sending GET / until the first response byte
+static double first_byte_us(uint16_t port)
+{
+    static const char req[] = "GET / HTTP/1.1\r\nHost: localhost\r\nAccept-Encoding: gzip\r\n\r\n";
+    int fd = test_connect(port);
+    auto t0 = std::chrono::steady_clock::now();
+    test_send_all(fd, req, sizeof(req) - 1);
+    struct pollfd p = {fd, POLLIN, 0};
+    poll(&p, 1, 2000);
+    auto t1 = std::chrono::steady_clock::now();
+    read_response(fd, NULL);
+    close(fd);
+    return std::chrono::duration<double, std::micro>(t1 - t0).count();
+}
+
+// Boots one mode and prints its line; runs in a child process
+static void run_boot(const char *name, const boot_stage_t *stages, size_t n, bool embedded)
+{
+    int64_t start = esp_timer_get_time();
+    boot_run(stages, n);
+    double ready_ms = (boot_ready_us() - (uint32_t)start) / 1000.0;
+    if (embedded)
+        asset_cache_mount_async(mount_fs);
+    int64_t booted = esp_timer_get_time();
+    uint16_t port = host_httpd_port();
+
+    // A file only LittleFS has: in embedded mode, once the mount is done.
+    // The gzip page is a separate entry, so its first byte stays cold
+    test_wait_until([&] {
+        return test_http(port, "GET", "/index.html", "", NULL) == 200;
+    }, 5000);
+    double fs_ms = (esp_timer_get_time() - booted) / 1000.0;
+
+    double cold = first_byte_us(port);
+    std::vector<double> warm;
+    for (int i = 0; i < 51; i++)
+        warm.push_back(first_byte_us(port));
+    std::sort(warm.begin(), warm.end());
+
+    printf("%-10s ready %6.1f ms  first byte cold %6.3f ms, warm %6.3f ms  "
+           "LittleFS file after %6.1f ms\n",
+           name, ready_ms, cold / 1000, warm[warm.size() / 2] / 1000, fs_ms);
+}
+
+// Each mode needs its own boot, so it runs in a child forked before
+// this process starts any thread
+static void boot_mode(const char *name, const boot_stage_t *stages, size_t n, bool embedded)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        run_boot(name, stages, n, embedded);
+        bench_exit();
+    }
+    waitpid(pid, NULL, 0);
+}
+
+/* =====================================================
+ *              GET /, LEGACY AND CACHED
+ * ===================================================== */
+
+static void run_case(const char *name, uint16_t port, const char *headers, int n)
+{
+    int fd = test_connect(port);
+    char req[256];
+    int len = snprintf(req, sizeof(req), "GET / HTTP/1.1\r\nHost: localhost\r\n%s\r\n", headers);
+
+    uint32_t calls0, calls1;
+    uint64_t ns0, ns1;
+    size_t wire = 0;
+
+    host_httpd_handler_stats(&calls0, &ns0);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        test_send_all(fd, req, (size_t)len);
+        wire = read_response(fd, NULL);
+        if (!wire)
+            break;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    test_wait_until([&] {
+        host_httpd_handler_stats(&calls1, &ns1);
+        return calls1 - calls0 >= (uint32_t)n;
+    }, 1000);
+    close(fd);
+
+    double rtt = std::chrono::duration<double, std::micro>(t1 - t0).count() / n;
+    double handler = (double)(ns1 - ns0) / 1000.0 / (calls1 - calls0);
+    printf("%-26s %7zu bytes  handler %7.1f us  round trip %7.1f us\n",
+           name, wire, handler, rtt);
+}
+
+int main(void)
+{
+    setenv("RC_SIM_PORT", "0", 1);
+    setenv("RC_SIM_LOG_LEVEL", "1", 0);
+    setenv("RC_SIM_BOOT_MS", "typical", 0);
+
+    bench_header("boot and GET / first byte (gzip), typical on-chip boot steps");
+#if WEB_UI_EMBEDDED
+    boot_mode("embedded", embedded_stages, sizeof(embedded_stages) / sizeof(embedded_stages[0]), true);
+#else
+    printf("embedded   not built (-DRC_EMBED_WEB_UI=OFF)\n");
+#endif
+    boot_mode("LittleFS", littlefs_stages, sizeof(littlefs_stages) / sizeof(littlefs_stages[0]), false);
+
+    const int n = 500;
+
+    uint16_t legacy = start_legacy_server();
+    uint16_t port = test_start_server();
+
+    // The ETag the browser would hold after its first load
+    std::string etag;
+    int fd = test_connect(port);
+    static const char first[] = "GET / HTTP/1.1\r\nHost: localhost\r\nAccept-Encoding: gzip\r\n\r\n";
+    test_send_all(fd, first, sizeof(first) - 1);
+    read_response(fd, &etag);
+    close(fd);
+    std::string inm = "Accept-Encoding: gzip\r\nIf-None-Match: " + etag + "\r\n";
+
+    bench_header("GET / (web UI), loopback, keep-alive");
+    run_case("legacy fread/chunked", legacy, "", n);
+    run_case("cached identity", port, "", n);
+    run_case("cached gzip", port, "Accept-Encoding: gzip, deflate, br\r\n", n);
+    run_case("revalidate (304)", port, inm.c_str(), n);
+    bench_exit();
+}
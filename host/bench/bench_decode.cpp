@@ -0,0 +1,123 @@
+// Per-frame decode cost of one drive command in each wire format:
+// the 8-byte binary frame, the specialised JSON parser, and the original
+// heap path (malloc'd copy, cJSON_Parse, lookups, cJSON_Delete). Then the
+// two JSON paths over the captured UI frames in tests/json_frames.h.
+
+#include "bench_support.h"
+
+#include "control_protocol.h"
+#include "cJSON.h"
+#include "json_frames.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t heap_allocs = 0;
+
+static void *counting_malloc(size_t size)
+{
+    heap_allocs++;
+    return malloc(size);
+}
+
+static const char drive_json[] = "{\"cmd\":\"drive\",\"speed\":0.75,\"steer\":-0.25,\"seq\":1234}";
+
+static double number_or_zero(cJSON *root, const char *key)
+{
+    cJSON *item = cJSON_GetObjectItem(root, key);
+    return cJSON_IsNumber(item) ? item->valuedouble : 0;
+}
+
+// The handler before the binary protocol: copy, parse, look up, free
+static bool decode_cjson_heap(const char *buf, size_t len, ctrl_command_t *out)
+{
+    char *copy = (char *)malloc(len + 1);
+    heap_allocs++;
+    memcpy(copy, buf, len);
+    copy[len] = 0;
+
+    cJSON *root = cJSON_Parse(copy);
+    bool ok = root != NULL;
+    if (ok) {
+        cJSON *cmd = cJSON_GetObjectItem(root, "cmd");
+        out->cmd = cJSON_IsString(cmd) && !strcmp(cmd->valuestring, "drive") ?
+                   CTRL_CMD_DRIVE : CTRL_CMD_UNKNOWN;
+        out->speed = number_or_zero(root, "speed");
+        out->steer = number_or_zero(root, "steer");
+        out->seq = number_or_zero(root, "seq");
+        cJSON_Delete(root);
+    }
+    free(copy);
+    return ok;
+}
+
+int main(void)
+{
+    cJSON_Hooks hooks = {counting_malloc, free};
+    cJSON_InitHooks(&hooks);
+
+    const uint32_t iters = 2000000;
+    uint8_t frame[CTRL_FRAME_SIZE];
+    ctrl_frame_t in = {CTRL_PROTO_VERSION, 0, 24575, -8192, 1234};
+    ctrl_encode_binary(&in, frame);
+
+    bench_header("decode one drive command");
+
+    double bin = bench_ns_per_op([&](uint32_t i) {
+        ctrl_frame_t cf;
+        frame[6] = (uint8_t)i;
+        bench_keep(ctrl_decode_binary(frame, sizeof(frame), &cf));
+        bench_keep(cf);
+    }, iters);
+
+    double fast = bench_ns_per_op([&](uint32_t) {
+        ctrl_command_t c;
+        bench_keep(ctrl_parse_json(drive_json, sizeof(drive_json) - 1, &c));
+        bench_keep(c);
+    }, iters);
+
+    heap_allocs = 0;
+    double heap = bench_ns_per_op([&](uint32_t) {
+        ctrl_command_t c;
+        bench_keep(decode_cjson_heap(drive_json, sizeof(drive_json) - 1, &c));
+        bench_keep(c);
+    }, iters / 10);
+    // Warm-up is iters/100 + 1 calls, then three timed runs
+    double allocs = (double)heap_allocs / (iters / 100 + 1 + 3 * (iters / 10));
+
+    char label[40];
+    snprintf(label, sizeof(label), "binary (%u bytes)", CTRL_FRAME_SIZE);
+    printf("%-30s %8.1f ns/frame  0 allocs\n", label, bin);
+    snprintf(label, sizeof(label), "json specialised (%zu bytes)", sizeof(drive_json) - 1);
+    printf("%-30s %8.1f ns/frame  0 allocs\n", label, fast);
+    snprintf(label, sizeof(label), "json cJSON heap (%zu bytes)", sizeof(drive_json) - 1);
+    printf("%-30s %8.1f ns/frame  %.1f allocs\n", label, heap, allocs);
+
+    size_t lens[CAPTURED_FRAME_COUNT];
+    for (size_t i = 0; i < CAPTURED_FRAME_COUNT; i++)
+        lens[i] = strlen(captured_frames[i]);
+
+    // Every captured frame takes the fast path (test_json_parser checks)
+    bench_header("captured UI frames, round robin");
+
+    double corpus_fast = bench_ns_per_op([&](uint32_t i) {
+        ctrl_command_t c;
+        size_t k = i % CAPTURED_FRAME_COUNT;
+        bench_keep(ctrl_parse_json(captured_frames[k], lens[k], &c));
+        bench_keep(c);
+    }, iters);
+
+    heap_allocs = 0;
+    double corpus_heap = bench_ns_per_op([&](uint32_t i) {
+        ctrl_command_t c;
+        size_t k = i % CAPTURED_FRAME_COUNT;
+        bench_keep(decode_cjson_heap(captured_frames[k], lens[k], &c));
+        bench_keep(c);
+    }, iters / 10);
+    allocs = (double)heap_allocs / (iters / 100 + 1 + 3 * (iters / 10));
+
+    snprintf(label, sizeof(label), "json specialised (%zu frames)", CAPTURED_FRAME_COUNT);
+    printf("%-30s %8.1f ns/frame  0 allocs\n", label, corpus_fast);
+    printf("%-30s %8.1f ns/frame  %.1f allocs\n", "json cJSON heap", corpus_heap, allocs);
+    return 0;
+}
@@ -0,0 +1,120 @@
+// Cost of computing the direction pin masks for one control tick: the
+// tables motor_init() precomputes (dir_table and wheel_pins, two lookups
+// and four ANDs), against building the same masks from the pin map on
+// every call (a loop over the wheels with per-pin shifts).
+//
+// Pure computation on the chassis' default pins, no HAL calls: the
+// register writes that follow are the same either way.
+
+#include "bench_support.h"
+
+#include "drivetrain.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define UPDATES 4096
+#define COMBOS (1 << DRIVETRAIN_WHEELS)
+
+struct masks_t {
+    uint32_t set[2];
+    uint32_t clr[2];
+};
+
+static masks_t dir_table[COMBOS];
+static uint32_t wheel_pins[COMBOS][2];
+
+static void mask_add(uint32_t bank[2], int pin)
+{
+    bank[pin >> 5] |= 1u << (pin & 31);
+}
+
+static void build_tables(void)
+{
+    for (int d = 0; d < COMBOS; d++) {
+        for (size_t i = 0; i < DRIVETRAIN_WHEELS; i++) {
+            const wheel_desc_t &w = drivetrain.wheels[i];
+            bool high1 = (bool)(d & (1 << i)) != w.inverted;
+            mask_add(dir_table[d].set, high1 ? w.in1 : w.in2);
+            mask_add(dir_table[d].clr, high1 ? w.in2 : w.in1);
+            if (d & (1 << i)) {
+                mask_add(wheel_pins[d], w.in1);
+                mask_add(wheel_pins[d], w.in2);
+            }
+        }
+    }
+}
+
+// What write_dir_pins() does before its register writes
+static masks_t lookup(unsigned dirs, unsigned flips)
+{
+    const masks_t *m = &dir_table[dirs];
+    const uint32_t *sel = wheel_pins[flips];
+    masks_t out;
+    out.clr[0] = m->clr[0] & sel[0];
+    out.clr[1] = m->clr[1] & sel[1];
+    out.set[0] = m->set[0] & sel[0];
+    out.set[1] = m->set[1] & sel[1];
+    return out;
+}
+
+// The same masks, walked from the pin map each time
+static masks_t per_call(unsigned dirs, unsigned flips)
+{
+    masks_t out;
+    memset(&out, 0, sizeof(out));
+    for (size_t i = 0; i < DRIVETRAIN_WHEELS; i++) {
+        if (!(flips & (1u << i)))
+            continue;
+        const wheel_desc_t &w = drivetrain.wheels[i];
+        bool high1 = (bool)(dirs & (1u << i)) != w.inverted;
+        mask_add(out.set, high1 ? w.in1 : w.in2);
+        mask_add(out.clr, high1 ? w.in2 : w.in1);
+    }
+    return out;
+}
+
+static uint32_t fold(const masks_t &m)
+{
+    return m.set[0] ^ m.set[1] ^ m.clr[0] ^ m.clr[1];
+}
+
+int main(void)
+{
+    build_tables();
+
+    // Random direction and flip bitmaps, so neither path sees one pattern
+    static unsigned dirs[UPDATES], flips[UPDATES];
+    srand(11);
+    for (int i = 0; i < UPDATES; i++) {
+        dirs[i] = (unsigned)rand() % COMBOS;
+        flips[i] = (unsigned)rand() % COMBOS;
+    }
+
+    // Both paths must agree before their timings mean anything
+    for (int i = 0; i < UPDATES; i++) {
+        masks_t a = lookup(dirs[i], flips[i]);
+        masks_t b = per_call(dirs[i], flips[i]);
+        if (memcmp(&a, &b, sizeof(a)) != 0) {
+            fprintf(stderr, "mask mismatch at dirs %u flips %u\n", dirs[i], flips[i]);
+            return 1;
+        }
+    }
+
+    bench_header("direction mask computation per control tick");
+    printf("chassis %s, %u wheels, %u table entries (%zu bytes)\n",
+           drivetrain.name, (unsigned)DRIVETRAIN_WHEELS, (unsigned)COMBOS,
+           sizeof(dir_table) + sizeof(wheel_pins));
+
+    const uint32_t iters = 10000000;
+    double table = bench_ns_per_op([&](uint32_t i) {
+        bench_keep(fold(lookup(dirs[i % UPDATES], flips[i % UPDATES])));
+    }, iters);
+    double loop = bench_ns_per_op([&](uint32_t i) {
+        bench_keep(fold(per_call(dirs[i % UPDATES], flips[i % UPDATES])));
+    }, iters);
+
+    printf("precomputed tables: %6.2f ns/op\n", table);
+    printf("per-call pin walk:  %6.2f ns/op\n", loop);
+    bench_exit();
+}
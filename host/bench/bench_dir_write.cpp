@@ -0,0 +1,147 @@
+// Cost of one direction update on the H-bridge inputs: the original two
+// gpio_set_level() calls per wheel on every apply, against the batched
+// write of the wheels that flip through the W1TC/W1TS registers.
+//
+// Both variants drive the same pins (the chassis' default pin map)
+// through the host HAL, so the ns/op compare call overhead only. The
+// count of HAL writes per update is exact, and it is what carries over
+// to the chip: each gpio_set_level() is a checked driver call, each
+// register write a single store.
+
+#include "bench_support.h"
+
+#include "drivetrain.h"
+#include "driver/gpio.h"
+#include "host_hal.h"
+#include "soc/gpio_reg.h"
+#include "soc/soc.h"
+
+#include <string.h>
+
+#define UPDATES 4096
+#define COMBOS (1 << DRIVETRAIN_WHEELS)
+
+// The masks motor_init() builds, from the default pins
+struct masks_t {
+    uint32_t set[2];
+    uint32_t clr[2];
+};
+
+static masks_t dir_table[COMBOS];
+static uint32_t wheel_pins[COMBOS][2];
+
+static void mask_add(uint32_t bank[2], int pin)
+{
+    bank[pin >> 5] |= 1u << (pin & 31);
+}
+
+static void build_tables(void)
+{
+    for (int d = 0; d < COMBOS; d++) {
+        for (size_t i = 0; i < DRIVETRAIN_WHEELS; i++) {
+            const wheel_desc_t &w = drivetrain.wheels[i];
+            bool high1 = (bool)(d & (1 << i)) != w.inverted;
+            mask_add(dir_table[d].set, high1 ? w.in1 : w.in2);
+            mask_add(dir_table[d].clr, high1 ? w.in2 : w.in1);
+            if (d & (1 << i)) {
+                mask_add(wheel_pins[d], w.in1);
+                mask_add(wheel_pins[d], w.in2);
+            }
+        }
+    }
+}
+
+// Before: every apply set both inputs of every wheel
+static void legacy_write(unsigned dirs)
+{
+    for (size_t i = 0; i < DRIVETRAIN_WHEELS; i++) {
+        const wheel_desc_t &w = drivetrain.wheels[i];
+        bool high1 = (bool)(dirs & (1u << i)) != w.inverted;
+        gpio_set_level((gpio_num_t)w.in1, high1);
+        gpio_set_level((gpio_num_t)w.in2, !high1);
+    }
+}
+
+// After: only the wheels that flip, lows before highs
+static void batched_write(unsigned dirs, unsigned flips)
+{
+    const masks_t *m = &dir_table[dirs];
+    const uint32_t *sel = wheel_pins[flips];
+    uint32_t clr0 = m->clr[0] & sel[0], clr1 = m->clr[1] & sel[1];
+    uint32_t set0 = m->set[0] & sel[0], set1 = m->set[1] & sel[1];
+    if (clr0)
+        REG_WRITE(GPIO_OUT_W1TC_REG, clr0);
+    if (clr1)
+        REG_WRITE(GPIO_OUT1_W1TC_REG, clr1);
+    if (set0)
+        REG_WRITE(GPIO_OUT_W1TS_REG, set0);
+    if (set1)
+        REG_WRITE(GPIO_OUT1_W1TS_REG, set1);
+}
+
+static uint32_t writes;
+
+static void count_gpio(int gpio, uint32_t level, void *arg)
+{
+    writes++;
+}
+
+static void count_reg(uint32_t reg, uint32_t val, void *arg)
+{
+    writes++;
+}
+
+int main(void)
+{
+    build_tables();
+
+    // A drive session: mostly steady, a direction change every few ticks
+    static unsigned seq[UPDATES];
+    unsigned dirs = COMBOS - 1;
+    srand(7);
+    for (int i = 0; i < UPDATES; i++) {
+        if (rand() % 4 == 0)
+            dirs = (unsigned)rand() % COMBOS;
+        seq[i] = dirs;
+    }
+
+    unsigned changes = 0;
+    for (int i = 1; i < UPDATES; i++)
+        changes += seq[i] != seq[i - 1];
+
+    // Register writes also notify the GPIO observer per changed pin, so
+    // each variant counts only its own kind of write
+    host_hal_set_gpio_observer(count_gpio, NULL);
+    writes = 0;
+    for (int i = 0; i < UPDATES; i++)
+        legacy_write(seq[i]);
+    uint32_t legacy_writes = writes;
+    host_hal_set_gpio_observer(NULL, NULL);
+
+    host_hal_set_reg_observer(count_reg, NULL);
+    writes = 0;
+    for (int i = 1; i < UPDATES; i++)
+        batched_write(seq[i], seq[i] ^ seq[i - 1]);
+    uint32_t batched_writes = writes;
+    host_hal_set_reg_observer(NULL, NULL);
+
+    bench_header("direction pin update per control tick");
+    printf("chassis %s, %u updates, %u direction changes\n",
+           drivetrain.name, UPDATES, changes);
+
+    const uint32_t iters = 1000000;
+    double legacy = bench_ns_per_op([&](uint32_t i) {
+        legacy_write(seq[i % UPDATES]);
+    }, iters);
+    double batched = bench_ns_per_op([&](uint32_t i) {
+        uint32_t k = i % (UPDATES - 1) + 1;
+        batched_write(seq[k], seq[k] ^ seq[k - 1]);
+    }, iters);
+
+    printf("gpio_set_level x%u: %6.1f ns/op  %5.2f writes/update\n",
+           (unsigned)(2 * DRIVETRAIN_WHEELS), legacy, (double)legacy_writes / UPDATES);
+    printf("batched W1TC/W1TS: %6.1f ns/op  %5.2f writes/update  %5.2f writes/change\n",
+           batched, (double)batched_writes / (UPDATES - 1),
+           changes ? (double)batched_writes / changes : 0.0);
+    bench_exit();
+}
@@ -0,0 +1,71 @@
+// Per-update cost of turning one speed/steer setpoint into four wheel
+// duties: the original integer path (11 speed steps, 8-bit duty, integer
+// steering) against the Q15 mixer and duty table.
+
+#include "bench_support.h"
+
+#include "app_config.h"
+#include "drive_mixer.h"
+#include "motor_control.h"
+#include "nvs_flash.h"
+
+#include <stdlib.h>
+
+// apply_drive() before the Q15 domain, without the GPIO/LEDC writes
+static void legacy_duties(int speed, int steer, int duty[4])
+{
+    int s = abs(speed);
+    if (s > 10) s = 10;
+    int base = (s * 255) / 10;
+
+    if (steer > 10) steer = 10;
+    if (steer < -10) steer = -10;
+    int diff = (abs(steer) * base) / 10;
+
+    duty[0] = duty[1] = duty[2] = duty[3] = base;
+    if (steer < 0) {
+        duty[0] -= diff;
+        duty[1] -= diff;
+    } else if (steer > 0) {
+        duty[2] -= diff;
+        duty[3] -= diff;
+    }
+}
+
+static void q15_duties(int speed, int steer, uint32_t duty[4])
+{
+    q15_t out[4];
+    drive_mixer_mix(DRIVE_MIXER_DIFFERENTIAL, speed, steer, out);
+    for (int i = 0; i < 4; i++)
+        duty[i] = motor_duty_for((q15_t)abs(out[i]), NULL);
+}
+
+int main(void)
+{
+    nvs_flash_init();
+    app_config_init();
+    motor_init();
+
+    uint32_t max_duty;
+    motor_duty_for(0, &max_duty);
+
+    const uint32_t iters = 5000000;
+    bench_header("speed/steer setpoint to four wheel duties");
+
+    double legacy = bench_ns_per_op([](uint32_t i) {
+        int duty[4];
+        legacy_duties((int)(i % 21) - 10, (int)(i % 17) - 8, duty);
+        bench_keep(duty);
+    }, iters);
+
+    double q15 = bench_ns_per_op([](uint32_t i) {
+        uint32_t duty[4];
+        q15_duties((int)(i * 7919 % 65535) - Q15_ONE, (int)(i * 104729 % 65535) - Q15_ONE, duty);
+        bench_keep(duty);
+    }, iters);
+
+    printf("%-30s %8.1f ns/update  11 speed levels, duty 0..255\n", "integer (legacy)", legacy);
+    printf("%-30s %8.1f ns/update  Q15 input, duty 0..%u\n", "q15 mixer + duty table", q15,
+           (unsigned)max_duty);
+    bench_exit();
+}
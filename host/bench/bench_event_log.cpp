@@ -0,0 +1,95 @@
+// Per-event cost of the binary event log against a formatted ESP_LOGI
+// line, for the APPLY event the control task used to print on every
+// command. The ESP_LOGI side writes to /dev/null here; on the car the
+// same line goes to a 115200 baud UART, whose time is shown alongside.
+
+#include "bench_support.h"
+
+#include "esp_log.h"
+#include "event_log.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+static const char *TAG = "motor_ctrl";
+
+#define UART_BAUD 115200
+
+// Same work from several threads at once: ns per call, all threads together
+template <typename Fn>
+static double contended_ns(Fn fn, int threads, uint32_t iters)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++)
+        pool.emplace_back([&] {
+            for (uint32_t i = 0; i < iters; i++)
+                fn(i);
+        });
+    for (auto &th : pool)
+        th.join();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / (threads * iters);
+}
+
+int main(void)
+{
+    setenv("RC_SIM_LOG_LEVEL", "3", 1);     // ESP_LOGI enabled
+
+    const uint32_t iters = 1000000;
+    int null_fd = open("/dev/null", O_WRONLY);
+    int saved_stderr = dup(2);
+
+    bench_header("one APPLY event (four signed duties)");
+
+    double ring = bench_ns_per_op([](uint32_t i) {
+        EVLOG_I(EVT_MOTOR_APPLY, i, -(int)i, 4095, -4095);
+    }, iters);
+
+    // Below EVLOG_LEVEL the macro expands to an empty statement
+    double debug = bench_ns_per_op([](uint32_t i) {
+        EVLOG_D(EVT_MOTOR_APPLY, i, 0, 0, 0);
+        bench_keep(i);
+    }, iters);
+
+    dup2(null_fd, 2);
+    double logi = bench_ns_per_op([](uint32_t i) {
+        ESP_LOGI(TAG, "APPLY duty LF=%d LB=%d RF=%d RB=%d", (int)i, -(int)i, 4095, -4095);
+    }, iters);
+    dup2(saved_stderr, 2);
+
+    // What the drain task (or GET /log) pays later, off the hot path
+    evlog_event_t e;
+    event_log_read(event_log_head() - 1, &e);
+    char line[128];
+    int line_len = event_log_format(&e, line, sizeof(line));
+    double format = bench_ns_per_op([&](uint32_t) {
+        bench_keep(event_log_format(&e, line, sizeof(line)));
+    }, iters);
+
+    // 4 writers: the ring takes a slot with one atomic add; the log
+    // serialises on its lock
+    double ring4 = contended_ns([](uint32_t i) {
+        EVLOG_I(EVT_MOTOR_APPLY, i, 0, 0, 0);
+    }, 4, iters);
+    dup2(null_fd, 2);
+    double logi4 = contended_ns([](uint32_t i) {
+        ESP_LOGI(TAG, "APPLY duty LF=%d LB=%d RF=%d RB=%d", (int)i, 0, 0, 0);
+    }, 4, iters / 4);
+    dup2(saved_stderr, 2);
+
+    double uart_us = (line_len + 1) * 10 * 1e6 / UART_BAUD;
+
+    printf("%-32s %8.1f ns/event\n", "EVLOG_I (ring write)", ring);
+    printf("%-32s %8.1f ns/event\n", "ESP_LOGI (to /dev/null)", logi);
+    printf("%-32s %8.1f ns/event  (%d-byte line)\n", "event_log_format (deferred)", format,
+           line_len);
+    printf("%-32s %8.1f ns/event\n", "EVLOG_I, 4 threads", ring4);
+    printf("%-32s %8.1f ns/event\n", "ESP_LOGI, 4 threads", logi4);
+    printf("%-32s %8.0f us/event  (UART at %d baud)\n", "ESP_LOGI on the car", uart_us,
+           UART_BAUD);
+    printf("%-32s %8.1f ns/event  (compiled out)\n", "EVLOG_D at EVLOG_LEVEL_INFO", debug);
+    bench_exit();
+}
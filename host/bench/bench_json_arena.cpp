@@ -0,0 +1,232 @@
+// Heap cost of parsing JSON control frames with cJSON: the original
+// per-frame malloc path against the JSON arena.
+//
+// glibc's heap hides fragmentation behind its bins, so both paths run on
+// a small first-fit heap shaped like the ESP32's (one region, boundary
+// tags, coalescing on free). Between frames another task keeps a ring of
+// long-lived allocations going, allocating while a frame's tree is still
+// live, which is what strands free space between cJSON's short-lived
+// nodes on the car. Timings include the model heap's list walks, so only
+// the ratio between the two paths means anything.
+
+#include "bench_support.h"
+
+#include "json_arena.h"
+
+extern "C" {
+#include "cJSON.h"
+}
+
+#include <stdlib.h>
+#include <string.h>
+
+/* =====================================================
+ *              MODEL HEAP
+ * ===================================================== */
+
+#define HEAP_SIZE (48 * 1024)
+#define HEAP_ALIGN 8
+
+typedef struct block {
+    size_t size;            // payload bytes, multiple of HEAP_ALIGN
+    bool used;
+    struct block *next;     // address order
+} block_t;
+
+#define HDR ((sizeof(block_t) + HEAP_ALIGN - 1) & ~(size_t)(HEAP_ALIGN - 1))
+
+alignas(HEAP_ALIGN) static uint8_t heap_mem[HEAP_SIZE];
+static block_t *heap_head;
+static uint32_t heap_allocs;
+static uint32_t heap_failures;
+
+static void heap_reset(void)
+{
+    heap_head = (block_t *)heap_mem;
+    heap_head->size = HEAP_SIZE - HDR;
+    heap_head->used = false;
+    heap_head->next = NULL;
+    heap_allocs = heap_failures = 0;
+}
+
+static void *heap_malloc(size_t size)
+{
+    size = (size + HEAP_ALIGN - 1) & ~(size_t)(HEAP_ALIGN - 1);
+    for (block_t *b = heap_head; b; b = b->next) {
+        if (b->used || b->size < size)
+            continue;
+        if (b->size >= size + HDR + HEAP_ALIGN) {
+            block_t *rest = (block_t *)((uint8_t *)b + HDR + size);
+            rest->size = b->size - size - HDR;
+            rest->used = false;
+            rest->next = b->next;
+            b->next = rest;
+            b->size = size;
+        }
+        b->used = true;
+        heap_allocs++;
+        return (uint8_t *)b + HDR;
+    }
+    heap_failures++;
+    return NULL;
+}
+
+static void heap_free(void *p)
+{
+    if (!p)
+        return;
+    block_t *b = (block_t *)((uint8_t *)p - HDR);
+    b->used = false;
+    // Coalesce the whole list; the heap is small enough
+    for (block_t *c = heap_head; c; c = c->next) {
+        while (!c->used && c->next && !c->next->used) {
+            c->size += HDR + c->next->size;
+            c->next = c->next->next;
+        }
+    }
+}
+
+static void heap_report(size_t *free_bytes, size_t *largest)
+{
+    *free_bytes = *largest = 0;
+    for (block_t *b = heap_head; b; b = b->next) {
+        if (b->used)
+            continue;
+        *free_bytes += b->size;
+        if (b->size > *largest)
+            *largest = b->size;
+    }
+}
+
+/* =====================================================
+ *              WORKLOAD
+ * ===================================================== */
+
+static const char *const frames[] = {
+    "{\"cmd\":\"drive\",\"speed\":0.75,\"steer\":-0.25,\"seq\":1234}",
+    "{\"cmd\":\"move\",\"dir\":\"stop\"}",
+    "{\"cmd\":\"set\",\"value\":7}",
+    "{\"cmd\":\"drive\",\"speed\":-3.5,\"steer\":10,\"seq\":65535,\"extra\":[1,2,3]}",
+};
+#define FRAME_COUNT (sizeof(frames) / sizeof(frames[0]))
+
+// Long-lived allocations of the rest of the firmware: a ring of blocks,
+// one replaced every few frames while a frame is being parsed
+#define RING 24
+static void *ring[RING];
+static uint32_t ring_next;
+
+static void other_task_step(uint32_t i)
+{
+    if (i % 3)
+        return;
+    uint32_t slot = ring_next++ % RING;
+    heap_free(ring[slot]);
+    ring[slot] = heap_malloc(48 + (i * 37) % 200);
+}
+
+static double parse_field(cJSON *root)
+{
+    cJSON *speed = cJSON_GetObjectItem(root, "speed");
+    return cJSON_IsNumber(speed) ? speed->valuedouble : 0;
+}
+
+// The handler before the arena: copy the frame, parse, delete
+static void frame_heap(uint32_t i)
+{
+    const char *f = frames[i % FRAME_COUNT];
+    size_t len = strlen(f);
+    char *copy = (char *)heap_malloc(len + 1);
+    if (!copy)
+        return;
+    memcpy(copy, f, len + 1);
+    cJSON *root = cJSON_Parse(copy);
+    other_task_step(i);
+    if (root)
+        bench_keep(parse_field(root));
+    cJSON_Delete(root);
+    heap_free(copy);
+}
+
+// parse_cjson() in web_server.cpp: the tree lives in the arena
+static void frame_arena(uint32_t i)
+{
+    const char *f = frames[i % FRAME_COUNT];
+    json_arena_begin();
+    cJSON *root = cJSON_Parse(f);
+    other_task_step(i);
+    if (root)
+        bench_keep(parse_field(root));
+    json_arena_end();
+}
+
+typedef struct {
+    double ns;
+    uint32_t allocs;
+    uint32_t failures;
+    size_t free_bytes;
+    size_t largest;
+    size_t worst_largest;   // smallest largest-free-block seen during the run
+} result_t;
+
+static result_t run(void (*frame)(uint32_t), uint32_t iters)
+{
+    result_t r;
+    heap_reset();
+    memset(ring, 0, sizeof(ring));
+    ring_next = 0;
+
+    // One pass for the heap state, then timing on a fresh heap
+    r.worst_largest = HEAP_SIZE;
+    for (uint32_t i = 0; i < iters; i++) {
+        frame(i);
+        if (i % 100 == 0) {
+            size_t free_bytes, largest;
+            heap_report(&free_bytes, &largest);
+            if (largest < r.worst_largest)
+                r.worst_largest = largest;
+        }
+    }
+    r.allocs = heap_allocs;
+    r.failures = heap_failures;
+    heap_report(&r.free_bytes, &r.largest);
+
+    heap_reset();
+    memset(ring, 0, sizeof(ring));
+    r.ns = bench_ns_per_op(frame, iters / 10);
+    return r;
+}
+
+static void print(const char *label, const result_t &r, uint32_t iters)
+{
+    printf("%-12s %7.1f ns/frame  %5.2f heap allocs/frame  free %6zu  largest %6zu"
+           " (worst %6zu)  fragmentation %.3f  failed %u\n",
+           label, r.ns, (double)r.allocs / iters, r.free_bytes, r.largest,
+           r.worst_largest, r.free_bytes ? 1.0 - (double)r.largest / r.free_bytes : 0.0,
+           (unsigned)r.failures);
+}
+
+int main(void)
+{
+    const uint32_t iters = 200000;
+    bench_header("cJSON control frames on a 48 KB first-fit heap");
+
+    // Heap path: every cJSON allocation goes to the model heap
+    cJSON_Hooks hooks = {heap_malloc, heap_free};
+    cJSON_InitHooks(&hooks);
+    result_t heap = run(frame_heap, iters);
+
+    // Arena path: the installed hooks serve the owner task from the arena
+    json_arena_init();
+    json_arena_stats_t s0, s1;
+    json_arena_get_stats(&s0);
+    result_t arena = run(frame_arena, iters);
+    json_arena_get_stats(&s1);
+
+    print("malloc/free", heap, iters);
+    print("json arena", arena, iters);
+    printf("arena: %.2f allocs/frame, peak %zu of %u bytes, %u exhausted\n",
+           (double)(s1.allocs - s0.allocs) / (s1.frames - s0.frames), s1.peak_bytes,
+           JSON_ARENA_SIZE, (unsigned)(s1.exhausted - s0.exhausted));
+    bench_exit();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ * Timing helpers for the host microbenchmarks. Each benchmark runs its
+ * body for a fixed number of iterations after a warm-up pass and prints
+ * one "name: X ns/op" line (plus any extra columns the caller adds).
+ * Numbers are for comparing variants on the same machine only.
+ */
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+// Keeps a value alive so the compiler cannot drop the work producing it
+template <typename T>
+static inline void bench_keep(const T &v)
+{
+    asm volatile("" : : "r,m"(v) : "memory");
+}
+
+// Nanoseconds per call of fn(i), best of three runs of iters calls
+template <typename Fn>
+static double bench_ns_per_op(Fn fn, uint32_t iters)
+{
+    for (uint32_t i = 0; i < iters / 10 + 1; i++)
+        fn(i);
+
+    double best = 0;
+    for (int run = 0; run < 3; run++) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iters; i++)
+            fn(i);
+        auto t1 = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / iters;
+        if (run == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+static inline void bench_header(const char *title)
+{
+    printf("# %s\n", title);
+}
+
+// Exits without static destructors, for benchmarks that started the
+// simulated tasks and server threads
+[[noreturn]] static inline void bench_exit(void)
+{
+    fflush(stdout);
+    fflush(stderr);
+    _exit(0);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+/*
+ * Host shim of esp_littlefs.h. Nothing is mounted; the web server reads
+ * WEB_ROOT, which the host build points at the staged www directory.
+ */
+
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char *base_path;
+    const char *partition_label;
+    bool format_if_mount_failed;
+    bool dont_mount;
+} esp_vfs_littlefs_conf_t;
+
+esp_err_t esp_vfs_littlefs_register(const esp_vfs_littlefs_conf_t *conf);
+esp_err_t esp_vfs_littlefs_unregister(const char *partition_label);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+
+/* Host shim of ESP-IDF esp_netif.h */
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct esp_netif_obj esp_netif_t;
+
+esp_err_t esp_netif_init(void);
+esp_netif_t *esp_netif_create_default_wifi_ap(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,17 @@
+#pragma once
+
+/* Host shim of ESP-IDF esp_random.h, backed by getrandom() */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t esp_random(void);
+void esp_fill_random(void *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
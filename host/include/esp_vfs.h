@@ -0,0 +1,5 @@
+#pragma once
+
+/* Host shim of ESP-IDF esp_vfs.h: the host file system is used directly */
+
+#include "esp_err.h"
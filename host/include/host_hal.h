@@ -0,0 +1,79 @@
+#pragma once
+
+/*
+ * Simulator-only hooks into the fake GPIO / LEDC peripherals.
+ *
+ * Observers are called synchronously from whichever thread touched the
+ * peripheral (normally the motor control task) and must not block.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HOST_HAL_GPIO_COUNT 40
+#define HOST_HAL_LEDC_CHANNELS 8
+
+/** A duty change was issued; fade_ms is 0 for an immediate update */
+typedef void (*host_hal_ledc_observer_t)(int channel, uint32_t target_duty,
+                                         uint32_t fade_ms, void *arg);
+
+/** An output pin changed level */
+typedef void (*host_hal_gpio_observer_t)(int gpio, uint32_t level, void *arg);
+
+/** A peripheral register was written with REG_WRITE, reported in program order */
+typedef void (*host_hal_reg_observer_t)(uint32_t reg, uint32_t val, void *arg);
+
+void host_hal_set_ledc_observer(host_hal_ledc_observer_t cb, void *arg);
+void host_hal_set_gpio_observer(host_hal_gpio_observer_t cb, void *arg);
+void host_hal_set_reg_observer(host_hal_reg_observer_t cb, void *arg);
+
+/** Current (fade-interpolated) duty of a channel */
+uint32_t host_hal_ledc_duty(int channel);
+
+/** Last level written to an output pin */
+uint32_t host_hal_gpio_level(int gpio);
+
+/**
+ * @brief Stream output events as UDP datagrams if RC_SIM_PROBE is set
+ *
+ * RC_SIM_PROBE=host:port. Each datagram is one text line, either
+ * "ledc <t_ns> <channel> <duty> <fade_ms>" for a duty change or
+ * "applied <t_ns> <seq> <total_us>" for a command the control task
+ * applied (see trace_set_applied_callback()). t_ns is on CLOCK_MONOTONIC
+ * so tools on the same machine can compare it with their own timestamps.
+ */
+void host_probe_init(void);
+
+/**
+ * @brief Port the simulated HTTP server listens on
+ *
+ * RC_SIM_PORT=0 binds any free port; tests read it back here. 0 until
+ * httpd_start() has run.
+ */
+uint16_t host_httpd_port(void);
+
+/**
+ * @brief URI handler calls so far and their total duration
+ *
+ * Durations include the handler's socket writes. Lets benchmarks separate
+ * handler time from client round trips.
+ */
+void host_httpd_handler_stats(uint32_t *calls, uint64_t *total_ns);
+
+/**
+ * @brief Sleep for the simulated duration of a slow boot step
+ *
+ * Durations come from RC_SIM_BOOT_MS, a comma-separated list of
+ * "step=ms" pairs. The word "typical" loads ESP32-like values for every
+ * step, and later pairs override them. Steps are nvs_init, fs_mount,
+ * wifi_init, wifi_start, scan_channel (per channel, 13 channels) and
+ * httpd_start. Without the variable there is no delay.
+ */
+void host_sim_boot_delay(const char *step);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,9 @@
+#pragma once
+
+/* Host shim of lwIP's BSD socket API: the host's own sockets */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
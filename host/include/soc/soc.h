@@ -0,0 +1,23 @@
+#pragma once
+
+/*
+ * Host shim of soc/soc.h: register accessors only. Writes to the GPIO
+ * output registers (soc/gpio_reg.h) reach the fake GPIO in hal.cpp;
+ * any other address is rejected there.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void host_hal_reg_write(uint32_t reg, uint32_t val);
+uint32_t host_hal_reg_read(uint32_t reg);
+
+#define REG_WRITE(_r, _v) host_hal_reg_write((uint32_t)(_r), (uint32_t)(_v))
+#define REG_READ(_r) host_hal_reg_read((uint32_t)(_r))
+
+#ifdef __cplusplus
+}
+#endif
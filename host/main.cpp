@@ -0,0 +1,26 @@
+// ===============================
+// host/main.cpp
+// ===============================
+
+#include <unistd.h>
+
+#include "host_hal.h"
+
+extern "C" void app_main(void);
+
+/* =====================================================
+ *                  SIMULATOR ENTRY
+ * ===================================================== */
+
+int main(void)
+{
+    // Optional output probe for benchmarks, before the motors start
+    host_probe_init();
+
+    // Same boot path as the target; everything after app_main runs
+    // on the simulated tasks, timers and httpd thread
+    app_main();
+
+    for (;;)
+        pause();
+}
@@ -0,0 +1,155 @@
+/*
+ * esp_timer shim: a single dispatch thread fires callbacks in deadline
+ * order, like the ESP_TIMER_TASK dispatch method on target.
+ */
+
+#include "esp_timer.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <time.h>
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+    int64_t deadline_us;
+    uint64_t period_us;
+    bool active;
+};
+
+static std::mutex lock;
+static std::condition_variable wake;
+static std::vector<esp_timer *> timers;
+static bool dispatcher_started = false;
+
+static int64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    static const int64_t boot = monotonic_us();
+    return monotonic_us() - boot;
+}
+
+/* =====================================================
+ *              DISPATCH THREAD
+ * ===================================================== */
+
+static void dispatch_loop(void)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;) {
+        esp_timer *next = NULL;
+        for (esp_timer *t : timers) {
+            if (t->active && (!next || t->deadline_us < next->deadline_us))
+                next = t;
+        }
+
+        if (!next) {
+            wake.wait(guard);
+            continue;
+        }
+
+        int64_t now = esp_timer_get_time();
+        if (next->deadline_us > now) {
+            wake.wait_for(guard, std::chrono::microseconds(next->deadline_us - now));
+            continue;
+        }
+
+        if (next->period_us) {
+            // Skip missed periods instead of firing a burst
+            next->deadline_us += next->period_us;
+            if (next->deadline_us <= now)
+                next->deadline_us = now + next->period_us;
+        } else {
+            next->active = false;
+        }
+
+        esp_timer_cb_t cb = next->callback;
+        void *arg = next->arg;
+        guard.unlock();
+        cb(arg);
+        guard.lock();
+    }
+}
+
+/* =====================================================
+ *              TIMER API
+ * ===================================================== */
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    if (!args || !args->callback || !out)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_timer *t = new esp_timer{args->callback, args->arg, args->name, 0, 0, false};
+
+    std::lock_guard<std::mutex> guard(lock);
+    timers.push_back(t);
+    if (!dispatcher_started) {
+        std::thread(dispatch_loop).detach();
+        dispatcher_started = true;
+    }
+    *out = t;
+    return ESP_OK;
+}
+
+static esp_err_t start(esp_timer_handle_t timer, uint64_t us, uint64_t period_us)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (timer->active)
+        return ESP_ERR_INVALID_STATE;
+    timer->deadline_us = esp_timer_get_time() + (int64_t)us;
+    timer->period_us = period_us;
+    timer->active = true;
+    wake.notify_one();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return start(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!timer->active)
+        return ESP_ERR_INVALID_STATE;
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (timer->active)
+        return ESP_ERR_INVALID_STATE;
+    for (auto it = timers.begin(); it != timers.end(); ++it) {
+        if (*it == timer) {
+            timers.erase(it);
+            break;
+        }
+    }
+    delete timer;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return timer->active;
+}
@@ -0,0 +1,291 @@
+/*
+ * FreeRTOS task shim: every task is a detached pthread with its own
+ * notification counter. Threads the simulator did not create (main,
+ * esp_timer, httpd) get a task record on first use so they can be
+ * notified and queried like any other task. Event groups are a bit
+ * mask under a mutex and condition variable.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct host_task {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify;
+    TaskFunction_t fn;
+    void *arg;
+    const char *name;
+};
+
+static thread_local host_task *current_task = NULL;
+static pthread_mutex_t critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static void init_cond(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// Absolute CLOCK_MONOTONIC deadline timeout ticks from now
+static struct timespec deadline_after(TickType_t timeout)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += timeout / 1000;
+    ts.tv_nsec += (long)(timeout % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static host_task *task_new(TaskFunction_t fn, void *arg, const char *name)
+{
+    host_task *t = (host_task *)calloc(1, sizeof(host_task));
+    pthread_mutex_init(&t->lock, NULL);
+    init_cond(&t->cond);
+
+    t->fn = fn;
+    t->arg = arg;
+    t->name = name;
+    return t;
+}
+
+static void *task_entry(void *p)
+{
+    current_task = (host_task *)p;
+    current_task->fn(current_task->arg);
+    return NULL;
+}
+
+static TickType_t now_ticks(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static void sleep_ms(uint32_t ms)
+{
+    struct timespec ts = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000L};
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+    }
+}
+
+/* =====================================================
+ *              TASKS
+ * ===================================================== */
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name,
+                                   uint32_t stack, void *arg, UBaseType_t prio,
+                                   TaskHandle_t *out, BaseType_t core)
+{
+    (void)stack;
+    (void)prio;
+    (void)core;
+
+    host_task *t = task_new(fn, arg, name);
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int rc = pthread_create(&thread, &attr, task_entry, t);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        free(t);
+        return pdFAIL;
+    }
+
+    pthread_setname_np(thread, name);
+    if (out)
+        *out = t;
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+                       void *arg, UBaseType_t prio, TaskHandle_t *out)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, out, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    // Only self-deletion is supported; the record is leaked on purpose
+    // since other tasks may still hold the handle
+    if (task == NULL || task == current_task)
+        pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    sleep_ms(ticks);
+}
+
+void vTaskDelayUntil(TickType_t *prev_wake, TickType_t period)
+{
+    *prev_wake += period;
+    TickType_t now = now_ticks();
+    if ((int32_t)(*prev_wake - now) > 0)
+        sleep_ms(*prev_wake - now);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    static const TickType_t boot = now_ticks();
+    return now_ticks() - boot;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (!current_task)
+        current_task = task_new(NULL, NULL, "host");
+    return current_task;
+}
+
+/* =====================================================
+ *              NOTIFICATIONS
+ * ===================================================== */
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t timeout)
+{
+    host_task *t = xTaskGetCurrentTaskHandle();
+
+    pthread_mutex_lock(&t->lock);
+    if (timeout == portMAX_DELAY) {
+        while (!t->notify)
+            pthread_cond_wait(&t->cond, &t->lock);
+    } else if (timeout) {
+        struct timespec ts = deadline_after(timeout);
+        while (!t->notify &&
+               pthread_cond_timedwait(&t->cond, &t->lock, &ts) != ETIMEDOUT) {
+        }
+    }
+
+    uint32_t value = t->notify;
+    if (value)
+        t->notify = clear_on_exit ? 0 : value - 1;
+    pthread_mutex_unlock(&t->lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->lock);
+    task->notify++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    xTaskNotifyGive(task);
+    if (woken)
+        *woken = pdFALSE;
+}
+
+/* =====================================================
+ *              EVENT GROUPS
+ * ===================================================== */
+
+struct host_event_group {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    EventBits_t bits;
+};
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    host_event_group *g = (host_event_group *)calloc(1, sizeof(host_event_group));
+    pthread_mutex_init(&g->lock, NULL);
+    init_cond(&g->cond);
+    return g;
+}
+
+void vEventGroupDelete(EventGroupHandle_t group)
+{
+    pthread_cond_destroy(&group->cond);
+    pthread_mutex_destroy(&group->lock);
+    free(group);
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    pthread_mutex_lock(&group->lock);
+    group->bits |= bits;
+    EventBits_t now = group->bits;
+    pthread_cond_broadcast(&group->cond);
+    pthread_mutex_unlock(&group->lock);
+    return now;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    pthread_mutex_lock(&group->lock);
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    pthread_mutex_unlock(&group->lock);
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+    pthread_mutex_lock(&group->lock);
+    EventBits_t now = group->bits;
+    pthread_mutex_unlock(&group->lock);
+    return now;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+                                BaseType_t clear_on_exit, BaseType_t wait_for_all,
+                                TickType_t timeout)
+{
+    struct timespec ts = deadline_after(timeout == portMAX_DELAY ? 0 : timeout);
+
+    pthread_mutex_lock(&group->lock);
+    for (;;) {
+        EventBits_t set = group->bits & bits;
+        if (wait_for_all ? set == bits : set != 0)
+            break;
+        if (timeout == portMAX_DELAY)
+            pthread_cond_wait(&group->cond, &group->lock);
+        else if (!timeout ||
+                 pthread_cond_timedwait(&group->cond, &group->lock, &ts) == ETIMEDOUT)
+            break;
+    }
+
+    EventBits_t now = group->bits;
+    EventBits_t met = now & bits;
+    if (clear_on_exit && (wait_for_all ? met == bits : met != 0))
+        group->bits &= ~bits;
+    pthread_mutex_unlock(&group->lock);
+    return now;
+}
+
+/* =====================================================
+ *              CRITICAL SECTIONS
+ * ===================================================== */
+
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_mutex_lock(&critical);
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_mutex_unlock(&critical);
+}
@@ -0,0 +1,264 @@
+/*
+ * Fake GPIO and LEDC peripherals. Fades are modelled as linear ramps
+ * in time so ledc_get_duty reports what the hardware would output.
+ */
+
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "esp_timer.h"
+#include "host_hal.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    uint32_t from;
+    uint32_t target;
+    int64_t start_us;
+    int64_t fade_us;
+} channel_t;
+
+static std::mutex lock;
+static uint32_t gpio_levels[HOST_HAL_GPIO_COUNT];
+static channel_t channels[LEDC_SPEED_MODE_MAX][HOST_HAL_LEDC_CHANNELS];
+static uint32_t max_duty = (1u << 13) - 1;
+
+static host_hal_ledc_observer_t ledc_observer = NULL;
+static void *ledc_observer_arg = NULL;
+static host_hal_gpio_observer_t gpio_observer = NULL;
+static void *gpio_observer_arg = NULL;
+static host_hal_reg_observer_t reg_observer = NULL;
+static void *reg_observer_arg = NULL;
+
+static uint32_t duty_at(const channel_t *c, int64_t now)
+{
+    int64_t elapsed = now - c->start_us;
+    if (c->fade_us <= 0 || elapsed >= c->fade_us)
+        return c->target;
+    int64_t delta = (int64_t)c->target - (int64_t)c->from;
+    return (uint32_t)((int64_t)c->from + delta * elapsed / c->fade_us);
+}
+
+static bool valid(ledc_mode_t mode, ledc_channel_t ch)
+{
+    return mode < LEDC_SPEED_MODE_MAX && ch < HOST_HAL_LEDC_CHANNELS;
+}
+
+static void notify_ledc(ledc_channel_t ch, uint32_t duty, uint32_t fade_ms)
+{
+    if (ledc_observer)
+        ledc_observer((int)ch, duty, fade_ms, ledc_observer_arg);
+}
+
+/* =====================================================
+ *              GPIO
+ * ===================================================== */
+
+esp_err_t gpio_config(const gpio_config_t *cfg)
+{
+    if (cfg->pin_bit_mask >> HOST_HAL_GPIO_COUNT)
+        return ESP_ERR_INVALID_ARG;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level)
+{
+    if (gpio < 0 || gpio >= HOST_HAL_GPIO_COUNT)
+        return ESP_ERR_INVALID_ARG;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        gpio_levels[gpio] = level ? 1 : 0;
+    }
+    if (gpio_observer)
+        gpio_observer(gpio, level ? 1 : 0, gpio_observer_arg);
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio)
+{
+    if (gpio < 0 || gpio >= HOST_HAL_GPIO_COUNT)
+        return 0;
+    std::lock_guard<std::mutex> guard(lock);
+    return (int)gpio_levels[gpio];
+}
+
+/*
+ * Direct register access: the output set/clear registers update every
+ * pin in the mask at once. The register observer sees each write as
+ * issued (so tests can check ordering), then the GPIO observer hears
+ * about each pin that changed. Reads of GPIO_OUT_REG/GPIO_OUT1_REG
+ * return the levels.
+ */
+void host_hal_reg_write(uint32_t reg, uint32_t val)
+{
+    int base;
+    bool level;
+    switch (reg) {
+    case GPIO_OUT_W1TS_REG: base = 0; level = true; break;
+    case GPIO_OUT_W1TC_REG: base = 0; level = false; break;
+    case GPIO_OUT1_W1TS_REG: base = 32; level = true; break;
+    case GPIO_OUT1_W1TC_REG: base = 32; level = false; break;
+    default:
+        fprintf(stderr, "host_hal: write to unsupported register 0x%08x\n", (unsigned)reg);
+        abort();
+    }
+
+    if (reg_observer)
+        reg_observer(reg, val, reg_observer_arg);
+
+    uint64_t changed = 0;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (int bit = 0; bit < 32 && base + bit < HOST_HAL_GPIO_COUNT; bit++) {
+            if (!(val & (1u << bit)) || gpio_levels[base + bit] == level)
+                continue;
+            gpio_levels[base + bit] = level;
+            changed |= 1ULL << (base + bit);
+        }
+    }
+    for (int gpio = 0; gpio < HOST_HAL_GPIO_COUNT && gpio_observer; gpio++) {
+        if (changed & (1ULL << gpio))
+            gpio_observer(gpio, level, gpio_observer_arg);
+    }
+}
+
+uint32_t host_hal_reg_read(uint32_t reg)
+{
+    int base = reg == GPIO_OUT_REG ? 0 : reg == GPIO_OUT1_REG ? 32 : -1;
+    if (base < 0) {
+        fprintf(stderr, "host_hal: read of unsupported register 0x%08x\n", (unsigned)reg);
+        abort();
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    uint32_t v = 0;
+    for (int bit = 0; bit < 32 && base + bit < HOST_HAL_GPIO_COUNT; bit++)
+        v |= gpio_levels[base + bit] << bit;
+    return v;
+}
+
+/* =====================================================
+ *              LEDC
+ * ===================================================== */
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *cfg)
+{
+    if (cfg->duty_resolution <= 0 || cfg->duty_resolution >= LEDC_TIMER_BIT_MAX)
+        return ESP_ERR_INVALID_ARG;
+    max_duty = (1u << cfg->duty_resolution) - 1;
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *cfg)
+{
+    if (!valid(cfg->speed_mode, cfg->channel))
+        return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::mutex> guard(lock);
+    channels[cfg->speed_mode][cfg->channel] = channel_t{cfg->duty, cfg->duty, 0, 0};
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags)
+{
+    (void)intr_alloc_flags;
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t ch, uint32_t duty)
+{
+    return ledc_set_duty_and_update(mode, ch, duty, 0);
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t ch)
+{
+    return valid(mode, ch) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t mode, ledc_channel_t ch)
+{
+    if (!valid(mode, ch))
+        return 0;
+    std::lock_guard<std::mutex> guard(lock);
+    return duty_at(&channels[mode][ch], esp_timer_get_time());
+}
+
+esp_err_t ledc_set_duty_and_update(ledc_mode_t mode, ledc_channel_t ch,
+                                   uint32_t duty, uint32_t hpoint)
+{
+    (void)hpoint;
+    if (!valid(mode, ch) || duty > max_duty + 1)
+        return ESP_ERR_INVALID_ARG;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        channels[mode][ch] = channel_t{duty, duty, 0, 0};
+    }
+    notify_ledc(ch, duty, 0);
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_fade_time_and_start(ledc_mode_t mode, ledc_channel_t ch,
+                                       uint32_t target_duty, uint32_t max_fade_time_ms,
+                                       ledc_fade_mode_t fade_mode)
+{
+    (void)fade_mode;
+    if (!valid(mode, ch) || target_duty > max_duty + 1)
+        return ESP_ERR_INVALID_ARG;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        channel_t *c = &channels[mode][ch];
+        int64_t now = esp_timer_get_time();
+        c->from = duty_at(c, now);
+        c->target = target_duty;
+        c->start_us = now;
+        c->fade_us = (int64_t)max_fade_time_ms * 1000;
+    }
+    notify_ledc(ch, target_duty, max_fade_time_ms);
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_stop(ledc_mode_t mode, ledc_channel_t ch)
+{
+    if (!valid(mode, ch))
+        return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::mutex> guard(lock);
+    channel_t *c = &channels[mode][ch];
+    uint32_t duty = duty_at(c, esp_timer_get_time());
+    *c = channel_t{duty, duty, 0, 0};
+    return ESP_OK;
+}
+
+/* =====================================================
+ *              SIMULATOR HOOKS
+ * ===================================================== */
+
+void host_hal_set_ledc_observer(host_hal_ledc_observer_t cb, void *arg)
+{
+    ledc_observer_arg = arg;
+    ledc_observer = cb;
+}
+
+void host_hal_set_gpio_observer(host_hal_gpio_observer_t cb, void *arg)
+{
+    gpio_observer_arg = arg;
+    gpio_observer = cb;
+}
+
+void host_hal_set_reg_observer(host_hal_reg_observer_t cb, void *arg)
+{
+    reg_observer_arg = arg;
+    reg_observer = cb;
+}
+
+uint32_t host_hal_ledc_duty(int channel)
+{
+    return ledc_get_duty(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)channel);
+}
+
+uint32_t host_hal_gpio_level(int gpio)
+{
+    return (uint32_t)gpio_get_level((gpio_num_t)gpio);
+}
@@ -0,0 +1,1084 @@
+/*
+ * esp_http_server shim over POSIX sockets.
+ *
+ * Follows the IDF server's structure closely enough that handler code
+ * behaves the same: a single thread select()s over the listening
+ * socket, the open sessions and a control pipe; handlers, WebSocket
+ * frames and queued work all run on that thread. Session limits,
+ * handler limits and the WebSocket control frame handling mirror IDF.
+ */
+
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "host_hal.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char *TAG = "httpd";
+
+// lwIP's default TCP_SND_BUF (4 * TCP_MSS): a client that stops reading
+// fills the send buffer as quickly as it would on the chip, rather than
+// after megabytes of Linux send buffer autotuning
+#define SESSION_SNDBUF 5744
+
+struct session {
+    int fd;
+    bool ws;
+    httpd_uri_t ws_uri;
+    void *ctx;
+    httpd_free_ctx_fn_t free_ctx;
+    std::string inbuf;      // received but not yet consumed
+    bool close_pending;
+    uint64_t lru;
+};
+
+struct server {
+    httpd_config_t cfg;
+    int listen_fd;
+    int wake[2];
+    std::vector<httpd_uri_t> handlers;
+    std::vector<session *> sessions;
+    std::mutex sess_lock;    // sessions list; taken before send_lock
+    std::mutex send_lock;    // socket writes from handlers and async senders
+    std::mutex work_lock;
+    std::deque<std::pair<httpd_work_fn_t, void *>> work;
+    pthread_t thread;
+    uint64_t lru_counter;
+};
+
+struct req_aux {
+    server *srv;
+    session *sess;
+    std::string headers;
+    size_t body_left;
+
+    const char *status;
+    const char *type;
+    std::vector<std::pair<const char *, const char *>> resp_hdrs;
+    bool chunked;
+
+    bool ws_hdr;            // frame header (and length) parsed
+    bool ws_payload;        // payload consumed by the handler
+    uint8_t ws_b0;
+    uint8_t ws_b1;
+    uint8_t ws_mask[4];
+    uint64_t ws_len;
+};
+
+static inline req_aux *aux_of(httpd_req_t *r)
+{
+    return (req_aux *)r->aux;
+}
+
+/* =====================================================
+ *              SHA-1 / BASE64 (WS HANDSHAKE)
+ * ===================================================== */
+
+static inline uint32_t rol(uint32_t v, int n)
+{
+    return (v << n) | (v >> (32 - n));
+}
+
+static void sha1(const uint8_t *data, size_t len, uint8_t out[20])
+{
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    std::string msg((const char *)data, len);
+    msg.push_back((char)0x80);
+    while (msg.size() % 64 != 56)
+        msg.push_back(0);
+    uint64_t bits = (uint64_t)len * 8;
+    for (int i = 7; i >= 0; i--)
+        msg.push_back((char)(bits >> (i * 8)));
+
+    for (size_t off = 0; off < msg.size(); off += 64) {
+        uint32_t w[80];
+        const uint8_t *p = (const uint8_t *)msg.data() + off;
+        for (int i = 0; i < 16; i++)
+            w[i] = (uint32_t)p[i * 4] << 24 | p[i * 4 + 1] << 16 | p[i * 4 + 2] << 8 | p[i * 4 + 3];
+        for (int i = 16; i < 80; i++)
+            w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t t = rol(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for (int i = 0; i < 5; i++) {
+        out[i * 4] = (uint8_t)(h[i] >> 24);
+        out[i * 4 + 1] = (uint8_t)(h[i] >> 16);
+        out[i * 4 + 2] = (uint8_t)(h[i] >> 8);
+        out[i * 4 + 3] = (uint8_t)h[i];
+    }
+}
+
+static std::string base64(const uint8_t *data, size_t len)
+{
+    static const char tbl[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < len)
+            v |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < len)
+            v |= data[i + 2];
+        out.push_back(tbl[(v >> 18) & 63]);
+        out.push_back(tbl[(v >> 12) & 63]);
+        out.push_back(i + 1 < len ? tbl[(v >> 6) & 63] : '=');
+        out.push_back(i + 2 < len ? tbl[v & 63] : '=');
+    }
+    return out;
+}
+
+/* =====================================================
+ *              SOCKET I/O
+ * ===================================================== */
+
+static bool send_all(int fd, const void *buf, size_t len)
+{
+    const char *p = (const char *)buf;
+    while (len) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// Up to len bytes, buffered data first; blocks (with SO_RCVTIMEO) if empty
+static ssize_t sess_read_some(session *s, void *buf, size_t len)
+{
+    if (!s->inbuf.empty()) {
+        size_t n = std::min(len, s->inbuf.size());
+        memcpy(buf, s->inbuf.data(), n);
+        s->inbuf.erase(0, n);
+        return (ssize_t)n;
+    }
+    for (;;) {
+        ssize_t n = recv(s->fd, buf, len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return HTTPD_SOCK_ERR_TIMEOUT;
+        return n < 0 ? HTTPD_SOCK_ERR_FAIL : n;
+    }
+}
+
+static bool sess_read(session *s, void *buf, size_t len)
+{
+    uint8_t *p = (uint8_t *)buf;
+    while (len) {
+        ssize_t n = sess_read_some(s, p, len);
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool sess_discard(session *s, uint64_t len)
+{
+    uint8_t tmp[256];
+    while (len) {
+        size_t n = (size_t)std::min<uint64_t>(len, sizeof(tmp));
+        if (!sess_read(s, tmp, n))
+            return false;
+        len -= n;
+    }
+    return true;
+}
+
+/* =====================================================
+ *              SESSIONS
+ * ===================================================== */
+
+static void sess_close(server *srv, session *s)
+{
+    {
+        std::lock_guard<std::mutex> guard(srv->sess_lock);
+        for (auto it = srv->sessions.begin(); it != srv->sessions.end(); ++it) {
+            if (*it == s) {
+                srv->sessions.erase(it);
+                break;
+            }
+        }
+    }
+
+    if (s->ctx) {
+        if (s->free_ctx)
+            s->free_ctx(s->ctx);
+        else
+            free(s->ctx);
+    }
+
+    // As on target, a close_fn takes over closing the socket
+    if (srv->cfg.close_fn)
+        srv->cfg.close_fn(srv, s->fd);
+    else
+        close(s->fd);
+
+    ESP_LOGD(TAG, "session %d closed", s->fd);
+    delete s;
+}
+
+static session *sess_find(server *srv, int fd)
+{
+    for (session *s : srv->sessions) {
+        if (s->fd == fd)
+            return s;
+    }
+    return NULL;
+}
+
+static void sess_accept(server *srv)
+{
+    int fd = accept(srv->listen_fd, NULL, NULL);
+    if (fd < 0)
+        return;
+
+    if (srv->sessions.size() >= srv->cfg.max_open_sockets) {
+        session *victim = NULL;
+        if (srv->cfg.lru_purge_enable) {
+            for (session *s : srv->sessions) {
+                if (!victim || s->lru < victim->lru)
+                    victim = s;
+            }
+        }
+        if (!victim) {
+            ESP_LOGW(TAG, "session limit (%u) reached, dropping connection",
+                     srv->cfg.max_open_sockets);
+            close(fd);
+            return;
+        }
+        ESP_LOGW(TAG, "purging least recently used session %d", victim->fd);
+        sess_close(srv, victim);
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval rcv = {srv->cfg.recv_wait_timeout, 0};
+    struct timeval snd = {srv->cfg.send_wait_timeout, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &rcv, sizeof(rcv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &snd, sizeof(snd));
+    int sndbuf = SESSION_SNDBUF;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+    if (srv->cfg.open_fn && srv->cfg.open_fn(srv, fd) != ESP_OK) {
+        close(fd);
+        return;
+    }
+
+    session *s = new session();
+    s->fd = fd;
+    s->lru = ++srv->lru_counter;
+
+    std::lock_guard<std::mutex> guard(srv->sess_lock);
+    srv->sessions.push_back(s);
+}
+
+/* =====================================================
+ *              REQUEST DISPATCH
+ * ===================================================== */
+
+static const char *find_header(const std::string &headers, const char *field, size_t *len)
+{
+    size_t flen = strlen(field);
+    size_t pos = 0;
+    while (pos < headers.size()) {
+        size_t eol = headers.find("\r\n", pos);
+        if (eol == std::string::npos)
+            eol = headers.size();
+        if (eol - pos > flen && headers[pos + flen] == ':' &&
+            !strncasecmp(headers.c_str() + pos, field, flen)) {
+            size_t v = pos + flen + 1;
+            while (v < eol && headers[v] == ' ')
+                v++;
+            *len = eol - v;
+            return headers.c_str() + v;
+        }
+        pos = eol + 2;
+    }
+    return NULL;
+}
+
+static void req_init(httpd_req_t *req, req_aux *aux, server *srv, session *s)
+{
+    *req = httpd_req_t{};
+    aux->srv = srv;
+    aux->sess = s;
+    aux->status = "200 OK";
+    aux->type = "text/html";
+    req->handle = srv;
+    req->aux = aux;
+    req->sess_ctx = s->ctx;
+    req->free_ctx = s->free_ctx;
+}
+
+// Handler calls and their total duration, for benchmarks
+static std::atomic<uint32_t> handler_calls{0};
+static std::atomic<uint64_t> handler_total_ns{0};
+
+void host_httpd_handler_stats(uint32_t *calls, uint64_t *total_ns)
+{
+    *total_ns = handler_total_ns;
+    *calls = handler_calls;
+}
+
+static esp_err_t run_handler(server *srv, session *s, const httpd_uri_t *uri,
+                             httpd_req_t *req)
+{
+    req->user_ctx = uri->user_ctx;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    esp_err_t ret = uri->handler(req);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    handler_total_ns += (uint64_t)((t1.tv_sec - t0.tv_sec) * 1000000000 +
+                                   (t1.tv_nsec - t0.tv_nsec));
+    handler_calls++;
+
+    // Adopt a context the handler attached, releasing the previous one
+    if (req->sess_ctx != s->ctx && !req->ignore_sess_ctx_changes) {
+        if (s->ctx) {
+            if (s->free_ctx)
+                s->free_ctx(s->ctx);
+            else
+                free(s->ctx);
+        }
+        s->ctx = req->sess_ctx;
+    }
+    s->free_ctx = req->free_ctx;
+    return ret;
+}
+
+static bool ws_handshake(server *srv, session *s, const httpd_uri_t *uri,
+                         httpd_req_t *req)
+{
+    req_aux *aux = aux_of(req);
+    size_t klen;
+    const char *key = find_header(aux->headers, "Sec-WebSocket-Key", &klen);
+    if (!key) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad WebSocket handshake");
+        return false;
+    }
+
+    std::string accept(key, klen);
+    accept += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    uint8_t digest[20];
+    sha1((const uint8_t *)accept.data(), accept.size(), digest);
+
+    std::string resp =
+        "HTTP/1.1 101 Switching Protocols\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: " + base64(digest, sizeof(digest)) + "\r\n";
+    if (uri->supported_subprotocol)
+        resp += std::string("Sec-WebSocket-Protocol: ") + uri->supported_subprotocol + "\r\n";
+    resp += "\r\n";
+    {
+        std::lock_guard<std::mutex> guard(srv->send_lock);
+        if (!send_all(s->fd, resp.data(), resp.size()))
+            return false;
+    }
+
+    s->ws = true;
+    s->ws_uri = *uri;
+
+    // The handler sees the handshake as a GET with no body
+    return run_handler(srv, s, uri, req) == ESP_OK;
+}
+
+static bool handle_http(server *srv, session *s)
+{
+    // Accumulate until the end of the header block
+    size_t end;
+    while ((end = s->inbuf.find("\r\n\r\n")) == std::string::npos) {
+        if (s->inbuf.size() > 8192)
+            return false;
+        char tmp[1024];
+        ssize_t n = recv(s->fd, tmp, sizeof(tmp), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        s->inbuf.append(tmp, (size_t)n);
+    }
+
+    std::string head = s->inbuf.substr(0, end + 2);
+    s->inbuf.erase(0, end + 4);
+
+    size_t eol = head.find("\r\n");
+    std::string line = head.substr(0, eol);
+    size_t sp1 = line.find(' ');
+    size_t sp2 = line.find(' ', sp1 + 1);
+    if (sp1 == std::string::npos || sp2 == std::string::npos)
+        return false;
+    std::string method = line.substr(0, sp1);
+    std::string target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+
+    httpd_req_t req;
+    req_aux aux{};
+    req_init(&req, &aux, srv, s);
+    aux.headers = head.substr(eol + 2);
+
+    static const struct { const char *name; httpd_method_t m; } methods[] = {
+        {"DELETE", HTTP_DELETE}, {"GET", HTTP_GET}, {"HEAD", HTTP_HEAD},
+        {"POST", HTTP_POST}, {"PUT", HTTP_PUT},
+    };
+    req.method = -1;
+    for (const auto &m : methods) {
+        if (method == m.name)
+            req.method = m.m;
+    }
+
+    snprintf(req.uri, sizeof(req.uri), "%s", target.c_str());
+
+    size_t vlen;
+    const char *cl = find_header(aux.headers, "Content-Length", &vlen);
+    req.content_len = cl ? strtoul(std::string(cl, vlen).c_str(), NULL, 10) : 0;
+    aux.body_left = req.content_len;
+
+    size_t match_upto = strcspn(req.uri, "?");
+    const httpd_uri_t *uri = NULL;
+    bool uri_seen = false;
+    for (const auto &h : srv->handlers) {
+        bool match = srv->cfg.uri_match_fn
+            ? srv->cfg.uri_match_fn(h.uri, req.uri, match_upto)
+            : strlen(h.uri) == match_upto && !strncmp(h.uri, req.uri, match_upto);
+        if (!match)
+            continue;
+        uri_seen = true;
+        if ((int)h.method == req.method) {
+            uri = &h;
+            break;
+        }
+    }
+
+    s->lru = ++srv->lru_counter;
+
+    if (!uri) {
+        if (uri_seen)
+            httpd_resp_send_err(&req, HTTPD_405_METHOD_NOT_ALLOWED, "Method not allowed");
+        else
+            httpd_resp_send_err(&req, HTTPD_404_NOT_FOUND, "Not found");
+        return sess_discard(s, aux.body_left);
+    }
+
+    if (uri->is_websocket) {
+        const char *up = find_header(aux.headers, "Upgrade", &vlen);
+        if (up && vlen == 9 && !strncasecmp(up, "websocket", 9))
+            return ws_handshake(srv, s, uri, &req);
+    }
+
+    if (run_handler(srv, s, uri, &req) != ESP_OK)
+        return false;
+    return sess_discard(s, aux.body_left);
+}
+
+static esp_err_t ws_send(int fd, const httpd_ws_frame_t *frame)
+{
+    uint8_t hdr[10];
+    size_t n = 0;
+    hdr[n++] = (uint8_t)((frame->fragmented && !frame->final ? 0 : 0x80) | frame->type);
+    if (frame->len < 126) {
+        hdr[n++] = (uint8_t)frame->len;
+    } else if (frame->len <= 0xffff) {
+        hdr[n++] = 126;
+        hdr[n++] = (uint8_t)(frame->len >> 8);
+        hdr[n++] = (uint8_t)frame->len;
+    } else {
+        hdr[n++] = 127;
+        for (int i = 7; i >= 0; i--)
+            hdr[n++] = (uint8_t)((uint64_t)frame->len >> (i * 8));
+    }
+
+    if (!send_all(fd, hdr, n) ||
+        (frame->len && !send_all(fd, frame->payload, frame->len)))
+        return ESP_FAIL;
+    return ESP_OK;
+}
+
+static bool handle_ws(server *srv, session *s)
+{
+    httpd_req_t req;
+    req_aux aux{};
+    req_init(&req, &aux, srv, s);
+    req.method = 0;    // data frames are not GET; only the handshake is
+
+    uint8_t hdr[2];
+    if (!sess_read(s, hdr, sizeof(hdr)))
+        return false;
+    aux.ws_b0 = hdr[0];
+    aux.ws_b1 = hdr[1];
+    s->lru = ++srv->lru_counter;
+
+    uint8_t opcode = hdr[0] & 0x0f;
+    bool control = opcode & 0x08;
+
+    if (control && !s->ws_uri.handle_ws_control_frames) {
+        // Answered by the server itself, as on target
+        httpd_ws_frame_t frame{};
+        uint8_t payload[125];
+        frame.payload = payload;
+        if (httpd_ws_recv_frame(&req, &frame, 0) != ESP_OK || frame.len > sizeof(payload) ||
+            httpd_ws_recv_frame(&req, &frame, sizeof(payload)) != ESP_OK)
+            return false;
+
+        if (opcode == HTTPD_WS_TYPE_PING) {
+            frame.type = HTTPD_WS_TYPE_PONG;
+        } else if (opcode == HTTPD_WS_TYPE_CLOSE) {
+            frame.len = std::min<size_t>(frame.len, 2);
+        } else {
+            return true;
+        }
+        {
+            std::lock_guard<std::mutex> guard(srv->send_lock);
+            ws_send(s->fd, &frame);
+        }
+        return opcode != HTTPD_WS_TYPE_CLOSE;
+    }
+
+    if (run_handler(srv, s, &s->ws_uri, &req) != ESP_OK)
+        return false;
+
+    // Keep the stream framed even if the handler skipped the payload
+    if (!aux.ws_hdr) {
+        httpd_ws_frame_t frame{};
+        if (httpd_ws_recv_frame(&req, &frame, 0) != ESP_OK)
+            return false;
+    }
+    if (!aux.ws_payload)
+        return sess_discard(s, aux.ws_len);
+    return true;
+}
+
+/* =====================================================
+ *              SERVER THREAD
+ * ===================================================== */
+
+static void run_work(server *srv)
+{
+    char drain[64];
+    while (read(srv->wake[0], drain, sizeof(drain)) > 0) {
+    }
+
+    for (;;) {
+        std::pair<httpd_work_fn_t, void *> item;
+        {
+            std::lock_guard<std::mutex> guard(srv->work_lock);
+            if (srv->work.empty())
+                break;
+            item = srv->work.front();
+            srv->work.pop_front();
+        }
+        item.first(item.second);
+    }
+}
+
+static void *server_loop(void *arg)
+{
+    server *srv = (server *)arg;
+
+    for (;;) {
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        FD_SET(srv->listen_fd, &rfds);
+        FD_SET(srv->wake[0], &rfds);
+        int maxfd = std::max(srv->listen_fd, srv->wake[0]);
+        for (session *s : srv->sessions) {
+            FD_SET(s->fd, &rfds);
+            maxfd = std::max(maxfd, s->fd);
+        }
+
+        if (select(maxfd + 1, &rfds, NULL, NULL, NULL) < 0) {
+            if (errno == EINTR)
+                continue;
+            ESP_LOGE(TAG, "select failed: %s", strerror(errno));
+            break;
+        }
+
+        if (FD_ISSET(srv->wake[0], &rfds))
+            run_work(srv);
+
+        // Snapshot: handlers may close sessions while we iterate
+        std::vector<session *> ready;
+        for (session *s : srv->sessions) {
+            if (s->close_pending || FD_ISSET(s->fd, &rfds))
+                ready.push_back(s);
+        }
+        for (session *s : ready) {
+            bool ok = !s->close_pending;
+            // Process everything already buffered (pipelined requests)
+            do {
+                ok = ok && (s->ws ? handle_ws(srv, s) : handle_http(srv, s));
+            } while (ok && !s->close_pending && !s->inbuf.empty());
+            if (!ok || s->close_pending)
+                sess_close(srv, s);
+        }
+
+        if (FD_ISSET(srv->listen_fd, &rfds))
+            sess_accept(srv);
+    }
+    return NULL;
+}
+
+/* =====================================================
+ *              SERVER API
+ * ===================================================== */
+
+// Port of the last server started, for RC_SIM_PORT=0
+static std::atomic<uint16_t> bound_port{0};
+
+uint16_t host_httpd_port(void)
+{
+    return bound_port;
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    host_sim_boot_delay("httpd_start");
+    server *srv = new server();
+    srv->cfg = *config;
+
+    uint16_t port = config->server_port;
+    if (port == 80) {
+        const char *env = getenv("RC_SIM_PORT");
+        port = env ? (uint16_t)atoi(env) : 8080;
+    }
+
+    srv->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(srv->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(srv->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(srv->listen_fd, config->backlog_conn) != 0) {
+        ESP_LOGE(TAG, "cannot listen on port %u: %s", port, strerror(errno));
+        close(srv->listen_fd);
+        delete srv;
+        return ESP_ERR_HTTPD_TASK;
+    }
+
+    if (pipe(srv->wake) != 0) {
+        close(srv->listen_fd);
+        delete srv;
+        return ESP_ERR_HTTPD_TASK;
+    }
+    fcntl(srv->wake[0], F_SETFL, O_NONBLOCK);
+
+    pthread_create(&srv->thread, NULL, server_loop, srv);
+    pthread_setname_np(srv->thread, "httpd");
+
+    socklen_t alen = sizeof(addr);
+    if (getsockname(srv->listen_fd, (struct sockaddr *)&addr, &alen) == 0)
+        port = ntohs(addr.sin_port);
+    bound_port = port;
+
+    ESP_LOGI(TAG, "listening on http://localhost:%u/", port);
+    *handle = srv;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    // The simulator runs until the process exits
+    (void)handle;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    server *srv = (server *)handle;
+    if (!srv || !uri_handler)
+        return ESP_ERR_INVALID_ARG;
+    if (srv->handlers.size() >= srv->cfg.max_uri_handlers)
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+    for (const auto &h : srv->handlers) {
+        if (h.method == uri_handler->method && !strcmp(h.uri, uri_handler->uri))
+            return ESP_ERR_HTTPD_HANDLER_EXISTS;
+    }
+    srv->handlers.push_back(*uri_handler);
+    return ESP_OK;
+}
+
+bool httpd_uri_match_wildcard(const char *tpl, const char *uri, size_t len)
+{
+    size_t exact = strlen(tpl);
+    bool asterisk = exact > 0 && tpl[exact - 1] == '*';
+    if (asterisk)
+        exact--;
+    bool quest = exact > 0 && tpl[exact - 1] == '?';
+    if (quest)
+        exact--;
+
+    if (asterisk)
+        return len >= exact && !strncmp(tpl, uri, exact);
+    if (quest)
+        return (len == exact || (len == exact + 1 && uri[exact] == tpl[exact])) &&
+               !strncmp(tpl, uri, exact);
+    return len == exact && !strncmp(tpl, uri, exact);
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg)
+{
+    server *srv = (server *)handle;
+    if (!srv || !work)
+        return ESP_ERR_INVALID_ARG;
+    {
+        std::lock_guard<std::mutex> guard(srv->work_lock);
+        srv->work.emplace_back(work, arg);
+    }
+    char one = 1;
+    return write(srv->wake[1], &one, 1) == 1 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t httpd_get_client_list(httpd_handle_t handle, size_t *fds, int *client_fds)
+{
+    server *srv = (server *)handle;
+    if (!srv || !fds || !client_fds)
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> guard(srv->sess_lock);
+    if (srv->sessions.size() > *fds)
+        return ESP_ERR_INVALID_ARG;
+    *fds = srv->sessions.size();
+    for (size_t i = 0; i < *fds; i++)
+        client_fds[i] = srv->sessions[i]->fd;
+    return ESP_OK;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+    server *srv = (server *)handle;
+    std::lock_guard<std::mutex> guard(srv->sess_lock);
+    session *s = sess_find(srv, sockfd);
+    if (!s)
+        return ESP_ERR_NOT_FOUND;
+    s->close_pending = true;
+    char one = 1;
+    return write(srv->wake[1], &one, 1) == 1 ? ESP_OK : ESP_FAIL;
+}
+
+void *httpd_sess_get_ctx(httpd_handle_t handle, int sockfd)
+{
+    server *srv = (server *)handle;
+    std::lock_guard<std::mutex> guard(srv->sess_lock);
+    session *s = sess_find(srv, sockfd);
+    return s ? s->ctx : NULL;
+}
+
+void httpd_sess_set_ctx(httpd_handle_t handle, int sockfd, void *ctx,
+                        httpd_free_ctx_fn_t free_fn)
+{
+    server *srv = (server *)handle;
+    std::lock_guard<std::mutex> guard(srv->sess_lock);
+    session *s = sess_find(srv, sockfd);
+    if (s) {
+        s->ctx = ctx;
+        s->free_ctx = free_fn;
+    }
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+    return r && r->aux ? aux_of(r)->sess->fd : -1;
+}
+
+/* =====================================================
+ *              REQUEST API
+ * ===================================================== */
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field)
+{
+    size_t len = 0;
+    return find_header(aux_of(r)->headers, field, &len) ? len : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field,
+                                      char *val, size_t val_size)
+{
+    size_t len;
+    const char *v = find_header(aux_of(r)->headers, field, &len);
+    if (!v)
+        return ESP_ERR_NOT_FOUND;
+    if (!val || !val_size)
+        return ESP_ERR_INVALID_ARG;
+    snprintf(val, val_size, "%.*s", (int)len, v);
+    return len >= val_size ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    req_aux *aux = aux_of(r);
+    if (!aux->body_left)
+        return 0;
+    ssize_t n = sess_read_some(aux->sess, buf, std::min(buf_len, aux->body_left));
+    if (n > 0)
+        aux->body_left -= (size_t)n;
+    return n == 0 ? HTTPD_SOCK_ERR_FAIL : (int)n;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *r)
+{
+    const char *q = strchr(r->uri, '?');
+    return q ? strlen(q + 1) : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    const char *q = strchr(r->uri, '?');
+    if (!q)
+        return ESP_ERR_NOT_FOUND;
+    snprintf(buf, buf_len, "%s", q + 1);
+    return strlen(q + 1) >= buf_len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val,
+                                size_t val_size)
+{
+    size_t klen = strlen(key);
+    for (const char *p = qry; p && *p; p = strchr(p, '&') ? strchr(p, '&') + 1 : NULL) {
+        if (!strncmp(p, key, klen) && p[klen] == '=') {
+            const char *v = p + klen + 1;
+            size_t len = strcspn(v, "&");
+            snprintf(val, val_size, "%.*s", (int)len, v);
+            return len >= val_size ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+/* =====================================================
+ *              RESPONSE API
+ * ===================================================== */
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+    aux_of(r)->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    aux_of(r)->type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+    req_aux *aux = aux_of(r);
+    if (aux->resp_hdrs.size() >= aux->srv->cfg.max_resp_headers)
+        return ESP_ERR_HTTPD_RESP_HDR;
+    aux->resp_hdrs.emplace_back(field, value);
+    return ESP_OK;
+}
+
+static std::string resp_head(req_aux *aux, const char *framing)
+{
+    std::string head = std::string("HTTP/1.1 ") + aux->status + "\r\n" +
+                       "Content-Type: " + aux->type + "\r\n" + framing;
+    for (const auto &h : aux->resp_hdrs)
+        head += std::string(h.first) + ": " + h.second + "\r\n";
+    return head + "\r\n";
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    req_aux *aux = aux_of(r);
+    if (buf_len == HTTPD_RESP_USE_STRLEN)
+        buf_len = buf ? (ssize_t)strlen(buf) : 0;
+
+    char framing[48];
+    snprintf(framing, sizeof(framing), "Content-Length: %zd\r\n", buf_len);
+    std::string head = resp_head(aux, framing);
+
+    std::lock_guard<std::mutex> guard(aux->srv->send_lock);
+    if (!send_all(aux->sess->fd, head.data(), head.size()) ||
+        (buf_len && !send_all(aux->sess->fd, buf, (size_t)buf_len)))
+        return ESP_ERR_HTTPD_RESP_SEND;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    req_aux *aux = aux_of(r);
+    if (buf_len == HTTPD_RESP_USE_STRLEN)
+        buf_len = buf ? (ssize_t)strlen(buf) : 0;
+
+    std::string out;
+    if (!aux->chunked) {
+        out = resp_head(aux, "Transfer-Encoding: chunked\r\n");
+        aux->chunked = true;
+    }
+
+    char size[16];
+    snprintf(size, sizeof(size), "%zx\r\n", buf_len);
+    out += size;
+    if (buf_len)
+        out.append(buf, (size_t)buf_len);
+    out += "\r\n";
+
+    std::lock_guard<std::mutex> guard(aux->srv->send_lock);
+    return send_all(aux->sess->fd, out.data(), out.size()) ? ESP_OK : ESP_ERR_HTTPD_RESP_SEND;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+    static const char *const status[] = {
+        "400 Bad Request", "404 Not Found", "405 Method Not Allowed",
+        "408 Request Timeout", "411 Length Required", "413 Content Too Large",
+        "500 Internal Server Error",
+    };
+
+    req_aux *aux = aux_of(req);
+    aux->status = status[error];
+    aux->type = "text/html";
+    return httpd_resp_send(req, msg ? msg : aux->status, HTTPD_RESP_USE_STRLEN);
+}
+
+/* =====================================================
+ *              WEBSOCKET API
+ * ===================================================== */
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len)
+{
+    req_aux *aux = aux_of(req);
+    session *s = aux->sess;
+
+    if (!aux->ws_hdr) {
+        uint64_t len = aux->ws_b1 & 0x7f;
+        if (len == 126) {
+            uint8_t ext[2];
+            if (!sess_read(s, ext, sizeof(ext)))
+                return ESP_FAIL;
+            len = (uint64_t)ext[0] << 8 | ext[1];
+        } else if (len == 127) {
+            uint8_t ext[8];
+            if (!sess_read(s, ext, sizeof(ext)))
+                return ESP_FAIL;
+            len = 0;
+            for (uint8_t b : ext)
+                len = len << 8 | b;
+        }
+        if ((aux->ws_b1 & 0x80) && !sess_read(s, aux->ws_mask, sizeof(aux->ws_mask)))
+            return ESP_FAIL;
+
+        aux->ws_len = len;
+        aux->ws_hdr = true;
+    }
+
+    pkt->final = aux->ws_b0 & 0x80;
+    pkt->fragmented = !pkt->final || (aux->ws_b0 & 0x0f) == HTTPD_WS_TYPE_CONTINUE;
+    pkt->type = (httpd_ws_type_t)(aux->ws_b0 & 0x0f);
+    pkt->len = (size_t)aux->ws_len;
+
+    if (max_len == 0)
+        return ESP_OK;
+
+    if (aux->ws_payload)
+        return ESP_ERR_INVALID_STATE;
+    if (pkt->len > max_len) {
+        ESP_LOGW(TAG, "WS message too long (%u > %u)", (unsigned)pkt->len, (unsigned)max_len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!pkt->payload)
+        return ESP_ERR_INVALID_ARG;
+
+    if (!sess_read(s, pkt->payload, pkt->len))
+        return ESP_FAIL;
+    if (aux->ws_b1 & 0x80) {
+        for (size_t i = 0; i < pkt->len; i++)
+            pkt->payload[i] ^= aux->ws_mask[i & 3];
+    }
+    aux->ws_payload = true;
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *pkt)
+{
+    req_aux *aux = aux_of(req);
+    std::lock_guard<std::mutex> guard(aux->srv->send_lock);
+    return ws_send(aux->sess->fd, pkt);
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+    server *srv = (server *)hd;
+    std::lock_guard<std::mutex> sess_guard(srv->sess_lock);
+    session *s = sess_find(srv, fd);
+    if (!s || !s->ws)
+        return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::mutex> send_guard(srv->send_lock);
+    return ws_send(fd, frame);
+}
+
+esp_err_t httpd_ws_send_data_async(httpd_handle_t handle, int socket,
+                                   httpd_ws_frame_t *frame,
+                                   transfer_complete_cb callback, void *arg)
+{
+    esp_err_t err = httpd_ws_send_frame_async(handle, socket, frame);
+    if (callback)
+        callback(err, socket, arg);
+    return err;
+}
+
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd)
+{
+    server *srv = (server *)hd;
+    std::lock_guard<std::mutex> guard(srv->sess_lock);
+    session *s = sess_find(srv, fd);
+    if (!s)
+        return HTTPD_WS_CLIENT_INVALID;
+    return s->ws ? HTTPD_WS_CLIENT_WEBSOCKET : HTTPD_WS_CLIENT_HTTP;
+}
@@ -0,0 +1,260 @@
+/*
+ * In-memory NVS: namespaces of typed entries behind one mutex. Name, key
+ * and type checks follow the IDF implementation so misuse fails the same
+ * way. Values survive nvs_close() but not the process, unless
+ * RC_SIM_NVS_FILE names a file: it is loaded by nvs_flash_init() and
+ * rewritten by every nvs_commit(), like flash across reboots.
+ */
+
+#include "nvs_flash.h"
+#include "host_hal.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum class nvs_type : uint8_t { I8, U8, I16, U16, I32, U32, STR, BLOB };
+
+typedef struct {
+    nvs_type type;
+    std::vector<uint8_t> data;
+} entry_t;
+
+typedef std::map<std::string, entry_t> namespace_t;
+
+typedef struct {
+    std::string ns;
+    bool writable;
+} open_handle_t;
+
+static std::mutex lock;
+static std::map<std::string, namespace_t> store;
+static std::map<nvs_handle_t, open_handle_t> handles;
+static nvs_handle_t next_handle = 1;
+
+/* =====================================================
+ *              FLASH
+ * =====================================================
+ *
+ * File format: one "<namespace> <key> <type> <hex bytes>" line per entry.
+ */
+
+// Caller holds lock
+static void save_file(void)
+{
+    const char *path = getenv("RC_SIM_NVS_FILE");
+    if (!path || !*path)
+        return;
+
+    std::string tmp = std::string(path) + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "w");
+    if (!f)
+        return;
+    for (const auto &ns : store) {
+        for (const auto &e : ns.second) {
+            fprintf(f, "%s %s %u ", ns.first.c_str(), e.first.c_str(),
+                    (unsigned)e.second.type);
+            for (uint8_t b : e.second.data)
+                fprintf(f, "%02x", b);
+            fputc('\n', f);
+        }
+    }
+    if (fclose(f) == 0)
+        rename(tmp.c_str(), path);
+}
+
+// Caller holds lock
+static void load_file(void)
+{
+    const char *path = getenv("RC_SIM_NVS_FILE");
+    FILE *f = path && *path ? fopen(path, "r") : NULL;
+    if (!f)
+        return;
+
+    char ns[NVS_KEY_NAME_MAX_SIZE], key[NVS_KEY_NAME_MAX_SIZE];
+    unsigned type;
+    static char hex[8192];
+    while (fscanf(f, "%15s %15s %u %8191s", ns, key, &type, hex) == 4) {
+        entry_t e{(nvs_type)type, {}};
+        for (const char *p = hex; p[0] && p[1]; p += 2)
+            e.data.push_back((uint8_t)strtoul(std::string(p, 2).c_str(), NULL, 16));
+        store[ns][key] = e;
+    }
+    fclose(f);
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    host_sim_boot_delay("nvs_init");
+    std::lock_guard<std::mutex> guard(lock);
+    static bool loaded = false;
+    if (!loaded)
+        load_file();
+    loaded = true;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    store.clear();
+    save_file();
+    return ESP_OK;
+}
+
+/* =====================================================
+ *              HANDLES
+ * ===================================================== */
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (!name || strlen(name) >= NVS_KEY_NAME_MAX_SIZE)
+        return ESP_ERR_NVS_INVALID_NAME;
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (open_mode == NVS_READONLY && !store.count(name))
+        return ESP_ERR_NVS_NOT_FOUND;
+
+    store[name];
+    *out_handle = next_handle++;
+    handles[*out_handle] = {name, open_mode == NVS_READWRITE};
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    handles.erase(handle);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!handles.count(handle))
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    save_file();
+    return ESP_OK;
+}
+
+// Caller holds lock
+static esp_err_t lookup(nvs_handle_t handle, const char *key, bool write,
+                        namespace_t **ns)
+{
+    auto h = handles.find(handle);
+    if (h == handles.end())
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    if (write && !h->second.writable)
+        return ESP_ERR_NVS_READ_ONLY;
+    if (key && strlen(key) >= NVS_KEY_NAME_MAX_SIZE)
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    *ns = &store[h->second.ns];
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    namespace_t *ns;
+    esp_err_t err = lookup(handle, key, true, &ns);
+    if (err != ESP_OK)
+        return err;
+    return ns->erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    namespace_t *ns;
+    esp_err_t err = lookup(handle, NULL, true, &ns);
+    if (err != ESP_OK)
+        return err;
+    ns->clear();
+    return ESP_OK;
+}
+
+/* =====================================================
+ *              VALUES
+ * ===================================================== */
+
+static esp_err_t set_raw(nvs_handle_t handle, const char *key, nvs_type type,
+                         const void *data, size_t len)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    namespace_t *ns;
+    esp_err_t err = lookup(handle, key, true, &ns);
+    if (err != ESP_OK)
+        return err;
+    const uint8_t *p = (const uint8_t *)data;
+    (*ns)[key] = {type, std::vector<uint8_t>(p, p + len)};
+    return ESP_OK;
+}
+
+// Fixed-size get when len is NULL, variable-size (str/blob) otherwise
+static esp_err_t get_raw(nvs_handle_t handle, const char *key, nvs_type type,
+                         void *out, size_t size, size_t *len)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    namespace_t *ns;
+    esp_err_t err = lookup(handle, key, false, &ns);
+    if (err != ESP_OK)
+        return err;
+
+    auto e = ns->find(key);
+    if (e == ns->end())
+        return ESP_ERR_NVS_NOT_FOUND;
+    if (e->second.type != type)
+        return ESP_ERR_NVS_TYPE_MISMATCH;
+
+    const std::vector<uint8_t> &d = e->second.data;
+    if (len) {
+        if (out && *len < d.size())
+            return ESP_ERR_NVS_INVALID_LENGTH;
+        if (out)
+            memcpy(out, d.data(), d.size());
+        *len = d.size();
+    } else {
+        memcpy(out, d.data(), size);
+    }
+    return ESP_OK;
+}
+
+#define NVS_INT(suffix, ctype, tag)                                                  \
+    esp_err_t nvs_set_##suffix(nvs_handle_t handle, const char *key, ctype value)    \
+    {                                                                                \
+        return set_raw(handle, key, nvs_type::tag, &value, sizeof(value));           \
+    }                                                                                \
+    esp_err_t nvs_get_##suffix(nvs_handle_t handle, const char *key, ctype *out)     \
+    {                                                                                \
+        return get_raw(handle, key, nvs_type::tag, out, sizeof(*out), NULL);         \
+    }
+
+NVS_INT(i8, int8_t, I8)
+NVS_INT(u8, uint8_t, U8)
+NVS_INT(i16, int16_t, I16)
+NVS_INT(u16, uint16_t, U16)
+NVS_INT(i32, int32_t, I32)
+NVS_INT(u32, uint32_t, U32)
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return set_raw(handle, key, nvs_type::STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return set_raw(handle, key, nvs_type::BLOB, value, length);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    return get_raw(handle, key, nvs_type::STR, out_value, 0, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return get_raw(handle, key, nvs_type::BLOB, out_value, 0, length);
+}
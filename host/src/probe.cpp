@@ -0,0 +1,81 @@
+/*
+ * Output probe for external tools (tools/ws_bench.py): every LEDC duty
+ * change the firmware issues, and every command the control task
+ * applies, is sent as one UDP datagram.
+ */
+
+#include "host_hal.h"
+#include "esp_log.h"
+#include "latency_trace.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char *TAG = "probe";
+
+static int probe_fd = -1;
+static struct sockaddr_in probe_addr;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void send_line(const char *line, int n)
+{
+    sendto(probe_fd, line, (size_t)n, MSG_DONTWAIT,
+           (struct sockaddr *)&probe_addr, sizeof(probe_addr));
+}
+
+static void on_ledc(int channel, uint32_t duty, uint32_t fade_ms, void *arg)
+{
+    (void)arg;
+    char line[80];
+    int n = snprintf(line, sizeof(line), "ledc %lld %d %u %u\n",
+                     now_ns(), channel, (unsigned)duty, (unsigned)fade_ms);
+    send_line(line, n);
+}
+
+static void on_applied(uint16_t seq, uint32_t total_us)
+{
+    char line[80];
+    int n = snprintf(line, sizeof(line), "applied %lld %u %u\n",
+                     now_ns(), (unsigned)seq, (unsigned)total_us);
+    send_line(line, n);
+}
+
+void host_probe_init(void)
+{
+    const char *env = getenv("RC_SIM_PROBE");
+    if (!env)
+        return;
+
+    char host[64];
+    const char *colon = strrchr(env, ':');
+    if (!colon || colon - env >= (int)sizeof(host)) {
+        ESP_LOGW(TAG, "RC_SIM_PROBE must be host:port, got \"%s\"", env);
+        return;
+    }
+    snprintf(host, sizeof(host), "%.*s", (int)(colon - env), env);
+
+    memset(&probe_addr, 0, sizeof(probe_addr));
+    probe_addr.sin_family = AF_INET;
+    probe_addr.sin_port = htons((uint16_t)atoi(colon + 1));
+    if (inet_pton(AF_INET, host, &probe_addr.sin_addr) != 1) {
+        ESP_LOGW(TAG, "bad probe address \"%s\"", host);
+        return;
+    }
+
+    probe_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    host_hal_set_ledc_observer(on_ledc, NULL);
+    trace_set_applied_callback(on_applied);
+    ESP_LOGI(TAG, "LEDC and applied-command events -> udp://%s", env);
+}
@@ -0,0 +1,333 @@
+/*
+ * Logging, error names, random numbers and the services that have no
+ * host equivalent (LittleFS mount, Wi-Fi, netif, default event loop).
+ * NVS is in nvs.cpp.
+ */
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_heap_caps.h"
+#include "esp_littlefs.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_random.h"
+#include "esp_wifi.h"
+#include "nvs.h"
+#include "host_hal.h"
+
+#include <malloc.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/random.h>
+#include <unistd.h>
+
+static const char *TAG = "host";
+
+/* =====================================================
+ *              LOGGING
+ * ===================================================== */
+
+static esp_log_level_t log_level(void)
+{
+    static const esp_log_level_t level = [] {
+        const char *env = getenv("RC_SIM_LOG_LEVEL");
+        return env ? (esp_log_level_t)atoi(env) : ESP_LOG_INFO;
+    }();
+    return level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    (void)tag;
+    if (level > log_level())
+        return;
+
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    va_list ap;
+    va_start(ap, format);
+    pthread_mutex_lock(&lock);
+    vfprintf(stderr, format, ap);
+    pthread_mutex_unlock(&lock);
+    va_end(ap);
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    (void)tag;
+    (void)level;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+    case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+    case ESP_ERR_NVS_TYPE_MISMATCH: return "ESP_ERR_NVS_TYPE_MISMATCH";
+    case ESP_ERR_NVS_READ_ONLY: return "ESP_ERR_NVS_READ_ONLY";
+    case ESP_ERR_NVS_INVALID_NAME: return "ESP_ERR_NVS_INVALID_NAME";
+    case ESP_ERR_NVS_INVALID_HANDLE: return "ESP_ERR_NVS_INVALID_HANDLE";
+    case ESP_ERR_NVS_KEY_TOO_LONG: return "ESP_ERR_NVS_KEY_TOO_LONG";
+    case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+/* =====================================================
+ *              HEAP
+ * =====================================================
+ *
+ * glibc has no notion of a largest free block; the biggest free chunk
+ * it tracks outside the top of the heap is the closest analogue.
+ */
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    (void)caps;
+    return mallinfo2().fordblks;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    static size_t low_water = (size_t)-1;
+    size_t now = heap_caps_get_free_size(caps);
+    if (now < low_water)
+        low_water = now;
+    return low_water;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    (void)caps;
+    struct mallinfo2 mi = mallinfo2();
+    return mi.fordblks - mi.fsmblks;
+}
+
+/* =====================================================
+ *              RANDOM
+ * ===================================================== */
+
+void esp_fill_random(void *buf, size_t len)
+{
+    uint8_t *p = (uint8_t *)buf;
+    while (len) {
+        ssize_t n = getrandom(p, len, 0);
+        if (n <= 0)
+            continue;   // EINTR; the entropy pool is long initialised
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+uint32_t esp_random(void)
+{
+    uint32_t v;
+    esp_fill_random(&v, sizeof(v));
+    return v;
+}
+
+/* =====================================================
+ *              BOOT TIMING
+ * =====================================================
+ *
+ * Rough ESP32 (240 MHz, 4 MB flash) figures; the host itself takes
+ * next to no time for any of these.
+ */
+
+static const struct {
+    const char *step;
+    uint32_t typical_ms;
+} boot_steps[] = {
+    {"nvs_init", 25},
+    {"fs_mount", 180},
+    {"wifi_init", 70},
+    {"wifi_start", 90},
+    {"scan_channel", 60},
+    {"httpd_start", 5},
+};
+
+void host_sim_boot_delay(const char *step)
+{
+    const char *env = getenv("RC_SIM_BOOT_MS");
+    if (!env)
+        return;
+
+    uint32_t ms = 0;
+    size_t len = strlen(step);
+    for (const char *p = env; *p;) {
+        size_t n = strcspn(p, ",");
+        if (n == 7 && !strncmp(p, "typical", 7)) {
+            for (const auto &b : boot_steps) {
+                if (!strcmp(b.step, step))
+                    ms = b.typical_ms;
+            }
+        } else if (n > len && p[len] == '=' && !strncmp(p, step, len)) {
+            ms = (uint32_t)strtoul(p + len + 1, NULL, 10);
+        }
+        p += n;
+        if (*p == ',')
+            p++;
+    }
+    if (ms)
+        usleep(ms * 1000);
+}
+
+/* =====================================================
+ *              STORAGE
+ * ===================================================== */
+
+esp_err_t esp_vfs_littlefs_register(const esp_vfs_littlefs_conf_t *conf)
+{
+    host_sim_boot_delay("fs_mount");
+    ESP_LOGI(TAG, "LittleFS %s not mounted; serving the staged web root", conf->base_path);
+    return ESP_OK;
+}
+
+esp_err_t esp_vfs_littlefs_unregister(const char *partition_label)
+{
+    (void)partition_label;
+    return ESP_OK;
+}
+
+/* =====================================================
+ *              NETWORK
+ * ===================================================== */
+
+esp_event_base_t const WIFI_EVENT = "WIFI_EVENT";
+
+esp_err_t esp_netif_init(void)
+{
+    return ESP_OK;
+}
+
+esp_netif_t *esp_netif_create_default_wifi_ap(void)
+{
+    return NULL;
+}
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t base, int32_t id,
+                                     esp_event_handler_t handler, void *arg)
+{
+    (void)base;
+    (void)id;
+    (void)handler;
+    (void)arg;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    (void)config;
+    host_sim_boot_delay("wifi_init");
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    (void)mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    (void)interface;
+    ESP_LOGI(TAG, "Wi-Fi AP \"%.*s\" simulated on channel %u (max %u clients%s)",
+             (int)strnlen((const char *)conf->ap.ssid, sizeof(conf->ap.ssid)),
+             (const char *)conf->ap.ssid, conf->ap.channel, conf->ap.max_connection,
+             conf->ap.authmode == WIFI_AUTH_OPEN ? "" : ", WPA2");
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    host_sim_boot_delay("wifi_start");
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type)
+{
+    (void)type;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_max_tx_power(int8_t power)
+{
+    return power >= 8 && power <= 84 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_wifi_set_bandwidth(wifi_interface_t ifx, wifi_bandwidth_t bw)
+{
+    (void)ifx;
+    (void)bw;
+    return ESP_OK;
+}
+
+// Simulated neighbourhood from RC_SIM_WIFI_SCAN ("ch:rssi,ch:rssi")
+static uint16_t scan_records(wifi_ap_record_t *out, uint16_t max)
+{
+    const char *env = getenv("RC_SIM_WIFI_SCAN");
+    uint16_t n = 0;
+    for (const char *p = env; p && *p && n < max;) {
+        int ch, rssi, used = 0;
+        if (sscanf(p, "%d:%d%n", &ch, &rssi, &used) != 2)
+            break;
+        if (out) {
+            memset(&out[n], 0, sizeof(out[n]));
+            snprintf((char *)out[n].ssid, sizeof(out[n].ssid), "sim-ap-%u", (unsigned)n);
+            out[n].primary = (uint8_t)ch;
+            out[n].rssi = (int8_t)rssi;
+        }
+        n++;
+        p += used;
+        if (*p == ',')
+            p++;
+    }
+    return n;
+}
+
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t *config, bool block)
+{
+    (void)config;
+    (void)block;
+    for (int ch = 1; ch <= 13; ch++)
+        host_sim_boot_delay("scan_channel");
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_get_ap_num(uint16_t *number)
+{
+    *number = scan_records(NULL, UINT16_MAX);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_get_ap_records(uint16_t *number, wifi_ap_record_t *ap_records)
+{
+    *number = scan_records(ap_records, *number);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t *sta)
+{
+    memset(sta, 0, sizeof(*sta));
+    return ESP_OK;
+}
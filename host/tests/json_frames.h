@@ -0,0 +1,27 @@
+#pragma once
+
+/*
+ * JSON control frames as the web UI sends them (data/index.html in JSON
+ * mode, captured through tools/ui_bench.js), plus the legacy set/steer
+ * commands older clients still use. Shared by the parser fuzz test and
+ * the decode benchmark.
+ */
+
+static const char *const captured_frames[] = {
+    "{\"cmd\":\"hello\",\"proto\":\"bin\"}",
+    "{\"cmd\":\"hello\",\"proto\":\"json\"}",
+    "{\"cmd\":\"drive\",\"speed\":6,\"steer\":10,\"seq\":23}",
+    "{\"cmd\":\"drive\",\"speed\":7,\"steer\":-0.3,\"seq\":48}",
+    "{\"cmd\":\"drive\",\"speed\":0,\"steer\":-9.586,\"seq\":73}",
+    "{\"cmd\":\"drive\",\"speed\":-6,\"steer\":0.996,\"seq\":98}",
+    "{\"cmd\":\"drive\",\"speed\":-7,\"steer\":6.06,\"seq\":123}",
+    "{\"cmd\":\"ping\"}",
+    "{\"cmd\":\"move\",\"dir\":\"stop\"}",
+    "{\"cmd\":\"move\",\"dir\":\"brake\"}",
+    "{\"cmd\":\"move\",\"dir\":\"forward\",\"speed\":5}",
+    "{\"cmd\":\"metrics\"}",
+    "{\"cmd\":\"set\",\"value\":7}",
+    "{\"cmd\":\"steer\",\"angle\":-4}",
+};
+
+#define CAPTURED_FRAME_COUNT (sizeof(captured_frames) / sizeof(captured_frames[0]))
@@ -0,0 +1,191 @@
+// Config store: range checks, optimistic versioning, NVS persistence and
+// listener notification, directly and through POST /config, which also
+// needs the config token and refuses writes while a controller drives.
+
+#include "test_support.h"
+
+#include "app_config.h"
+#include "esp_timer.h"
+#include "failsafe.h"
+#include "motor_control.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+
+static int notified = 0;
+static app_config_t last_notified;
+
+static void on_update(const app_config_t *cfg)
+{
+    notified++;
+    last_notified = *cfg;
+}
+
+static esp_err_t update(const char *json, bool *reboot = NULL)
+{
+    char err[64];
+    return app_config_update_json(json, strlen(json), err, sizeof(err), reboot);
+}
+
+static void test_range_rejection(void)
+{
+    app_config_t before, after;
+    app_config_get(&before);
+    app_config_stats_t s0, s1;
+    app_config_get_stats(&s0);
+
+    CHECK_EQ(update("{\"accel_ms\":5001}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(update("{\"accel_ms\":-1}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(update("{\"accel_ms\":1.5}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(update("{\"accel_ms\":\"250\"}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(update("{\"lf_pwm\":34}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(update("{\"ssid\":\"\"}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(update("{\"no_such_key\":1}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(update("[1,2]"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(update("{\"accel_ms\":"), ESP_ERR_INVALID_ARG);
+
+    // One bad member rejects the valid ones next to it
+    CHECK_EQ(update("{\"decel_ms\":100,\"accel_ms\":9999}"), ESP_ERR_INVALID_ARG);
+
+    app_config_get(&after);
+    app_config_get_stats(&s1);
+    CHECK_EQ(after.version, before.version);
+    CHECK_EQ(after.accel_ms, before.accel_ms);
+    CHECK_EQ(after.decel_ms, before.decel_ms);
+    CHECK_EQ(s1.rejected - s0.rejected, 10);
+    CHECK_EQ(notified, 0);
+}
+
+static void test_versioning_and_listeners(void)
+{
+    bool reboot = true;
+    CHECK_EQ(update("{\"version\":0,\"accel_ms\":250}", &reboot), ESP_OK);
+    CHECK(!reboot);
+    CHECK_EQ(notified, 1);
+    CHECK_EQ(last_notified.version, 1);
+    CHECK_EQ(last_notified.accel_ms, 250);
+
+    // Same values: accepted, but nothing changes and nobody is told
+    CHECK_EQ(update("{\"accel_ms\":250}"), ESP_OK);
+    CHECK_EQ(notified, 1);
+
+    // An editor still holding version 0 is refused
+    CHECK_EQ(update("{\"version\":0,\"accel_ms\":300}"), ESP_ERR_INVALID_VERSION);
+    CHECK_EQ(update("{\"version\":\"1\",\"accel_ms\":300}"), ESP_ERR_INVALID_VERSION);
+    CHECK_EQ(notified, 1);
+
+    app_config_t cfg;
+    app_config_get(&cfg);
+    CHECK_EQ(cfg.version, 1);
+    CHECK_EQ(cfg.accel_ms, 250);
+
+    // Boot fields are stored but flag a restart
+    CHECK_EQ(update("{\"version\":1,\"pwm_freq_hz\":20000}", &reboot), ESP_OK);
+    CHECK(reboot);
+    CHECK_EQ(notified, 2);
+    CHECK_EQ(last_notified.version, 2);
+}
+
+static void test_nvs_round_trip(void)
+{
+    CHECK_EQ(update("{\"decel_ms\":400,\"ssid\":\"car \\\"7\\\"\",\"password\":\"secret99\"}"),
+             ESP_OK);
+    app_config_t stored;
+    app_config_get(&stored);
+
+    // Reload from NVS as a reboot would
+    app_config_init();
+    app_config_t loaded;
+    app_config_get(&loaded);
+    CHECK_EQ(loaded.version, stored.version);
+    CHECK_EQ(loaded.accel_ms, 250);
+    CHECK_EQ(loaded.decel_ms, 400);
+    CHECK_EQ(loaded.pwm_freq_hz, 20000);
+    CHECK(strcmp(loaded.ssid, "car \"7\"") == 0);
+    CHECK(strcmp(loaded.password, "secret99") == 0);
+
+    // The password is write-only; the ssid comes back escaped
+    char json[APP_CONFIG_JSON_MAX];
+    app_config_to_json(&loaded, json, sizeof(json));
+    CHECK(strstr(json, "secret99") == NULL);
+    CHECK(strstr(json, "\"ssid\":\"car \\\"7\\\"\"") != NULL);
+
+    // An out-of-range value written behind the store's back keeps the default
+    nvs_handle_t h;
+    CHECK_EQ(nvs_open(APP_CONFIG_NVS_NAMESPACE, NVS_READWRITE, &h), ESP_OK);
+    CHECK_EQ(nvs_set_u16(h, "accel_ms", 9000), ESP_OK);
+    nvs_commit(h);
+    nvs_close(h);
+
+    app_config_stats_t s0, s1;
+    app_config_get_stats(&s0);
+    app_config_init();
+    app_config_get_stats(&s1);
+    app_config_get(&loaded);
+    CHECK_EQ(loaded.accel_ms, MOTOR_ACCEL_MS);
+    CHECK_EQ(loaded.decel_ms, 400);
+    CHECK_EQ(s1.nvs_errors - s0.nvs_errors, 1);
+}
+
+static void test_http_status(void)
+{
+    // An open AP: the token is a random one shown only on the console
+    CHECK_EQ(update("{\"password\":\"\"}"), ESP_OK);
+    uint16_t port = test_start_server();
+    CHECK(port != 0);
+
+    app_config_t cfg;
+    app_config_get(&cfg);
+    int before = notified;
+
+    std::string resp;
+    CHECK_EQ(test_http(port, "GET", "/config", "", &resp), 200);
+    char expect[32];
+    snprintf(expect, sizeof(expect), "\"config\":{\"version\":%u,", (unsigned)cfg.version);
+    CHECK(resp.find(expect) != std::string::npos);
+
+    char body[64];
+    snprintf(body, sizeof(body), "{\"version\":%u,\"accel_ms\":100}", (unsigned)cfg.version);
+    CHECK_EQ(test_http(port, "POST", "/config", body), 403);
+    CHECK_EQ(test_http(port, "POST", "/config", body, NULL, "X-Config-Token: \r\n"), 403);
+    CHECK_EQ(notified, before);
+
+    // With a password set, the password is the token, exactly
+    CHECK_EQ(update("{\"password\":\"letmein99\"}"), ESP_OK);
+    app_config_get(&cfg);
+    before = notified;
+    static const char token[] = "X-Config-Token: letmein99\r\n";
+    snprintf(body, sizeof(body), "{\"version\":%u,\"accel_ms\":100}", (unsigned)cfg.version);
+    CHECK_EQ(test_http(port, "POST", "/config", body, NULL, "X-Config-Token: letmein9\r\n"), 403);
+    CHECK_EQ(test_http(port, "POST", "/config", body, NULL, "X-Config-Token: letmein999\r\n"), 403);
+
+    CHECK_EQ(test_http(port, "POST", "/config", "{\"version\":0,\"accel_ms\":100}", NULL, token), 409);
+    CHECK_EQ(test_http(port, "POST", "/config", "{\"accel_ms\":70000}", NULL, token), 400);
+    CHECK_EQ(notified, before);
+
+    // Never while a controller is driving, token or not
+    failsafe_feed();
+    CHECK(failsafe_armed());
+    CHECK_EQ(test_http(port, "POST", "/config", body, &resp, token), 423);
+    CHECK(resp.find("drive session active") != std::string::npos);
+    CHECK_EQ(notified, before);
+
+    // Once the watchdog has tripped, the car is free to configure again
+    CHECK(failsafe_poll(esp_timer_get_time() + 10000000));
+    CHECK(!failsafe_armed());
+    CHECK_EQ(test_http(port, "POST", "/config", body, NULL, token), 200);
+    CHECK_EQ(notified, before + 1);
+    CHECK_EQ(last_notified.accel_ms, 100);
+}
+
+int main(void)
+{
+    nvs_flash_init();
+    app_config_init();
+    app_config_subscribe(on_update);
+
+    test_range_rejection();
+    test_versioning_and_listeners();
+    test_nvs_round_trip();
+    test_http_status();
+    test_exit("test_app_config");
+}
@@ -0,0 +1,244 @@
+// Asset cache backed by a temporary directory: hits and misses, LRU
+// eviction within the byte budget, remembered misses, oversized files,
+// ETags and static entries. Then wildcard routing through the server
+// and the background mount.
+
+#include "test_support.h"
+
+#include "asset_cache.h"
+
+#include <atomic>
+
+#include <pthread.h>
+#include <sys/stat.h>
+
+static char root[64];
+
+static void write_file(const char *name, size_t size, char fill)
+{
+    std::string path = std::string(root) + name;
+    FILE *f = fopen(path.c_str(), "w");
+    std::string data(size, fill);
+    fwrite(data.data(), 1, size, f);
+    fclose(f);
+}
+
+static asset_cache_stats_t stats(void)
+{
+    asset_cache_stats_t s;
+    asset_cache_get_stats(&s);
+    return s;
+}
+
+static void test_hits_and_misses(void)
+{
+    asset_cache_init(root, 1000);
+    write_file("/a.js", 100, 'a');
+
+    asset_t a;
+    CHECK_EQ(asset_cache_get("/a.js", &a), ASSET_OK);
+    CHECK_EQ(a.size, 100);
+    CHECK_EQ(a.data[0], 'a');
+    CHECK_EQ(stats().misses, 1);
+    CHECK_EQ(stats().hits, 0);
+
+    // Served from RAM: changing the file does not change the answer
+    write_file("/a.js", 100, 'b');
+    asset_t again;
+    CHECK_EQ(asset_cache_get("/a.js", &again), ASSET_OK);
+    CHECK(again.data == a.data);
+    CHECK_EQ(again.data[0], 'a');
+    CHECK_EQ(stats().hits, 1);
+    CHECK_EQ(stats().bytes, 100);
+
+    // Missing files are remembered, so probing ".br" costs one stat
+    asset_t x;
+    CHECK_EQ(asset_cache_get("/a.js.br", &x), ASSET_NOT_FOUND);
+    CHECK_EQ(asset_cache_get("/a.js.br", &x), ASSET_NOT_FOUND);
+    CHECK_EQ(stats().misses, 2);
+    CHECK_EQ(stats().hits, 2);
+    CHECK_EQ(stats().entries, 2);
+    CHECK_EQ(stats().bytes, 100);
+}
+
+static void test_etag(void)
+{
+    asset_cache_init(root, 1000);
+    write_file("/e1", 50, 'x');
+    write_file("/e2", 50, 'x');
+    write_file("/e3", 50, 'y');
+
+    asset_t e1, e2, e3;
+    CHECK_EQ(asset_cache_get("/e1", &e1), ASSET_OK);
+    std::string t1 = e1.etag;
+    CHECK_EQ(asset_cache_get("/e2", &e2), ASSET_OK);
+    std::string t2 = e2.etag;
+    CHECK_EQ(asset_cache_get("/e3", &e3), ASSET_OK);
+
+    // Strong, quoted, and a function of the content only
+    CHECK(t1.size() > 2 && t1.front() == '"' && t1.back() == '"');
+    CHECK(t1 == t2);
+    CHECK(t1 != e3.etag);
+}
+
+static void test_lru_budget(void)
+{
+    asset_cache_init(root, 250);
+    write_file("/1", 100, '1');
+    write_file("/2", 100, '2');
+    write_file("/3", 100, '3');
+
+    asset_t a;
+    CHECK_EQ(asset_cache_get("/1", &a), ASSET_OK);
+    CHECK_EQ(asset_cache_get("/2", &a), ASSET_OK);
+    CHECK_EQ(asset_cache_get("/1", &a), ASSET_OK);     // 2 is now least recent
+
+    // 3 does not fit next to both: 2 goes, 1 stays
+    CHECK_EQ(asset_cache_get("/3", &a), ASSET_OK);
+    CHECK_EQ(stats().evictions, 1);
+    CHECK_EQ(stats().bytes, 200);
+
+    uint32_t misses = stats().misses;
+    CHECK_EQ(asset_cache_get("/1", &a), ASSET_OK);
+    CHECK_EQ(stats().misses, misses);
+    CHECK_EQ(asset_cache_get("/2", &a), ASSET_OK);
+    CHECK_EQ(stats().misses, misses + 1);
+    CHECK(stats().bytes <= 250);
+
+    // Larger than the whole budget: never cached, streamed by the server
+    write_file("/big", 251, 'b');
+    CHECK_EQ(asset_cache_get("/big", &a), ASSET_TOO_LARGE);
+    CHECK(stats().bytes <= 250);
+}
+
+static void test_entry_limit(void)
+{
+    asset_cache_init(root, 100000);
+    char name[16];
+    for (int i = 0; i < ASSET_CACHE_MAX_ENTRIES + 4; i++) {
+        snprintf(name, sizeof(name), "/n%d", i);
+        write_file(name, 10, 'n');
+        asset_t a;
+        CHECK_EQ(asset_cache_get(name, &a), ASSET_OK);
+    }
+    CHECK_EQ(stats().entries, ASSET_CACHE_MAX_ENTRIES);
+    CHECK_EQ(stats().evictions, 4);
+    CHECK_EQ(stats().bytes, ASSET_CACHE_MAX_ENTRIES * 10);
+
+    // Any path the server accepts fits an entry
+    std::string fits = "/" + std::string(ASSET_PATH_MAX - 2, 'p');
+    write_file(fits.c_str(), 10, 'p');
+    asset_t a;
+    CHECK_EQ(asset_cache_get(fits.c_str(), &a), ASSET_OK);
+
+    // Longer ones are left to stream, not looked up under a truncated name
+    std::string too_long = fits + "q";
+    write_file(too_long.c_str(), 10, 'q');
+    uint32_t entries = stats().entries;
+    CHECK_EQ(asset_cache_get(too_long.c_str(), &a), ASSET_UNCACHED);
+    CHECK_EQ(asset_cache_get((too_long + "r").c_str(), &a), ASSET_NOT_FOUND);
+    CHECK_EQ(stats().entries, entries);
+}
+
+static void test_static(void)
+{
+    asset_cache_init(root, 1000);
+    write_file("/s.gz", 10, 'f');
+    static const uint8_t image[] = {1, 2, 3, 4};
+    CHECK(asset_cache_add_static("/s.gz", image, sizeof(image)));
+
+    // The image copy wins and costs neither RAM nor a filesystem read
+    asset_t a;
+    CHECK_EQ(asset_cache_get("/s.gz", &a), ASSET_OK);
+    CHECK(a.data == image);
+    CHECK_EQ(stats().static_hits, 1);
+    CHECK_EQ(stats().misses, 0);
+    CHECK_EQ(stats().bytes, 0);
+    CHECK_EQ(asset_cache_get_static("/other", &a), ASSET_NOT_FOUND);
+
+    for (int i = 1; i < ASSET_CACHE_MAX_STATIC; i++)
+        CHECK(asset_cache_add_static("/more", image, sizeof(image)));
+    CHECK(!asset_cache_add_static("/full", image, sizeof(image)));
+}
+
+static void test_routing(uint16_t port)
+{
+    struct stat st;
+    CHECK_EQ(stat(WEB_ROOT "/index.html", &st), 0);
+
+    std::string body;
+    CHECK_EQ(test_http(port, "GET", "/index.html", "", &body), 200);
+    CHECK_EQ(body.size(), (size_t)st.st_size);
+    CHECK_EQ(test_http(port, "GET", "/", "", &body), 200);
+    CHECK_EQ(body.size(), (size_t)st.st_size);
+    CHECK_EQ(test_http(port, "GET", "/index.html?v=2", "", &body), 200);
+    CHECK_EQ(test_http(port, "GET", "/missing.js", "", NULL), 404);
+    CHECK_EQ(test_http(port, "GET", "/../CMakeCache.txt", "", NULL), 404);
+}
+
+static std::atomic<bool> mount_release{false};
+static std::atomic<bool> mount_ran{false};
+static pthread_t mount_thread;
+
+static bool slow_mount(void)
+{
+    mount_thread = pthread_self();
+    mount_ran = true;
+    while (!mount_release)
+        test_sleep_ms(1);
+    return true;
+}
+
+static void test_mount_async(void)
+{
+    asset_cache_init(root, 1000);
+    write_file("/late.js", 20, 'l');
+
+    // The hook runs on its own task; lookups neither wait nor remember
+    asset_cache_mount_async(slow_mount);
+    CHECK(test_wait_until([] { return mount_ran.load(); }, 2000));
+    CHECK(!pthread_equal(mount_thread, pthread_self()));
+    CHECK(!stats().fs_mounted);
+
+    asset_t a;
+    CHECK_EQ(asset_cache_get("/late.js", &a), ASSET_NOT_FOUND);
+    CHECK_EQ(asset_cache_get("/late.js", &a), ASSET_NOT_FOUND);
+    CHECK_EQ(stats().fs_deferred, 2);
+    CHECK_EQ(stats().misses, 0);
+    CHECK_EQ(stats().entries, 0);
+
+    // Static assets never need the filesystem
+    static const uint8_t image[] = {9};
+    asset_cache_add_static("/s", image, sizeof(image));
+    CHECK_EQ(asset_cache_get("/s", &a), ASSET_OK);
+
+    mount_release = true;
+    CHECK(test_wait_until([] { return stats().fs_mounted; }, 2000));
+    CHECK_EQ(asset_cache_get("/late.js", &a), ASSET_OK);
+    CHECK_EQ(a.size, 20);
+    CHECK(stats().mount_us > 0);
+}
+
+int main(void)
+{
+    snprintf(root, sizeof(root), "/tmp/rc_assets_XXXXXX");
+    if (!mkdtemp(root)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    test_hits_and_misses();
+    test_etag();
+    test_lru_budget();
+    test_entry_limit();
+    test_static();
+
+    uint16_t port = test_start_server();
+    test_routing(port);
+    test_mount_async();
+
+    std::string cmd = std::string("rm -rf ") + root;
+    if (system(cmd.c_str()) != 0)
+        fprintf(stderr, "could not remove %s\n", root);
+    test_exit("test_asset_cache");
+}
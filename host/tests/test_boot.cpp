@@ -0,0 +1,96 @@
+// Boot orchestrator: a stage graph shaped like the firmware's, with
+// sleeps standing in for the slow steps. Every stage starts only after
+// its dependencies have finished, independent stages overlap, and the
+// whole boot takes about the critical path, not the sum of the stages.
+
+#include "test_support.h"
+
+#include "boot.h"
+#include "esp_timer.h"
+
+#define STAGES 6
+
+// Simulated durations in ms, by stage index
+static const int duration_ms[STAGES] = {60, 120, 40, 150, 30, 20};
+
+template <int I>
+static void stage(void)
+{
+    test_sleep_ms(duration_ms[I]);
+}
+
+static const boot_stage_t stages[STAGES] = {
+    {"nvs", stage<0>, 0},
+    {"fs", stage<1>, 0},
+    {"motor", stage<2>, BOOT_DEP(0)},
+    {"wifi", stage<3>, BOOT_DEP(0)},
+    {"server", stage<4>, BOOT_DEP(1) | BOOT_DEP(2) | BOOT_DEP(3)},
+    {"udp", stage<5>, BOOT_DEP(2) | BOOT_DEP(3)},
+};
+
+// Longest chain of durations ending at stage i
+static int path_ms(int i)
+{
+    int longest = 0;
+    for (int d = 0; d < i; d++) {
+        if ((stages[i].deps & BOOT_DEP(d)) && path_ms(d) > longest)
+            longest = path_ms(d);
+    }
+    return longest + duration_ms[i];
+}
+
+int main(void)
+{
+    CHECK_EQ(boot_ready_us(), 0);
+    boot_stage_time_t t[STAGES];
+    CHECK(!boot_get_stage_time(0, &t[0]));
+
+    uint32_t start = (uint32_t)esp_timer_get_time();
+    boot_run(stages, STAGES);
+    uint32_t ready = boot_ready_us();
+    CHECK(ready != 0);
+
+    int critical_ms = 0, sum_ms = 0;
+    for (int i = 0; i < STAGES; i++) {
+        CHECK(boot_get_stage_time(i, &t[i]));
+        CHECK(strcmp(t[i].name, stages[i].name) == 0);
+        CHECK(t[i].end_us - t[i].start_us >= (uint32_t)duration_ms[i] * 1000);
+        CHECK(t[i].end_us <= ready);
+        if (path_ms(i) > critical_ms)
+            critical_ms = path_ms(i);
+        sum_ms += duration_ms[i];
+    }
+    CHECK(!boot_get_stage_time(STAGES, &t[0]));
+
+    // No stage starts before every dependency has finished
+    for (int i = 0; i < STAGES; i++) {
+        for (int d = 0; d < STAGES; d++) {
+            if (stages[i].deps & BOOT_DEP(d))
+                CHECK((int32_t)(t[i].start_us - t[d].end_us) >= 0);
+        }
+    }
+
+    // Stages without a dependency between them overlap
+    CHECK(t[1].start_us < t[0].end_us);                 // fs with nvs
+    CHECK(t[2].start_us < t[3].end_us);                 // motor with wifi
+    CHECK(t[5].start_us < t[4].end_us || t[4].start_us < t[5].end_us);
+
+    // The whole boot follows the critical path (nvs, wifi, server). A
+    // host stall can stretch it, but nowhere near the sequential sum.
+    uint32_t total_ms = (ready - start) / 1000;
+    printf("boot %u ms: critical path %d ms, stages sum %d ms\n",
+           (unsigned)total_ms, critical_ms, sum_ms);
+    CHECK(total_ms >= (uint32_t)critical_ms);
+    CHECK(total_ms < (uint32_t)(critical_ms + sum_ms) / 2);
+
+    // Only the first accepted command after boot is recorded
+    CHECK_EQ(boot_first_command_us(), 0);
+    boot_note_command();
+    uint32_t first = boot_first_command_us();
+    CHECK(first >= ready);
+    test_sleep_ms(2);
+    boot_note_command();
+    CHECK_EQ(boot_first_command_us(), first);
+
+    test_exit("test_boot");
+}
@@ -0,0 +1,169 @@
+// Direction pins: a direction change reaches the H-bridge inputs as
+// register writes in the order W1TC, W1TC1, W1TS, W1TS1, covering only
+// the wheels that flip. Replaying the writes, no wheel ever has both
+// inputs high, and a wheel's inputs only change once its duty is 0.
+
+#include "test_support.h"
+
+#include "drivetrain.h"
+#include "soc/gpio_reg.h"
+
+#include <mutex>
+#include <vector>
+
+struct reg_write_t {
+    uint32_t reg;
+    uint32_t val;
+    bool loaded;        // a flipping wheel still had duty
+};
+
+static std::mutex lock;
+static std::vector<reg_write_t> writes;
+static app_config_t cfg;
+
+static uint32_t pin_mask(int bank, int pin)
+{
+    return (pin >> 5) == bank ? 1u << (pin & 31) : 0;
+}
+
+static int bank_of(uint32_t reg)
+{
+    return reg == GPIO_OUT1_W1TS_REG || reg == GPIO_OUT1_W1TC_REG;
+}
+
+static void on_reg(uint32_t reg, uint32_t val, void *arg)
+{
+    reg_write_t w = {reg, val, false};
+    for (size_t i = 0; i < DRIVETRAIN_WHEELS; i++) {
+        const app_config_wheel_t &p = cfg.wheel[drivetrain.wheels[i].slot];
+        uint32_t pins = pin_mask(bank_of(reg), p.in1) | pin_mask(bank_of(reg), p.in2);
+        if ((val & pins) && host_hal_ledc_duty(drivetrain.wheels[i].channel) != 0)
+            w.loaded = true;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    writes.push_back(w);
+}
+
+static int wheel_cmd(const int cmd[4], size_t i)
+{
+    return cmd[drivetrain.wheels[i].slot];
+}
+
+// Drive to cmd and return the register writes it took
+static std::vector<reg_write_t> drive(const int cmd[4])
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        writes.clear();
+    }
+    set_wheels(cmd[0], cmd[1], cmd[2], cmd[3]);
+
+    bool settled = test_wait_until([&] {
+        int16_t out[4];
+        motor_get_outputs(out);
+        for (size_t i = 0; i < DRIVETRAIN_WHEELS; i++) {
+            if ((out[drivetrain.wheels[i].slot] > 0) != (wheel_cmd(cmd, i) > 0) ||
+                out[drivetrain.wheels[i].slot] == 0)
+                return false;
+        }
+        return true;
+    }, 2000);
+    CHECK(settled);
+
+    std::lock_guard<std::mutex> guard(lock);
+    return writes;
+}
+
+// The writes expected when going from direction from[] to cmd[]
+static std::vector<reg_write_t> expected(const int from[4], const int cmd[4])
+{
+    uint32_t clr[2] = {0, 0}, set[2] = {0, 0};
+    for (size_t i = 0; i < DRIVETRAIN_WHEELS; i++) {
+        if ((wheel_cmd(from, i) > 0) == (wheel_cmd(cmd, i) > 0))
+            continue;
+        const app_config_wheel_t &p = cfg.wheel[drivetrain.wheels[i].slot];
+        bool high1 = (wheel_cmd(cmd, i) > 0) != drivetrain.wheels[i].inverted;
+        int hi = high1 ? p.in1 : p.in2, lo = high1 ? p.in2 : p.in1;
+        for (int b = 0; b < 2; b++) {
+            set[b] |= pin_mask(b, hi);
+            clr[b] |= pin_mask(b, lo);
+        }
+    }
+
+    std::vector<reg_write_t> out;
+    const reg_write_t order[] = {
+        {GPIO_OUT_W1TC_REG, clr[0], false}, {GPIO_OUT1_W1TC_REG, clr[1], false},
+        {GPIO_OUT_W1TS_REG, set[0], false}, {GPIO_OUT1_W1TS_REG, set[1], false},
+    };
+    for (const auto &w : order) {
+        if (w.val)
+            out.push_back(w);
+    }
+    return out;
+}
+
+static void check_writes(const int from[4], const int cmd[4])
+{
+    // Levels before the change, replayed write by write
+    uint32_t level[2] = {0, 0};
+    for (int pin = 0; pin < 64; pin++) {
+        if (host_hal_gpio_level(pin))
+            level[pin >> 5] |= 1u << (pin & 31);
+    }
+
+    std::vector<reg_write_t> got = drive(cmd);
+    std::vector<reg_write_t> want = expected(from, cmd);
+
+    CHECK_EQ(got.size(), want.size());
+    for (size_t k = 0; k < got.size() && k < want.size(); k++) {
+        CHECK_EQ(got[k].reg, want[k].reg);
+        CHECK_EQ(got[k].val, want[k].val);
+        CHECK(!got[k].loaded);
+
+        int b = bank_of(got[k].reg);
+        if (got[k].reg == GPIO_OUT_W1TS_REG || got[k].reg == GPIO_OUT1_W1TS_REG)
+            level[b] |= got[k].val;
+        else
+            level[b] &= ~got[k].val;
+
+        for (size_t i = 0; i < DRIVETRAIN_WHEELS; i++) {
+            const app_config_wheel_t &p = cfg.wheel[drivetrain.wheels[i].slot];
+            bool in1 = level[p.in1 >> 5] & (1u << (p.in1 & 31));
+            bool in2 = level[p.in2 >> 5] & (1u << (p.in2 & 31));
+            CHECK(!(in1 && in2));
+        }
+    }
+}
+
+int main(void)
+{
+    // Config and motor stages only: no failsafe to ramp the wheels down
+    nvs_flash_init();
+    app_config_init();
+    app_config_get(&cfg);
+    motor_init();
+    motor_control_start(cfg.control_rate_hz);
+
+    // A short decel, so a flip really waits for the wheel to stop
+    motor_set_slew(0, 40);
+    host_hal_set_reg_observer(on_reg, NULL);
+
+    const int stop[4] = {0, 0, 0, 0};
+    const int fwd[4] = {5, 5, 5, 5};
+    const int rev[4] = {-5, -5, -5, -5};
+    const int spin[4] = {-5, -5, 5, 5};
+    const int slow_spin[4] = {-3, -3, 3, 3};
+
+    // The first command sets every wheel; unset inputs start low
+    check_writes(stop, fwd);
+    check_writes(fwd, rev);
+
+    // Only the flipping side is written
+    check_writes(rev, spin);
+
+    // A new duty without a direction change touches no direction pin
+    check_writes(spin, slow_spin);
+
+    host_hal_set_reg_observer(NULL, NULL);
+    test_exit("test_dir_pins");
+}
@@ -0,0 +1,148 @@
+// Drive mixer: the differential and tank mixes on known setpoints, their
+// invariants over a sweep of speed and steer, clamping, and the default
+// mode. Slots the chassis does not have must stay 0.
+
+#include "test_support.h"
+
+#include "app_config.h"
+#include "drive_mixer.h"
+#include "drivetrain.h"
+
+#define HALF (Q15_ONE / 2)
+
+static const unsigned slots = drivetrain_slot_mask();
+
+static bool has(int slot)
+{
+    return slots & (1u << slot);
+}
+
+// Left and right side of a mix, from whichever front wheels exist
+static void mix(drive_mixer_mode_t mode, int speed, int steer, int *left, int *right)
+{
+    q15_t out[4];
+    drive_mixer_mix(mode, speed, steer, out);
+    *left = out[WHEEL_LF];
+    *right = out[WHEEL_RF];
+
+    // Both wheels of a side always get the same command
+    for (int s = 0; s < WHEEL_SLOTS; s++) {
+        if (!has(s))
+            CHECK_EQ(out[s], 0);
+    }
+    if (has(WHEEL_LB))
+        CHECK_EQ(out[WHEEL_LB], out[WHEEL_LF]);
+    if (has(WHEEL_RB))
+        CHECK_EQ(out[WHEEL_RB], out[WHEEL_RF]);
+}
+
+static void test_differential(void)
+{
+    int l, r;
+    mix(DRIVE_MIXER_DIFFERENTIAL, HALF, 0, &l, &r);
+    CHECK_EQ(l, HALF);
+    CHECK_EQ(r, HALF);
+
+    // Steering slows the inner side, down to 0 at full lock
+    mix(DRIVE_MIXER_DIFFERENTIAL, HALF, HALF, &l, &r);
+    CHECK_EQ(l, HALF);
+    CHECK_EQ(r, HALF - HALF * HALF / Q15_ONE);
+    mix(DRIVE_MIXER_DIFFERENTIAL, HALF, Q15_ONE, &l, &r);
+    CHECK_EQ(l, HALF);
+    CHECK_EQ(r, 0);
+    mix(DRIVE_MIXER_DIFFERENTIAL, HALF, -Q15_ONE, &l, &r);
+    CHECK_EQ(l, 0);
+    CHECK_EQ(r, HALF);
+
+    // Reverse mirrors the magnitudes; nothing moves at zero speed
+    mix(DRIVE_MIXER_DIFFERENTIAL, -HALF, Q15_ONE, &l, &r);
+    CHECK_EQ(l, -HALF);
+    CHECK_EQ(r, 0);
+    mix(DRIVE_MIXER_DIFFERENTIAL, 0, Q15_ONE, &l, &r);
+    CHECK_EQ(l, 0);
+    CHECK_EQ(r, 0);
+
+    // Out-of-range inputs are clamped
+    mix(DRIVE_MIXER_DIFFERENTIAL, 40000, -40000, &l, &r);
+    CHECK_EQ(l, 0);
+    CHECK_EQ(r, Q15_ONE);
+}
+
+static void test_tank(void)
+{
+    int l, r;
+    mix(DRIVE_MIXER_TANK, HALF, 0, &l, &r);
+    CHECK_EQ(l, HALF);
+    CHECK_EQ(r, HALF);
+
+    // Zero speed pivots in place, positive steer clockwise
+    mix(DRIVE_MIXER_TANK, 0, HALF, &l, &r);
+    CHECK_EQ(l, HALF);
+    CHECK_EQ(r, -HALF);
+    mix(DRIVE_MIXER_TANK, 0, -Q15_ONE, &l, &r);
+    CHECK_EQ(l, -Q15_ONE);
+    CHECK_EQ(r, Q15_ONE);
+
+    // Saturation scales both sides together, keeping the ratio: 3 : -1
+    mix(DRIVE_MIXER_TANK, HALF, Q15_ONE, &l, &r);
+    CHECK_EQ(l, Q15_ONE);
+    CHECK(abs(r - (-Q15_ONE / 3)) <= 1);
+    mix(DRIVE_MIXER_TANK, Q15_ONE, Q15_ONE, &l, &r);
+    CHECK_EQ(l, Q15_ONE);
+    CHECK_EQ(r, 0);
+
+    // Reverse with positive steer still yaws clockwise: the right side
+    // backs up faster
+    mix(DRIVE_MIXER_TANK, -HALF, HALF / 2, &l, &r);
+    CHECK_EQ(l, -HALF + HALF / 2);
+    CHECK_EQ(r, -HALF - HALF / 2);
+
+    mix(DRIVE_MIXER_TANK, -40000, 0, &l, &r);
+    CHECK_EQ(l, -Q15_ONE);
+    CHECK_EQ(r, -Q15_ONE);
+}
+
+static void test_sweep(void)
+{
+    for (int speed = -Q15_ONE; speed <= Q15_ONE; speed += 1365) {
+        for (int steer = -Q15_ONE; steer <= Q15_ONE; steer += 1365) {
+            int l, r;
+
+            // Differential: never faster than speed, never against it
+            mix(DRIVE_MIXER_DIFFERENTIAL, speed, steer, &l, &r);
+            CHECK(abs(l) <= abs(speed) && abs(r) <= abs(speed));
+            CHECK((long)l * speed >= 0 && (long)r * speed >= 0);
+            CHECK(abs(l) == abs(speed) || abs(r) == abs(speed));
+
+            // Tank: within full scale, and the sides differ in proportion
+            // to steer (left - right = 2 * steer before saturation)
+            mix(DRIVE_MIXER_TANK, speed, steer, &l, &r);
+            CHECK(abs(l) <= Q15_ONE && abs(r) <= Q15_ONE);
+            CHECK((long)(l - r) * steer >= 0);
+            if (abs(speed) + abs(steer) <= Q15_ONE)
+                CHECK(l - r == 2 * steer);
+        }
+    }
+}
+
+static void test_default_mode(void)
+{
+    // Tank is opt-in; a fresh configuration keeps the car-like mix
+    CHECK_EQ(DRIVE_MIXER_DEFAULT_MODE, DRIVE_MIXER_DIFFERENTIAL);
+    app_config_t cfg;
+    app_config_defaults(&cfg);
+    CHECK_EQ(cfg.mixer, DRIVE_MIXER_DIFFERENTIAL);
+
+    CHECK(strcmp(drive_mixer_name(DRIVE_MIXER_DIFFERENTIAL), "differential") == 0);
+    CHECK(strcmp(drive_mixer_name(DRIVE_MIXER_TANK), "tank") == 0);
+    CHECK(strcmp(drive_mixer_name(DRIVE_MIXER_COUNT), "?") == 0);
+}
+
+int main(void)
+{
+    test_differential();
+    test_tank();
+    test_sweep();
+    test_default_mode();
+    test_exit("test_drive_mixer");
+}
@@ -0,0 +1,273 @@
+// Drive commands: per-source sequence numbers (stale, duplicate and
+// wraparound rejection, independent sources) and one LEDC write per
+// channel per combined speed/steer command. Then the same over loopback
+// WebSockets: concurrent sessions and a reconnect, and per-wheel frames
+// reaching the wheels at full Q15 resolution.
+
+#include "test_support.h"
+
+#include "control_protocol.h"
+#include "drivetrain.h"
+#include "latency_trace.h"
+
+#include <atomic>
+
+static std::atomic<uint32_t> ledc_writes[HOST_HAL_LEDC_CHANNELS];
+
+static void on_ledc(int channel, uint32_t duty, uint32_t fade_ms, void *arg)
+{
+    ledc_writes[channel]++;
+}
+
+static void test_sequence_rules(void)
+{
+    drive_seq_t a{}, b{};
+
+    // The first command from a source is accepted whatever its number
+    CHECK(set_drive_q15(0, 0, 40000, &a));
+    CHECK(!set_drive_q15(0, 0, 40000, &a));       // duplicate
+    CHECK(!set_drive_q15(0, 0, 39999, &a));       // stale
+    CHECK(set_drive_q15(0, 0, 40001, &a));
+
+    // Another source has its own window
+    CHECK(set_drive_q15(0, 0, 7, &b));
+    CHECK(set_drive_q15(0, 0, 40002, &a));
+    CHECK(set_drive_q15(0, 0, 8, &b));
+    CHECK(!set_drive_q15(0, 0, 7, &b));
+
+    // Serial arithmetic: 65535 -> 0 moves forward
+    drive_seq_t w{};
+    CHECK(set_drive_q15(0, 0, 65534, &w));
+    CHECK(set_drive_q15(0, 0, 65535, &w));
+    CHECK(set_drive_q15(0, 0, 0, &w));
+    CHECK(set_drive_q15(0, 0, 1, &w));
+    CHECK(!set_drive_q15(0, 0, 65535, &w));       // from before the wrap
+    CHECK_EQ(w.last, 1);
+
+    // Up to half the space ahead is newer; exactly half is not
+    drive_seq_t h{};
+    CHECK(set_drive_q15(0, 0, 100, &h));
+    CHECK(!set_drive_q15(0, 0, (uint16_t)(100 + 32768), &h));
+    CHECK(set_drive_q15(0, 0, (uint16_t)(100 + 32767), &h));
+
+    // Through the frame dispatcher: heartbeats never consume a number
+    drive_seq_t f{};
+    ctrl_frame_t cf = {CTRL_PROTO_VERSION, CTRL_FLAG_HEARTBEAT, 0, 0, 5};
+    CHECK(!ctrl_dispatch_frame(&cf, &f));
+    CHECK(!f.valid);
+    cf.flags = 0;
+    CHECK(ctrl_dispatch_frame(&cf, &f));
+    CHECK(!ctrl_dispatch_frame(&cf, &f));
+    cf.seq = 6;
+    CHECK(ctrl_dispatch_frame(&cf, &f));
+
+    set_drive_q15(0, 0, 2, &w);
+    stop_motors();
+}
+
+static void reset_writes(void)
+{
+    for (auto &w : ledc_writes)
+        w = 0;
+}
+
+static void test_one_write_per_command(void)
+{
+    motor_set_slew(0, 0);
+    stop_motors();
+    test_sleep_ms(30);
+
+    // Forward with a little steer: every wheel keeps its direction, and
+    // every command gives every wheel a new duty
+    drive_seq_t src{};
+    const int n = 20;
+    reset_writes();
+    for (int i = 0; i < n; i++) {
+        q15_t speed = (q15_t)(8000 + 1000 * i);
+        q15_t steer = (q15_t)(i & 1 ? 800 : -800);
+        failsafe_feed();    // as a transport would; a trip would ramp the wheels
+        CHECK(set_drive_q15(speed, steer, (uint16_t)i, &src));
+        test_sleep_ms(1000 / MOTOR_CONTROL_RATE_HZ * 3);
+    }
+
+    for (const auto &w : drivetrain.wheels)
+        CHECK_EQ(ledc_writes[w.channel].load(), n);
+
+    // A burst inside one control period is coalesced into one update
+    reset_writes();
+    failsafe_feed();
+    for (int i = 0; i < 50; i++)
+        set_drive_q15((q15_t)(4000 + 100 * i), 0, (uint16_t)(n + i), &src);
+    test_sleep_ms(1000 / MOTOR_CONTROL_RATE_HZ * 3);
+    for (const auto &w : drivetrain.wheels)
+        CHECK(ledc_writes[w.channel].load() <= 2);
+
+    stop_motors();
+}
+
+static void send_binary(int ws, q15_t speed, uint16_t seq)
+{
+    ctrl_frame_t cf = {CTRL_PROTO_VERSION, 0, speed, 0, seq};
+    uint8_t buf[CTRL_FRAME_SIZE];
+    ctrl_encode_binary(&cf, buf);
+    test_ws_send(ws, 0x2, buf, sizeof(buf));
+}
+
+static int open_binary(uint16_t port)
+{
+    int ws = test_ws_connect(port);
+    static const char hello[] = "{\"cmd\":\"hello\",\"proto\":\"bin\"}";
+    test_ws_send(ws, 0x1, hello, sizeof(hello) - 1);
+    std::string ack = test_ws_recv_text(ws);
+    CHECK(ack.find("\"proto\":\"bin\"") != std::string::npos);
+    return ws;
+}
+
+static uint32_t accepted(void)
+{
+    trace_summary_t s;
+    trace_get_summary(TRACE_PARSE, &s);
+    return s.count;
+}
+
+static void test_sessions(uint16_t port)
+{
+    // Four clients with unrelated sequence numbers, interleaved
+    const int clients = 4, frames = 50;
+    int ws[clients];
+    for (int c = 0; c < clients; c++)
+        ws[c] = open_binary(port);
+
+    trace_reset();
+    for (int i = 0; i < frames; i++) {
+        for (int c = 0; c < clients; c++)
+            send_binary(ws[c], (q15_t)(1000 * c), (uint16_t)(c * 10000 + i));
+    }
+    CHECK(test_wait_until([&] { return accepted() == clients * frames; }, 2000));
+    CHECK_EQ(accepted(), clients * frames);
+
+    // Replays within a session are still refused
+    send_binary(ws[0], 0, 10);
+    send_binary(ws[0], 0, (uint16_t)(frames - 1));
+    send_binary(ws[0], 0, (uint16_t)frames);
+    CHECK(test_wait_until([&] { return accepted() == clients * frames + 1; }, 2000));
+    test_sleep_ms(50);
+    CHECK_EQ(accepted(), clients * frames + 1);
+
+    // A new connection starts its own sequence; the others keep theirs
+    close(ws[1]);
+    int again = open_binary(port);
+    send_binary(again, 0, 3);
+    send_binary(ws[2], 0, (uint16_t)(20000 + frames - 1));    // stale for ws[2]
+    CHECK(test_wait_until([&] { return accepted() == clients * frames + 2; }, 2000));
+    test_sleep_ms(50);
+    CHECK_EQ(accepted(), clients * frames + 2);
+
+    // JSON drive commands share the session's sequence
+    static const char stale[] = "{\"cmd\":\"drive\",\"speed\":1,\"steer\":0,\"seq\":2}";
+    static const char fresh[] = "{\"cmd\":\"drive\",\"speed\":1,\"steer\":0,\"seq\":4}";
+    int js = test_ws_connect(port);
+    test_ws_send(js, 0x1, stale, sizeof(stale) - 1);
+    test_ws_send(js, 0x1, stale, sizeof(stale) - 1);
+    test_ws_send(js, 0x1, fresh, sizeof(fresh) - 1);
+    CHECK(test_wait_until([&] { return accepted() == clients * frames + 4; }, 2000));
+    test_sleep_ms(50);
+    CHECK_EQ(accepted(), clients * frames + 4);
+
+    for (int c = 0; c < clients; c++)
+        close(ws[c]);
+    close(again);
+    close(js);
+}
+
+static void test_wheel_frames(uint16_t port)
+{
+    // Codec: the flag and the length go together, and only in version 2
+    ctrl_frame_t in = {CTRL_PROTO_VERSION, CTRL_FLAG_WHEELS, 0, 0, 9, {1, -2, 3, -4}};
+    uint8_t buf[CTRL_FRAME_MAX];
+    CHECK_EQ(ctrl_encode_binary(&in, buf), CTRL_WHEELS_FRAME_SIZE);
+    ctrl_frame_t out;
+    CHECK(ctrl_decode_binary(buf, CTRL_WHEELS_FRAME_SIZE, &out));
+    CHECK_EQ(out.seq, 9);
+    for (int i = 0; i < 4; i++)
+        CHECK_EQ(out.wheels[i], in.wheels[i]);
+    CHECK(!ctrl_decode_binary(buf, CTRL_FRAME_SIZE, &out));
+    buf[0] = CTRL_PROTO_VERSION_V1;
+    CHECK(!ctrl_decode_binary(buf, CTRL_WHEELS_FRAME_SIZE, &out));
+    ctrl_frame_t drive = {CTRL_PROTO_VERSION, 0, 100, 0, 1};
+    CHECK_EQ(ctrl_encode_binary(&drive, buf), CTRL_FRAME_SIZE);
+    CHECK(!ctrl_decode_binary(buf, CTRL_WHEELS_FRAME_SIZE, &out));
+
+    // Wheel and drive frames share one sequence per source
+    drive_seq_t f{};
+    CHECK(ctrl_dispatch_frame(&in, &f));
+    CHECK(!ctrl_dispatch_frame(&in, &f));
+    drive.seq = 9;
+    CHECK(!ctrl_dispatch_frame(&drive, &f));
+    drive.seq = 10;
+    CHECK(ctrl_dispatch_frame(&drive, &f));
+    stop_motors();
+
+    // A pivot over a WebSocket, with values an 8-bit command would not
+    // carry. A host stall must not trip the failsafe halfway through
+    char err[64];
+    const char *slow = "{\"fs_timeout_ms\":5000}";
+    CHECK_EQ(app_config_update_json(slow, strlen(slow), err, sizeof(err), NULL), ESP_OK);
+    motor_set_slew(0, 0);
+    int ws = open_binary(port);
+    const q15_t wheels[4] = {12345, 6789, -12345, -9999};
+    ctrl_frame_t cf = {CTRL_PROTO_VERSION, CTRL_FLAG_WHEELS, 0, 0, 1,
+                       {wheels[0], wheels[1], wheels[2], wheels[3]}};
+    size_t len = ctrl_encode_binary(&cf, buf);
+    failsafe_feed();
+    test_ws_send(ws, 0x2, buf, len);
+
+    uint32_t max_duty;
+    motor_duty_for(0, &max_duty);
+    auto want = [&](int slot) {
+        q15_t w = wheels[slot];
+        int q = (int)((uint64_t)motor_duty_for(w < 0 ? -w : w, NULL) * Q15_ONE / max_duty);
+        return w < 0 ? -q : q;
+    };
+    q15_t duty[4];
+    CHECK(test_wait_until([&] {
+        motor_get_outputs(duty);
+        for (const auto &w : drivetrain.wheels) {
+            if (duty[w.slot] != want(w.slot))
+                return false;
+        }
+        return true;
+    }, 2000));
+    for (const auto &w : drivetrain.wheels)
+        CHECK_EQ(duty[w.slot], want(w.slot));
+
+    // A replayed wheel frame is refused like any other
+    trace_reset();
+    test_ws_send(ws, 0x2, buf, len);
+    cf.seq = 2;
+    ctrl_encode_binary(&cf, buf);
+    test_ws_send(ws, 0x2, buf, len);
+    CHECK(test_wait_until([&] { return accepted() == 1; }, 2000));
+    test_sleep_ms(50);
+    CHECK_EQ(accepted(), 1);
+
+    close(ws);
+    stop_motors();
+    char restore[32];
+    snprintf(restore, sizeof(restore), "{\"fs_timeout_ms\":%u}", FAILSAFE_TIMEOUT_MS);
+    CHECK_EQ(app_config_update_json(restore, strlen(restore), err, sizeof(err), NULL), ESP_OK);
+}
+
+int main(void)
+{
+    test_boot_motor();
+    host_hal_set_ledc_observer(on_ledc, NULL);
+    test_sleep_ms(MOTOR_STBY_SETTLE_MS + 20);
+
+    test_sequence_rules();
+    test_one_write_per_command();
+    uint16_t port = test_start_server();
+    test_sessions(port);
+    test_wheel_frames(port);
+    test_exit("test_drive_sequence");
+}
@@ -0,0 +1,156 @@
+// Chassis description, built once per drivetrain variant: the mixer
+// matrix and slot mask against a table written out here, the tank mix
+// through that matrix, and the direction pin masks the motor driver
+// writes for the default pins. Slots the chassis does not have stay 0.
+
+#include "test_support.h"
+
+#include "drive_mixer.h"
+#include "drivetrain.h"
+#include "soc/gpio_reg.h"
+
+#include <mutex>
+#include <vector>
+
+#define BIT(n) (1u << (n))
+#define HALF (Q15_ONE / 2)
+
+// Expected layout by wheel slot (LF, LB, RF, RB), independent of drivetrain.h
+#if DRIVETRAIN == DRIVETRAIN_2WD
+#define VARIANT "2wd"
+static const int8_t want_matrix[WHEEL_SLOTS][MIX_AXES] = {
+    {1, 0, 1}, {0, 0, 0}, {1, 0, -1}, {0, 0, 0},
+};
+static const unsigned want_slots = BIT(WHEEL_LF) | BIT(WHEEL_RF);
+// Forward: IN1 high, IN2 low on 23/22 (LF) and 27/26 (RF)
+static const uint32_t want_set[2] = {BIT(23) | BIT(27), 0};
+static const uint32_t want_clr[2] = {BIT(22) | BIT(26), 0};
+#elif DRIVETRAIN == DRIVETRAIN_4WD
+#define VARIANT "4wd"
+static const int8_t want_matrix[WHEEL_SLOTS][MIX_AXES] = {
+    {1, 0, 1}, {1, 0, 1}, {1, 0, -1}, {1, 0, -1},
+};
+static const unsigned want_slots = 0xf;
+// RB sits on GPIO33/32, the second bank
+static const uint32_t want_set[2] = {BIT(23) | BIT(18) | BIT(27), BIT(33 - 32)};
+static const uint32_t want_clr[2] = {BIT(22) | BIT(5) | BIT(26), BIT(32 - 32)};
+#elif DRIVETRAIN == DRIVETRAIN_MECANUM
+#define VARIANT "mecanum"
+static const int8_t want_matrix[WHEEL_SLOTS][MIX_AXES] = {
+    {1, 1, 1}, {1, -1, 1}, {1, -1, -1}, {1, 1, -1},
+};
+static const unsigned want_slots = 0xf;
+static const uint32_t want_set[2] = {BIT(23) | BIT(18) | BIT(27), BIT(33 - 32)};
+static const uint32_t want_clr[2] = {BIT(22) | BIT(5) | BIT(26), BIT(32 - 32)};
+#endif
+
+static void test_description(void)
+{
+    CHECK(strcmp(drivetrain.name, VARIANT) == 0);
+    CHECK_EQ(drivetrain_slot_mask(), want_slots);
+    CHECK_EQ(DRIVETRAIN_WHEELS, (size_t)__builtin_popcount(want_slots));
+
+    constexpr drivetrain_matrix_t m = drivetrain_matrix();
+    for (int s = 0; s < WHEEL_SLOTS; s++) {
+        for (int a = 0; a < MIX_AXES; a++)
+            CHECK_EQ(m.row[s][a], want_matrix[s][a]);
+    }
+
+    // The configuration defaults come from the description
+    app_config_t cfg;
+    app_config_defaults(&cfg);
+    CHECK_EQ(cfg.pin_stby, drivetrain.stby);
+    for (const auto &w : drivetrain.wheels) {
+        CHECK_EQ(cfg.wheel[w.slot].in1, w.in1);
+        CHECK_EQ(cfg.wheel[w.slot].in2, w.in2);
+        CHECK_EQ(cfg.wheel[w.slot].pwm, w.pwm);
+    }
+}
+
+static void test_tank_matrix(void)
+{
+    // Below saturation every wheel is its forward and yaw terms; no
+    // command carries strafe, so that column never contributes
+    const int cases[][2] = {{HALF, 0}, {0, HALF}, {HALF / 2, -HALF / 2}, {-HALF, HALF / 4}};
+    for (const auto &c : cases) {
+        q15_t out[4];
+        drive_mixer_mix(DRIVE_MIXER_TANK, c[0], c[1], out);
+        for (int s = 0; s < WHEEL_SLOTS; s++) {
+            int want = want_matrix[s][MIX_FORWARD] * c[0] + want_matrix[s][MIX_YAW] * c[1];
+            CHECK_EQ(out[s], want);
+        }
+    }
+
+    // Differential: empty slots stay 0 as well
+    q15_t out[4];
+    drive_mixer_mix(DRIVE_MIXER_DIFFERENTIAL, HALF, HALF, out);
+    for (int s = 0; s < WHEEL_SLOTS; s++) {
+        if (!(want_slots & BIT(s)))
+            CHECK_EQ(out[s], 0);
+    }
+}
+
+static std::mutex lock;
+static std::vector<std::pair<uint32_t, uint32_t>> writes;
+
+static void on_reg(uint32_t reg, uint32_t val, void *arg)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    writes.emplace_back(reg, val);
+}
+
+static void test_pin_masks(void)
+{
+    nvs_flash_init();
+    app_config_init();
+    app_config_t cfg;
+    app_config_get(&cfg);
+    motor_init();
+    motor_control_start(cfg.control_rate_hz);
+    motor_set_slew(0, 0);
+
+    // The first command sets the inputs of every wheel the chassis has
+    host_hal_set_reg_observer(on_reg, NULL);
+    set_wheels(5, 5, 5, 5);
+    int16_t duty[4];
+    CHECK(test_wait_until([&] {
+        motor_get_outputs(duty);
+        for (const auto &w : drivetrain.wheels) {
+            if (duty[w.slot] <= 0)
+                return false;
+        }
+        return true;
+    }, 2000));
+    host_hal_set_reg_observer(NULL, NULL);
+
+    std::vector<std::pair<uint32_t, uint32_t>> want;
+    if (want_clr[0])
+        want.emplace_back(GPIO_OUT_W1TC_REG, want_clr[0]);
+    if (want_clr[1])
+        want.emplace_back(GPIO_OUT1_W1TC_REG, want_clr[1]);
+    if (want_set[0])
+        want.emplace_back(GPIO_OUT_W1TS_REG, want_set[0]);
+    if (want_set[1])
+        want.emplace_back(GPIO_OUT1_W1TS_REG, want_set[1]);
+
+    std::lock_guard<std::mutex> guard(lock);
+    CHECK_EQ(writes.size(), want.size());
+    for (size_t k = 0; k < writes.size() && k < want.size(); k++) {
+        CHECK_EQ(writes[k].first, want[k].first);
+        CHECK_EQ(writes[k].second, want[k].second);
+    }
+
+    // Outputs of the slots without a wheel never move
+    for (int s = 0; s < WHEEL_SLOTS; s++) {
+        if (!(want_slots & BIT(s)))
+            CHECK_EQ(duty[s], 0);
+    }
+}
+
+int main(void)
+{
+    test_description();
+    test_tank_matrix();
+    test_pin_masks();
+    test_exit("test_drivetrain_" VARIANT);
+}
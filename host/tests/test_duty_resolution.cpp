@@ -0,0 +1,128 @@
+// Output resolution of the Q15 speed/steer path against the integer path
+// it replaced: 11 speed steps of an 8-bit duty and integer steering.
+
+#include "test_support.h"
+
+#include "drive_mixer.h"
+#include "drivetrain.h"
+
+#include <math.h>
+#include <set>
+
+/* =====================================================
+ *              LEGACY INTEGER PATH
+ * ===================================================== */
+
+#define LEGACY_MAX_DUTY 255
+
+static int legacy_pwm_from_speed(int speed)
+{
+    int s = abs(speed);
+    if (s > 10) s = 10;
+    return (s * LEGACY_MAX_DUTY) / 10;
+}
+
+// Inner side duty of the old apply_drive() for a Q15 stick position,
+// rounded to the -10 .. +10 command the UI used to send
+static int legacy_inner_duty(q15_t speed, q15_t steer)
+{
+    int base = legacy_pwm_from_speed((int)lround(speed * 10.0 / Q15_ONE));
+    int s = (int)lround(steer * 10.0 / Q15_ONE);
+    return base - (abs(s) * base) / 10;
+}
+
+/* =====================================================
+ *              CHECKS
+ * ===================================================== */
+
+// Largest duty jump between neighbouring stick positions above the
+// first non-zero output, as a fraction of full scale
+template <typename Fn>
+static double max_step(Fn duty_at, int max_duty, int *levels, bool *monotonic)
+{
+    std::set<int> seen;
+    int prev = duty_at(0);
+    int worst = 0;
+    *monotonic = true;
+    for (int q = 1; q <= Q15_ONE; q++) {
+        int d = duty_at(q);
+        seen.insert(d);
+        if (d < prev)
+            *monotonic = false;
+        if (prev > 0 && d - prev > worst)
+            worst = d - prev;
+        prev = d;
+    }
+    *levels = (int)seen.size();
+    return (double)worst / max_duty;
+}
+
+static void test_speed_resolution(void)
+{
+    uint32_t max_duty = 0;
+    motor_duty_for(0, &max_duty);
+    CHECK(max_duty >= 2047);    // 11 bit or better at 10 kHz
+
+    int legacy_levels, levels;
+    bool legacy_mono, mono;
+    double legacy_step = max_step([](int q) {
+        return legacy_pwm_from_speed((int)lround(q * 10.0 / Q15_ONE));
+    }, LEGACY_MAX_DUTY, &legacy_levels, &legacy_mono);
+    double step = max_step([](int q) {
+        return (int)motor_duty_for((q15_t)q, NULL);
+    }, (int)max_duty, &levels, &mono);
+
+    printf("speed  legacy: %4d levels of %4d, max step %5.2f%%\n",
+           legacy_levels, LEGACY_MAX_DUTY, legacy_step * 100);
+    printf("speed  q15:    %4d levels of %4u, max step %5.2f%%\n",
+           levels, (unsigned)max_duty, step * 100);
+
+    CHECK_EQ(legacy_levels, 11);
+    CHECK(mono);
+    CHECK(levels >= 50 * legacy_levels);
+    CHECK(step < 0.002);
+
+    // Deadband, then up to the stall-overcoming minimum within one table
+    // interval (128 Q15 counts)
+    CHECK_EQ(motor_duty_for(Q15_ONE / 50 - 128, NULL), 0);
+    CHECK(motor_duty_for(Q15_ONE / 50 + 256, NULL) >= max_duty * MOTOR_MIN_DUTY_PCT / 100);
+    CHECK_EQ(motor_duty_for(Q15_ONE, NULL), max_duty);
+}
+
+static void test_steer_resolution(void)
+{
+    uint32_t max_duty = 0;
+    motor_duty_for(0, &max_duty);
+
+    // Full speed, steering right: the right side is the inner one
+    int legacy_levels, levels;
+    bool legacy_mono, mono;
+    max_step([](int q) {
+        return LEGACY_MAX_DUTY - legacy_inner_duty(Q15_ONE, (q15_t)q);
+    }, LEGACY_MAX_DUTY, &legacy_levels, &legacy_mono);
+    double step = max_step([](int q) {
+        q15_t out[4];
+        drive_mixer_mix(DRIVE_MIXER_DIFFERENTIAL, Q15_ONE, q, out);
+        uint32_t max;
+        motor_duty_for(0, &max);
+        return (int)(max - motor_duty_for(out[WHEEL_RF], NULL));
+    }, (int)max_duty, &levels, &mono);
+
+    printf("steer  legacy: %4d levels, q15: %4d levels, max step %5.2f%%\n",
+           legacy_levels, levels, step * 100);
+
+    CHECK_EQ(legacy_levels, 11);
+    CHECK(mono);
+    CHECK(levels >= 50 * legacy_levels);
+}
+
+int main(void)
+{
+    nvs_flash_init();
+    app_config_init();
+    motor_init();
+
+    test_speed_resolution();
+    test_steer_resolution();
+    test_exit("test_duty_resolution");
+}
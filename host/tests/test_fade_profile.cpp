@@ -0,0 +1,218 @@
+// Slew profile: records every LEDC duty change the control task issues,
+// integrates the resulting fades offline into a duty-over-time profile
+// per channel and checks its peak step sizes against the configured
+// acceleration and deceleration limits. An explicit stop bypasses them
+// with a single zero-fade write.
+
+#include "test_support.h"
+
+#include "drivetrain.h"
+#include "esp_timer.h"
+
+#include <mutex>
+#include <vector>
+
+#define ACCEL_MS 400
+#define DECEL_MS 200
+
+typedef struct {
+    int64_t t_us;
+    uint32_t target;
+    uint32_t fade_ms;
+} write_t;
+
+static std::mutex lock;
+static std::vector<write_t> writes[HOST_HAL_LEDC_CHANNELS];
+
+static void on_ledc(int channel, uint32_t duty, uint32_t fade_ms, void *arg)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    writes[channel].push_back(write_t{esp_timer_get_time(), duty, fade_ms});
+}
+
+/* =====================================================
+ *              PROFILE INTEGRATION
+ * ===================================================== */
+
+typedef struct {
+    double rise;        // largest increase over any 1 ms window
+    double fall;        // largest decrease over any 1 ms window
+    uint32_t peak;      // highest duty reached
+} steps_t;
+
+// Duty of a channel at t, replaying its writes as linear fades that
+// start from wherever the previous one had got to
+static double duty_at(const std::vector<write_t> &w, int64_t t)
+{
+    double duty = 0;
+    for (size_t i = 0; i < w.size() && w[i].t_us <= t; i++) {
+        const write_t &cur = w[i];
+        int64_t end = i + 1 < w.size() && w[i + 1].t_us <= t ? w[i + 1].t_us : t;
+        double from = duty;
+        int64_t fade_us = (int64_t)cur.fade_ms * 1000;
+        if (fade_us == 0 || end - cur.t_us >= fade_us)
+            duty = cur.target;
+        else
+            duty = from + ((double)cur.target - from) * (double)(end - cur.t_us) / fade_us;
+    }
+    return duty;
+}
+
+static steps_t integrate(int channel)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    const std::vector<write_t> &w = writes[channel];
+    steps_t s = {0, 0, 0};
+    if (w.empty())
+        return s;
+
+    const int64_t step = 100;   // us
+    int64_t start = w.front().t_us - 1000;
+    int64_t end = esp_timer_get_time();
+    std::vector<double> d;
+    for (int64_t t = start; t <= end; t += step)
+        d.push_back(duty_at(w, t));
+
+    const size_t win = 1000 / step;
+    for (size_t i = 0; i + win < d.size(); i++) {
+        double delta = d[i + win] - d[i];
+        if (delta > s.rise)
+            s.rise = delta;
+        if (-delta > s.fall)
+            s.fall = -delta;
+        if (d[i] > s.peak)
+            s.peak = (uint32_t)d[i];
+    }
+    return s;
+}
+
+static void clear_writes(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto &w : writes)
+        w.clear();
+}
+
+/* =====================================================
+ *              SCENARIOS
+ * ===================================================== */
+
+static drive_seq_t src{};
+static uint16_t seq = 0;
+
+static void drive(q15_t speed, q15_t steer, int hold_ms)
+{
+    int64_t end = esp_timer_get_time() + hold_ms * 1000LL;
+    set_drive_q15(speed, steer, seq++, &src);
+    while (esp_timer_get_time() < end) {
+        failsafe_feed();
+        test_sleep_ms(10);
+    }
+}
+
+static uint32_t full_scale(void)
+{
+    // Full speed straight ahead settles every wheel at the top duty
+    motor_set_slew(0, 0);
+    clear_writes();
+    drive(Q15_ONE, 0, 50);
+    uint32_t full = 0;
+    std::lock_guard<std::mutex> guard(lock);
+    for (const auto &w : drivetrain.wheels)
+        if (!writes[w.channel].empty() && writes[w.channel].back().target > full)
+            full = writes[w.channel].back().target;
+    return full;
+}
+
+static void check_limits(const char *scenario, uint32_t full)
+{
+    // set_duty_slewed truncates the fade to whole ms, so a short fade runs
+    // up to (ms + 1) / ms faster than the limit: at worst twice, plus the
+    // rounding of a step that gets no fade at all
+    const double rise_max = (double)full / ACCEL_MS * 2 + 2;
+    const double fall_max = (double)full / DECEL_MS * 2 + 2;
+
+    for (const auto &w : drivetrain.wheels) {
+        steps_t s = integrate(w.channel);
+        printf("%-10s ch%d  peak %5u  max rise %7.1f/ms  max fall %7.1f/ms\n",
+               scenario, w.channel, s.peak, s.rise, s.fall);
+        CHECK(s.rise <= rise_max);
+        CHECK(s.fall <= fall_max);
+    }
+}
+
+int main(void)
+{
+    test_boot_motor();
+    host_hal_set_ledc_observer(on_ledc, NULL);
+    test_sleep_ms(MOTOR_STBY_SETTLE_MS + 20);
+
+    uint32_t full = full_scale();
+    CHECK(full > 1000);
+    drive(0, 0, 50);
+
+    // Without a profile the whole step lands at once
+    clear_writes();
+    drive(Q15_ONE, 0, 50);
+    steps_t instant = integrate(drivetrain.wheels[0].channel);
+    CHECK(instant.rise >= full * 0.99);
+    drive(0, 0, 50);
+
+    motor_set_slew(ACCEL_MS, DECEL_MS);
+
+    // Standing start to full and back
+    clear_writes();
+    drive(Q15_ONE, 0, ACCEL_MS + 100);
+    drive(0, 0, DECEL_MS + 100);
+    check_limits("start/stop", full);
+    CHECK(integrate(drivetrain.wheels[0].channel).peak >= full * 0.99);
+
+    // Full forward to full reverse: decelerate, flip, accelerate
+    clear_writes();
+    drive(Q15_ONE, 0, ACCEL_MS + 100);
+    drive(-Q15_ONE, 0, DECEL_MS + ACCEL_MS + 200);
+    drive(0, 0, DECEL_MS + 100);
+    check_limits("reverse", full);
+
+    // A joystick sweeping every 10 ms keeps retargeting running fades
+    clear_writes();
+    for (int i = 0; i < 60; i++)
+        drive((q15_t)(i & 4 ? Q15_ONE : Q15_ONE / 4), (q15_t)((i % 7 - 3) * 8000), 10);
+    drive(0, 0, DECEL_MS + 100);
+    check_limits("sweep", full);
+
+    // An explicit stop skips the decel profile: one zero-fade write per
+    // wheel within a tick or two, and nothing left running
+    drive(Q15_ONE, 0, ACCEL_MS + 100);
+    clear_writes();
+    int64_t stop_at = esp_timer_get_time();
+    stop_motors();
+    test_sleep_ms(20);
+    for (const auto &w : drivetrain.wheels) {
+        std::lock_guard<std::mutex> guard(lock);
+        const std::vector<write_t> &cw = writes[w.channel];
+        CHECK_EQ(cw.size(), 1);
+        if (cw.empty())
+            continue;
+        CHECK_EQ(cw[0].target, 0);
+        CHECK_EQ(cw[0].fade_ms, 0);
+        CHECK(cw[0].t_us - stop_at <= 2 * 1000000 / MOTOR_CONTROL_RATE_HZ + 2000);
+        CHECK_EQ(host_hal_ledc_duty(w.channel), 0);
+    }
+
+    // The next command starts from a standstill under the accel profile
+    clear_writes();
+    drive(Q15_ONE, 0, ACCEL_MS + 100);
+    drive(0, 0, DECEL_MS + 100);
+    check_limits("hard stop", full);
+
+    // The failsafe ramp lowers the target every tick; each step still
+    // fades at the decel limit
+    clear_writes();
+    drive(Q15_ONE, 0, ACCEL_MS + 100);
+    ramp_stop_motors(FAILSAFE_RAMP_MS);
+    test_sleep_ms(FAILSAFE_RAMP_MS + 100);
+    check_limits("failsafe", full);
+
+    test_exit("test_fade_profile");
+}
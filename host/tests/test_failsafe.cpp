@@ -0,0 +1,141 @@
+// Failsafe on a simulated clock: feeds and polls carry their own
+// timestamps, far from the real esp_timer time, so the periodic poll
+// timer can never trip them. Then a trip ramps real outputs to zero.
+
+#include "test_support.h"
+
+#include <atomic>
+
+// Well past the process uptime the real poll timer sees
+static const int64_t T0 = 1000000000000LL;
+
+static std::atomic<uint32_t> ledc_writes{0};
+
+static void on_ledc(int channel, uint32_t duty, uint32_t fade_ms, void *arg)
+{
+    ledc_writes++;
+}
+
+static failsafe_stats_t stats(void)
+{
+    failsafe_stats_t s;
+    failsafe_get_stats(&s);
+    return s;
+}
+
+static void test_timeout(void)
+{
+    // Disarmed until the first feed, however long the silence
+    CHECK(!failsafe_poll(T0));
+    CHECK(!failsafe_poll(T0 + 3600 * 1000000LL));
+    CHECK_EQ(stats().trips, 0);
+
+    const int64_t limit = FAILSAFE_TIMEOUT_MS * 1000;
+    failsafe_feed_at(T0);
+    CHECK(!failsafe_poll(T0 + limit / 2));
+    CHECK(!failsafe_poll(T0 + limit));
+    CHECK(failsafe_poll(T0 + limit + 1));
+    CHECK_EQ(stats().trips, 1);
+    CHECK_EQ(stats().last_gap_ms, FAILSAFE_TIMEOUT_MS);
+    CHECK(stats().tripped);
+
+    // One trip per silence: disarmed again until the next command
+    CHECK(!failsafe_poll(T0 + 10 * limit));
+    CHECK_EQ(stats().trips, 1);
+    CHECK(stats().tripped);
+
+    // A feed clears the tripped flag at the next poll and re-arms
+    const int64_t t1 = T0 + 20 * limit;
+    failsafe_feed_at(t1);
+    CHECK(!failsafe_poll(t1 + 1000));
+    CHECK(!stats().tripped);
+
+    // Steady feeds just inside the limit never trip
+    int64_t t = t1;
+    for (int i = 0; i < 100; i++) {
+        t += limit - 1000;
+        CHECK(!failsafe_poll(t));
+        failsafe_feed_at(t);
+    }
+    CHECK_EQ(stats().trips, 1);
+
+    // A late poll reports the real gap
+    CHECK(failsafe_poll(t + 3 * limit));
+    CHECK_EQ(stats().last_gap_ms, 3 * FAILSAFE_TIMEOUT_MS);
+    CHECK_EQ(stats().trips, 2);
+}
+
+static void test_config_limits(void)
+{
+    char err[64];
+    static const char json[] = "{\"fs_timeout_ms\":400}";
+    CHECK_EQ(app_config_update_json(json, sizeof(json) - 1, err, sizeof(err), NULL), ESP_OK);
+
+    const int64_t t = T0 + 1000 * 1000000LL;
+    failsafe_feed_at(t);
+    CHECK(!failsafe_poll(t + 399000));
+    CHECK(!failsafe_poll(t + 400000));
+    CHECK(failsafe_poll(t + 400001));
+    CHECK_EQ(stats().last_gap_ms, 400);
+}
+
+static void test_ramp(void)
+{
+    motor_set_slew(0, 0);
+    drive_seq_t src{};
+    CHECK(set_drive_q15(Q15_ONE, 0, 1, &src));
+    q15_t out[4];
+    CHECK(test_wait_until([&] {
+        motor_get_outputs(out);
+        return out[0] > 30000;
+    }, 500));
+
+    // The trip ramps down over fs_ramp_ms instead of cutting the duty
+    ledc_writes = 0;
+    const int64_t t = T0 + 2000 * 1000000LL;
+    failsafe_feed_at(t);
+    CHECK(failsafe_poll(t + 400001));
+    CHECK(test_wait_until([&] {
+        motor_get_outputs(out);
+        return !out[0] && !out[1] && !out[2] && !out[3];
+    }, FAILSAFE_RAMP_MS * 3));
+    CHECK(ledc_writes > 4 * 5);     // several steps per wheel, not one cut
+
+    // The link recovers mid-ramp and the operator repeats the command it
+    // was cut off at: the ramp stops and the car keeps going
+    CHECK(set_drive_q15(Q15_ONE, 0, 2, &src));
+    CHECK(test_wait_until([&] {
+        motor_get_outputs(out);
+        return out[0] > 30000;
+    }, 500));
+    const int64_t t2 = t + 10 * 1000000LL;
+    failsafe_feed_at(t2);
+    CHECK(failsafe_poll(t2 + 400001));
+    test_sleep_ms(FAILSAFE_RAMP_MS / 4);
+    CHECK(set_drive_q15(Q15_ONE, 0, 3, &src));
+    test_sleep_ms(FAILSAFE_RAMP_MS * 2);
+    motor_get_outputs(out);
+    CHECK(out[0] > 30000);
+
+    // A different command still takes over as well
+    failsafe_feed_at(t2 + 1000000);
+    CHECK(failsafe_poll(t2 + 1400001));
+    test_sleep_ms(FAILSAFE_RAMP_MS / 4);
+    CHECK(set_drive_q15(Q15_ONE / 2, 0, 4, &src));
+    test_sleep_ms(FAILSAFE_RAMP_MS * 2);
+    motor_get_outputs(out);
+    CHECK(out[0] > 10000);
+    stop_motors();
+}
+
+int main(void)
+{
+    test_boot_motor();
+    host_hal_set_ledc_observer(on_ledc, NULL);
+    test_sleep_ms(MOTOR_STBY_SETTLE_MS + 20);
+
+    test_timeout();
+    test_config_limits();
+    test_ramp();
+    test_exit("test_failsafe");
+}
@@ -0,0 +1,198 @@
+// Specialised JSON control parser against the cJSON fallback: captured
+// UI frames must take the fast path, and on mutated and generated input
+// the fast parser may only accept what cJSON would decode identically.
+
+#include "test_support.h"
+
+#include "control_protocol.h"
+#include "json_frames.h"
+
+extern "C" {
+#include "cJSON.h"
+}
+
+#include <random>
+#include <string>
+
+// parse_cjson() in web_server.cpp, on the default cJSON allocator
+static bool parse_reference(const std::string &frame, ctrl_command_t *out)
+{
+    cJSON *root = cJSON_Parse(frame.c_str());
+    if (!root)
+        return false;
+
+    memset(out, 0, sizeof(*out));
+    cJSON *cmd = cJSON_GetObjectItem(root, "cmd");
+    if (cJSON_IsString(cmd))
+        out->cmd = ctrl_cmd_lookup(cmd->valuestring, strlen(cmd->valuestring));
+
+    const struct { const char *key; uint32_t field; double *dst; } nums[] = {
+        {"value", CTRL_FIELD_VALUE, &out->value},
+        {"angle", CTRL_FIELD_ANGLE, &out->angle},
+        {"speed", CTRL_FIELD_SPEED, &out->speed},
+        {"steer", CTRL_FIELD_STEER, &out->steer},
+        {"seq", CTRL_FIELD_SEQ, &out->seq},
+    };
+    for (const auto &n : nums) {
+        cJSON *item = cJSON_GetObjectItem(root, n.key);
+        if (cJSON_IsNumber(item)) {
+            *n.dst = item->valuedouble;
+            out->fields |= n.field;
+        }
+    }
+
+    const struct { const char *key; uint32_t field; char *dst; } strs[] = {
+        {"dir", CTRL_FIELD_DIR, out->dir},
+        {"proto", CTRL_FIELD_PROTO, out->proto},
+    };
+    for (const auto &n : strs) {
+        cJSON *item = cJSON_GetObjectItem(root, n.key);
+        if (cJSON_IsString(item) && strlen(item->valuestring) < CTRL_STR_MAX) {
+            strcpy(n.dst, item->valuestring);
+            out->fields |= n.field;
+        }
+    }
+    cJSON_Delete(root);
+    return true;
+}
+
+static bool same_command(const ctrl_command_t &a, const ctrl_command_t &b)
+{
+    // Numbers come from the same strtod call, so compare them exactly
+    return a.cmd == b.cmd && a.fields == b.fields &&
+           !memcmp(&a.value, &b.value, sizeof(double)) &&
+           !memcmp(&a.angle, &b.angle, sizeof(double)) &&
+           !memcmp(&a.speed, &b.speed, sizeof(double)) &&
+           !memcmp(&a.steer, &b.steer, sizeof(double)) &&
+           !memcmp(&a.seq, &b.seq, sizeof(double)) &&
+           !strcmp(a.dir, b.dir) && !strcmp(a.proto, b.proto);
+}
+
+static int fast_accepted = 0;
+static int disagreements = 0;
+
+// The fast parser sees the exact frame bytes; the fallback a C string
+static void check_frame(const std::string &frame)
+{
+    ctrl_command_t fast, ref;
+    if (!ctrl_parse_json(frame.data(), frame.size(), &fast))
+        return;
+    fast_accepted++;
+    if (!parse_reference(frame, &ref) || !same_command(fast, ref)) {
+        if (disagreements++ < 5)
+            fprintf(stderr, "disagreement on: %s\n", frame.c_str());
+    }
+}
+
+/* =====================================================
+ *              CAPTURED FRAMES
+ * ===================================================== */
+
+static void test_captured(void)
+{
+    for (size_t i = 0; i < CAPTURED_FRAME_COUNT; i++) {
+        std::string f = captured_frames[i];
+        ctrl_command_t fast, ref;
+        CHECK(ctrl_parse_json(f.data(), f.size(), &fast));
+        CHECK(parse_reference(f, &ref));
+        CHECK(same_command(fast, ref));
+        CHECK(fast.cmd != CTRL_CMD_UNKNOWN && fast.cmd != CTRL_CMD_NONE);
+
+        // Frames arrive NUL terminated from some clients, and with spacing
+        check_frame(f + '\0');
+        check_frame(" \t" + f + "\r\n");
+    }
+}
+
+/* =====================================================
+ *              MUTATION FUZZING
+ * ===================================================== */
+
+static const char alphabet[] = "{}[]\":,.-+eE0123456789 \t\\nul\x01\xff"
+                               "cmdseqspeedsteervalueangledirproto";
+
+static std::string mutate(std::string f, std::mt19937 &rng)
+{
+    int edits = 1 + (int)(rng() % 4);
+    for (int e = 0; e < edits && !f.empty(); e++) {
+        size_t pos = rng() % f.size();
+        char c = alphabet[rng() % (sizeof(alphabet) - 1)];
+        switch (rng() % 5) {
+        case 0: f[pos] = c; break;
+        case 1: f.insert(pos, 1, c); break;
+        case 2: f.erase(pos, 1); break;
+        case 3: f.resize(pos); break;
+        default: f.insert(pos, f.substr(rng() % f.size(), 1 + rng() % 8)); break;
+        }
+    }
+    return f;
+}
+
+static void test_mutations(void)
+{
+    std::mt19937 rng(12345);
+    int before = fast_accepted;
+    for (int i = 0; i < 300000; i++)
+        check_frame(mutate(captured_frames[rng() % CAPTURED_FRAME_COUNT], rng));
+    printf("mutations: %d of 300000 took the fast path\n", fast_accepted - before);
+    CHECK(fast_accepted - before > 10000);
+}
+
+/* =====================================================
+ *              GENERATED OBJECTS
+ * ===================================================== */
+
+static const char *const keys[] = {
+    "cmd", "seq", "dir", "speed", "steer", "value", "angle", "proto",
+    "CMD", "Speed", "x", "", "cmdx", "spee",
+};
+static const char *const values[] = {
+    "0", "-0", "1", "-3.5", "1e3", "2E-2", "1e400", "-", "01", "+1", ".5", "1.",
+    "12345678901234567890123456789012345",
+    "\"drive\"", "\"set\"", "\"stop\"", "\"forward\"", "\"brake!!!\"", "\"\"",
+    "\"a\\\"b\"", "\"\\u0041\"", "true", "false", "null", "[1]", "{}", "{\"a\":1}",
+};
+
+static std::string generate(std::mt19937 &rng)
+{
+    static const char *const ws[] = {"", "", " ", "\n", "\t "};
+    std::string f = ws[rng() % 5];
+    f += '{';
+    int members = (int)(rng() % 6);
+    for (int m = 0; m < members; m++) {
+        if (m)
+            f += ',';
+        f += ws[rng() % 5];
+        f += '"';
+        f += keys[rng() % (sizeof(keys) / sizeof(keys[0]))];
+        f += '"';
+        f += ws[rng() % 5];
+        f += ':';
+        f += ws[rng() % 5];
+        f += values[rng() % (sizeof(values) / sizeof(values[0]))];
+        f += ws[rng() % 5];
+    }
+    f += '}';
+    if (rng() % 8 == 0)
+        f += rng() % 2 ? 'x' : '\0';
+    return f;
+}
+
+static void test_generated(void)
+{
+    std::mt19937 rng(777);
+    int before = fast_accepted;
+    for (int i = 0; i < 300000; i++)
+        check_frame(generate(rng));
+    printf("generated: %d of 300000 took the fast path\n", fast_accepted - before);
+    CHECK(fast_accepted - before > 10000);
+}
+
+int main(void)
+{
+    test_captured();
+    test_mutations();
+    test_generated();
+    CHECK_EQ(disagreements, 0);
+    test_exit("test_json_parser");
+}
@@ -0,0 +1,119 @@
+// Latency trace: histogram quantiles on synthetic intervals, then one
+// command followed from WS receive to the LEDC write on the host build.
+
+#include "test_support.h"
+
+#include "latency_trace.h"
+
+#include <atomic>
+
+static void test_histogram(void)
+{
+    trace_reset();
+
+    // Parse intervals 1..1000 us; dispatch is whatever trace_now() says
+    for (uint32_t k = 1; k <= 1000; k++)
+        trace_command(0, k, 0);
+
+    trace_summary_t s;
+    trace_get_summary(TRACE_PARSE, &s);
+    CHECK_EQ(s.count, 1000);
+    CHECK_EQ(s.min_us, 1);
+    CHECK_EQ(s.max_us, 1000);
+    CHECK_EQ(trace_last_us(TRACE_PARSE), 1000);
+
+    // Buckets are log-linear, 8 per power of two: within 12.5% below
+    CHECK(s.p50_us <= 500 && s.p50_us >= 500 * 7 / 8);
+    CHECK(s.p90_us <= 900 && s.p90_us >= 900 * 7 / 8);
+    CHECK(s.p99_us <= 990 && s.p99_us >= 990 * 7 / 8);
+    CHECK(s.p50_us <= s.p90_us && s.p90_us <= s.p99_us && s.p99_us <= s.p999_us);
+
+    // Small values are exact
+    trace_reset();
+    for (uint32_t k = 0; k < 8; k++)
+        trace_command(0, k, 0);
+    trace_get_summary(TRACE_PARSE, &s);
+    CHECK_EQ(s.min_us, 0);
+    CHECK_EQ(s.p50_us, 3);
+
+    // Only the newest pending command is applied, and only once
+    trace_get_summary(TRACE_APPLY, &s);
+    CHECK_EQ(s.count, 0);
+    trace_applied();
+    trace_applied();
+    trace_get_summary(TRACE_APPLY, &s);
+    CHECK_EQ(s.count, 1);
+    trace_get_summary(TRACE_TOTAL, &s);
+    CHECK_EQ(s.count, 1);
+
+    trace_reset();
+    trace_get_summary(TRACE_TOTAL, &s);
+    CHECK_EQ(s.count, 0);
+    CHECK_EQ(trace_last_us(TRACE_TOTAL), 0);
+}
+
+static std::atomic<int> applied_calls{0};
+static std::atomic<uint32_t> applied_seq{0};
+static std::atomic<uint32_t> applied_total_us{0};
+
+static void on_applied(uint16_t seq, uint32_t total_us)
+{
+    applied_seq = seq;
+    applied_total_us = total_us;
+    applied_calls++;
+}
+
+static void test_end_to_end(uint16_t port)
+{
+    trace_reset();
+    trace_set_applied_callback(on_applied);
+
+    int ws = test_ws_connect(port);
+    CHECK(ws >= 0);
+    static const char cmd[] = "{\"cmd\":\"drive\",\"speed\":5,\"steer\":0,\"seq\":7}";
+    CHECK(test_ws_send(ws, 0x1, cmd, sizeof(cmd) - 1));
+
+    trace_summary_t s;
+    CHECK(test_wait_until([&] {
+        trace_get_summary(TRACE_TOTAL, &s);
+        return s.count == 1;
+    }, 2000));
+
+    // Stages add up: total covers parse, dispatch and apply
+    uint32_t parts = trace_last_us(TRACE_PARSE) + trace_last_us(TRACE_DISPATCH) +
+                     trace_last_us(TRACE_APPLY);
+    CHECK(trace_last_us(TRACE_TOTAL) >= parts - 2);
+    CHECK(trace_last_us(TRACE_TOTAL) <= parts + 2);
+    // One control period at most, plus scheduling slack
+    CHECK(trace_last_us(TRACE_APPLY) < 50000);
+
+    // Applied commands are reported with the sender's sequence number
+    CHECK(test_wait_until([] { return applied_calls.load() == 1; }, 1000));
+    CHECK_EQ(applied_seq.load(), 7);
+    CHECK_EQ(applied_total_us.load(), trace_last_us(TRACE_TOTAL));
+
+    // The same histograms over HTTP and as a WS telemetry message
+    std::string metrics;
+    CHECK_EQ(test_http(port, "GET", "/metrics", "", &metrics), 200);
+    CHECK(metrics.find("rc_cmd_latency_us_count{stage=\"total\"} 1\n") != std::string::npos);
+    CHECK(metrics.find("rc_cmd_latency_us{stage=\"apply\",quantile=\"0.99\"}") !=
+          std::string::npos);
+
+    static const char req[] = "{\"cmd\":\"metrics\"}";
+    CHECK(test_ws_send(ws, 0x1, req, sizeof(req) - 1));
+    std::string reply = test_ws_recv_text(ws);
+    CHECK(reply.compare(0, 27, "{\"cmd\":\"metrics\",\"latency\":") == 0);
+    CHECK(reply.find("\"total\":{\"n\":1,") != std::string::npos);
+    close(ws);
+}
+
+int main(void)
+{
+    test_histogram();
+
+    test_boot_motor();
+    uint16_t port = test_start_server();
+    test_sleep_ms(MOTOR_STBY_SETTLE_MS + 20);
+    test_end_to_end(port);
+    test_exit("test_latency_trace");
+}
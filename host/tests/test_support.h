@@ -0,0 +1,357 @@
+#pragma once
+
+/*
+ * Minimal test harness for the host tests: CHECK macros, a polling wait,
+ * and a blocking HTTP / WebSocket client for the loopback tests.
+ *
+ * Each test is its own executable and process, so module state (the
+ * in-memory NVS, the config copy, the motor mailbox) starts fresh.
+ * Failures are printed with file and line and make the test exit 1.
+ */
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "host_hal.h"
+
+/* =====================================================
+ *              CHECKS
+ * ===================================================== */
+
+static int test_failures = 0;
+
+#define CHECK(cond)                                                       \
+    do {                                                                  \
+        if (!(cond)) {                                                    \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n",                  \
+                    __FILE__, __LINE__, #cond);                           \
+            test_failures++;                                              \
+        }                                                                 \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                    \
+    do {                                                                  \
+        long long va_ = (long long)(a), vb_ = (long long)(b);             \
+        if (va_ != vb_) {                                                 \
+            fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", \
+                    __FILE__, __LINE__, #a, #b, va_, vb_);                \
+            test_failures++;                                              \
+        }                                                                 \
+    } while (0)
+
+// Reports and exits without static destructors: the simulated tasks and
+// timers are still running and must not see their state torn down
+[[noreturn]] static inline void test_exit(const char *name)
+{
+    if (test_failures)
+        printf("%s: %d check(s) failed\n", name, test_failures);
+    else
+        printf("%s: ok\n", name);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(test_failures ? 1 : 0);
+}
+
+// Polls pred every millisecond; false if it is still false after timeout_ms
+template <typename Pred>
+static bool test_wait_until(Pred pred, int timeout_ms)
+{
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() > end)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+static inline void test_sleep_ms(int ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+/* =====================================================
+ *              LOOPBACK CLIENT
+ * =====================================================
+ *
+ * Enough HTTP/1.1 and RFC 6455 to talk to the simulated server: one
+ * request per connection, masked client frames, unfragmented replies.
+ */
+
+/** rcvbuf > 0 sets SO_RCVBUF before connecting, so the window stays small */
+static inline int test_connect(uint16_t port, int rcvbuf = 0)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (rcvbuf > 0)
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+static inline bool test_send_all(int fd, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    while (len) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// Reads exactly len bytes; false on close or after timeout_ms of silence
+static inline bool test_recv_all(int fd, void *data, size_t len, int timeout_ms)
+{
+    uint8_t *p = (uint8_t *)data;
+    while (len) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) <= 0)
+            return false;
+        ssize_t n = recv(fd, p, len, 0);
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/**
+ * One request on a fresh connection. Returns the status code (or -1) and
+ * the body (Content-Length or chunked). headers, if given, are extra
+ * header lines, each ending in "\r\n".
+ */
+static inline int test_http(uint16_t port, const char *method, const char *path,
+                            const std::string &body, std::string *resp = NULL,
+                            const char *headers = "")
+{
+    int fd = test_connect(port);
+    if (fd < 0)
+        return -1;
+
+    char hdr[512];
+    int n = snprintf(hdr, sizeof(hdr),
+                     "%s %s HTTP/1.1\r\nHost: localhost\r\nContent-Length: %zu\r\n"
+                     "%sConnection: close\r\n\r\n", method, path, body.size(), headers);
+    if (!test_send_all(fd, hdr, (size_t)n) || !test_send_all(fd, body.data(), body.size())) {
+        close(fd);
+        return -1;
+    }
+
+    // Headers byte by byte, then exactly Content-Length bytes
+    std::string head;
+    char c;
+    while (head.find("\r\n\r\n") == std::string::npos && test_recv_all(fd, &c, 1, 2000))
+        head += c;
+    int status = -1;
+    size_t length = 0;
+    sscanf(head.c_str(), "HTTP/1.1 %d", &status);
+    const char *cl = strcasestr(head.c_str(), "Content-Length:");
+    if (cl)
+        length = strtoul(cl + 15, NULL, 10);
+
+    std::string data;
+    if (strcasestr(head.c_str(), "Transfer-Encoding: chunked")) {
+        // "<hex size>\r\n<data>\r\n" until a zero-size chunk
+        for (;;) {
+            std::string line;
+            while (line.find("\r\n") == std::string::npos && test_recv_all(fd, &c, 1, 2000))
+                line += c;
+            size_t size = strtoul(line.c_str(), NULL, 16);
+            if (line.empty() || size == 0)
+                break;
+            std::string chunk(size + 2, '\0');
+            if (!test_recv_all(fd, &chunk[0], size + 2, 2000)) {
+                status = -1;
+                break;
+            }
+            data.append(chunk, 0, size);
+        }
+    } else {
+        data.assign(length, '\0');
+        if (length && !test_recv_all(fd, &data[0], length, 2000))
+            status = -1;
+    }
+    close(fd);
+    if (resp)
+        *resp = data;
+    return status;
+}
+
+/** Opens /ws and completes the upgrade; -1 on failure */
+static inline int test_ws_connect(uint16_t port, int rcvbuf = 0)
+{
+    int fd = test_connect(port, rcvbuf);
+    if (fd < 0)
+        return -1;
+
+    static const char req[] =
+        "GET /ws HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\n"
+        "Connection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n\r\n";
+    if (!test_send_all(fd, req, sizeof(req) - 1)) {
+        close(fd);
+        return -1;
+    }
+
+    std::string head;
+    char c;
+    while (head.find("\r\n\r\n") == std::string::npos && test_recv_all(fd, &c, 1, 2000))
+        head += c;
+    if (head.compare(0, 12, "HTTP/1.1 101") != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/** Sends one masked frame; fin=false leaves a fragmented message open */
+static inline bool test_ws_send(int fd, uint8_t opcode, const void *data, size_t len,
+                                bool fin = true)
+{
+    uint8_t hdr[14];
+    size_t n = 0;
+    hdr[n++] = (uint8_t)((fin ? 0x80 : 0) | opcode);
+    if (len < 126) {
+        hdr[n++] = (uint8_t)(0x80 | len);
+    } else if (len < 65536) {
+        hdr[n++] = 0x80 | 126;
+        hdr[n++] = (uint8_t)(len >> 8);
+        hdr[n++] = (uint8_t)len;
+    } else {
+        hdr[n++] = 0x80 | 127;
+        for (int i = 7; i >= 0; i--)
+            hdr[n++] = (uint8_t)((uint64_t)len >> (8 * i));
+    }
+    static const uint8_t mask[4] = {0x12, 0x34, 0x56, 0x78};
+    memcpy(hdr + n, mask, 4);
+    n += 4;
+
+    std::string payload((const char *)data, len);
+    for (size_t i = 0; i < len; i++)
+        payload[i] ^= (char)mask[i & 3];
+    return test_send_all(fd, hdr, n) && test_send_all(fd, payload.data(), len);
+}
+
+/**
+ * Receives one server frame (never masked). Returns the payload length,
+ * or -1 on close or timeout.
+ */
+static inline int test_ws_recv(int fd, uint8_t *opcode, void *buf, size_t cap,
+                               int timeout_ms = 2000)
+{
+    uint8_t hdr[2];
+    if (!test_recv_all(fd, hdr, 2, timeout_ms))
+        return -1;
+    uint64_t len = hdr[1] & 0x7f;
+    if (len == 126) {
+        uint8_t ext[2];
+        if (!test_recv_all(fd, ext, 2, timeout_ms))
+            return -1;
+        len = ((uint64_t)ext[0] << 8) | ext[1];
+    } else if (len == 127) {
+        uint8_t ext[8];
+        if (!test_recv_all(fd, ext, 8, timeout_ms))
+            return -1;
+        len = 0;
+        for (int i = 0; i < 8; i++)
+            len = (len << 8) | ext[i];
+    }
+    if (len > cap)
+        return -1;
+    if (len && !test_recv_all(fd, buf, (size_t)len, timeout_ms))
+        return -1;
+    *opcode = hdr[0] & 0x0f;
+    return (int)len;
+}
+
+/** Next text frame, skipping telemetry and other binary frames */
+static inline std::string test_ws_recv_text(int fd, int timeout_ms = 2000)
+{
+    static uint8_t buf[4096];
+    for (;;) {
+        uint8_t op;
+        int n = test_ws_recv(fd, &op, buf, sizeof(buf), timeout_ms);
+        if (n < 0)
+            return std::string();
+        if (op == 0x1)
+            return std::string((const char *)buf, (size_t)n);
+    }
+}
+
+/** True once the peer has closed the connection (EOF or a close frame) */
+static inline bool test_ws_closed(int fd, int timeout_ms)
+{
+    uint8_t buf[256];
+    for (;;) {
+        uint8_t op;
+        int n = test_ws_recv(fd, &op, buf, sizeof(buf), timeout_ms);
+        if (n < 0) {
+            // Timeout leaves the socket readable-but-silent; EOF reads 0
+            struct pollfd pfd = {fd, POLLIN, 0};
+            if (poll(&pfd, 1, 0) <= 0)
+                return false;
+            return recv(fd, buf, 1, MSG_PEEK) <= 0;
+        }
+        if (op == 0x8)
+            return true;
+    }
+}
+
+/* =====================================================
+ *              FIXTURES
+ * ===================================================== */
+
+#include "app_config.h"
+#include "failsafe.h"
+#include "motor_control.h"
+#include "nvs_flash.h"
+#include "web_server.h"
+
+/** The nvs and motor boot stages: config loaded, control task running */
+static inline void test_boot_motor(void)
+{
+    nvs_flash_init();
+    app_config_init();
+
+    app_config_t cfg;
+    app_config_get(&cfg);
+    motor_init();
+    motor_control_start(cfg.control_rate_hz);
+    failsafe_init(cfg.failsafe_timeout_ms, cfg.failsafe_ramp_ms);
+}
+
+/**
+ * Starts the real web server on a free port (RC_SIM_PORT=0) and returns
+ * the port. Config and motor stages are up to the test.
+ */
+static inline uint16_t test_start_server(void)
+{
+    setenv("RC_SIM_PORT", "0", 1);
+    start_server();
+    test_wait_until([] { return host_httpd_port() != 0; }, 2000);
+    return host_httpd_port();
+}
@@ -0,0 +1,164 @@
+// Telemetry push: frame rate and payload encoding on a healthy client,
+// and a client that stops reading losing frames without slowing the
+// others down.
+//
+// The test runs its own server with only the /ws endpoint, so the push
+// rate can be raised well above TELEMETRY_RATE_HZ: a stalled socket then
+// fills within a second instead of minutes.
+
+#include "test_support.h"
+
+#include <vector>
+
+#include "control_protocol.h"
+#include "esp_http_server.h"
+#include "esp_timer.h"
+#include "telemetry.h"
+
+#define RATE_HZ 200
+#define PERIOD_MS (1000 / RATE_HZ)
+
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    // Clients in this test never send; accept the handshake only
+    return req->method == HTTP_GET ? ESP_OK : ESP_FAIL;
+}
+
+static uint16_t start_telemetry_server(void)
+{
+    setenv("RC_SIM_PORT", "0", 1);
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    httpd_handle_t server = NULL;
+    if (httpd_start(&server, &config) != ESP_OK)
+        return 0;
+
+    httpd_uri_t ws{};
+    ws.uri = "/ws";
+    ws.method = HTTP_GET;
+    ws.handler = ws_handler;
+    ws.is_websocket = true;
+    httpd_register_uri_handler(server, &ws);
+
+    telemetry_start(server, RATE_HZ);
+    return host_httpd_port();
+}
+
+// Every telemetry frame that arrives within ms, decoded
+static std::vector<ctrl_telemetry_t> collect(int fd, int ms)
+{
+    std::vector<ctrl_telemetry_t> out;
+    int64_t end = esp_timer_get_time() + (int64_t)ms * 1000;
+    uint8_t buf[64];
+    while (esp_timer_get_time() < end) {
+        uint8_t op;
+        int n = test_ws_recv(fd, &op, buf, sizeof(buf), 100);
+        if (n < 0)
+            continue;
+        ctrl_telemetry_t t;
+        CHECK_EQ(op, 0x2);
+        CHECK_EQ(n, CTRL_TELEM_SIZE);
+        CHECK(ctrl_decode_telemetry(buf, (size_t)n, &t));
+        out.push_back(t);
+    }
+    return out;
+}
+
+static void test_rate_and_payload(int fd)
+{
+    // Spin in place: left wheels reverse, right wheels forward
+    motor_set_slew(0, 0);
+    set_wheels(-6, -6, 6, 6);
+    test_sleep_ms(200);
+    int16_t duty[4];
+    motor_get_outputs(duty);
+
+    // Frames queued while the wheels settled would inflate the rate
+    uint8_t buf[64];
+    uint8_t op;
+    while (test_ws_recv(fd, &op, buf, sizeof(buf), 0) >= 0)
+        ;
+
+    std::vector<ctrl_telemetry_t> frames = collect(fd, 1000);
+    printf("healthy client: %zu frames/s\n", frames.size());
+    CHECK(frames.size() >= RATE_HZ * 8 / 10);
+    CHECK(frames.size() <= RATE_HZ * 12 / 10);
+    if (frames.size() < 2)
+        return;
+
+    // One snapshot per tick: consecutive sequence numbers, period spacing
+    uint32_t gaps = 0;
+    for (size_t i = 1; i < frames.size(); i++) {
+        CHECK_EQ((uint16_t)(frames[i].seq - frames[i - 1].seq), 1);
+        uint32_t dt = frames[i].t_ms - frames[i - 1].t_ms;
+        if (dt > PERIOD_MS * 4)
+            gaps++;
+    }
+    CHECK(gaps <= frames.size() / 50);
+
+    const ctrl_telemetry_t &t = frames.back();
+    for (int w = 0; w < 4; w++)
+        CHECK_EQ(t.duty[w], duty[w]);
+    CHECK(duty[0] != 0);
+    CHECK(t.heap_free > 0);
+    CHECK_EQ(t.flags & CTRL_TELEM_FLAG_FAILSAFE, 0);
+}
+
+static void test_slow_client(uint16_t port, int healthy)
+{
+    // A client with a small receive window that never reads
+    int slow = test_ws_connect(port, 1024);
+    CHECK(slow >= 0);
+
+    telemetry_stats_t s0, s1;
+    telemetry_get_stats(&s0);
+    bool dropping = test_wait_until([&] {
+        uint8_t buf[64];
+        uint8_t op;
+        // Keep the healthy client drained while the slow one fills up
+        while (test_ws_recv(healthy, &op, buf, sizeof(buf), 0) >= 0)
+            ;
+        telemetry_get_stats(&s1);
+        return s1.dropped > s0.dropped;
+    }, 10000);
+    CHECK(dropping);
+
+    // Frames keep flowing to the healthy client at the full rate
+    telemetry_get_stats(&s0);
+    std::vector<ctrl_telemetry_t> frames = collect(healthy, 1000);
+    telemetry_get_stats(&s1);
+    printf("with a stalled client: %zu frames/s, %u dropped/s, %u ticks skipped\n",
+           frames.size(), (unsigned)(s1.dropped - s0.dropped),
+           (unsigned)(s1.skipped - s0.skipped));
+    CHECK(frames.size() >= RATE_HZ * 8 / 10);
+    CHECK(s1.dropped > s0.dropped);
+    CHECK(s1.skipped - s0.skipped <= RATE_HZ / 20);
+
+    // Skipped frames are skipped whole: once it reads again, every frame
+    // it gets still decodes (collect checks each one)
+    frames = collect(slow, 500);
+    CHECK(!frames.empty());
+    close(slow);
+}
+
+int main(void)
+{
+    // Config and motor stages only: no failsafe to ramp the wheels down
+    nvs_flash_init();
+    app_config_init();
+    app_config_t cfg;
+    app_config_get(&cfg);
+    motor_init();
+    motor_control_start(cfg.control_rate_hz);
+
+    uint16_t port = start_telemetry_server();
+    CHECK(port != 0);
+
+    int healthy = test_ws_connect(port);
+    CHECK(healthy >= 0);
+    if (healthy < 0)
+        test_exit("test_telemetry");
+
+    test_rate_and_payload(healthy);
+    test_slow_client(port, healthy);
+    test_exit("test_telemetry");
+}
@@ -0,0 +1,104 @@
+// UDP control: one sender holds the link, a second one is ignored until
+// the holder has been idle for UDP_SESSION_IDLE_MS, then takes over with
+// a fresh sequence.
+
+#include "test_support.h"
+
+#include "control_protocol.h"
+#include "udp_control.h"
+
+static uint16_t free_udp_port(void)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (struct sockaddr *)&addr, &len);
+    close(fd);
+    return ntohs(addr.sin_port);
+}
+
+static int udp_sender(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+    return fd;
+}
+
+static void send_drive(int fd, q15_t speed, uint16_t seq)
+{
+    ctrl_frame_t cf{};
+    cf.version = CTRL_PROTO_VERSION;
+    cf.speed = speed;
+    cf.seq = seq;
+    uint8_t buf[CTRL_FRAME_SIZE];
+    ctrl_encode_binary(&cf, buf);
+    send(fd, buf, sizeof(buf), 0);
+}
+
+static udp_control_stats_t wait_packets(uint32_t packets)
+{
+    udp_control_stats_t s;
+    test_wait_until([&] {
+        udp_control_get_stats(&s);
+        return s.packets >= packets;
+    }, 2000);
+    return s;
+}
+
+int main(void)
+{
+    test_boot_motor();
+    motor_set_slew(0, 0);
+    uint16_t port = free_udp_port();
+    udp_control_start(port);
+
+    int a = udp_sender(port);
+    int b = udp_sender(port);
+
+    // a takes the link and drives forward
+    send_drive(a, Q15_ONE / 2, 1);
+    udp_control_stats_t s = wait_packets(1);
+    CHECK_EQ(s.accepted, 1);
+    CHECK_EQ(s.sessions, 1);
+
+    // b is ignored while a keeps sending, whatever its sequence numbers
+    for (uint16_t i = 0; i < 5; i++) {
+        send_drive(b, -Q15_ONE / 2, (uint16_t)(1000 + i));
+        send_drive(a, Q15_ONE / 2, (uint16_t)(2 + i));
+    }
+    s = wait_packets(11);
+    CHECK_EQ(s.busy, 5);
+    CHECK_EQ(s.accepted, 6);
+    CHECK_EQ(s.stale, 0);
+    CHECK_EQ(s.sessions, 1);
+    q15_t duty[4];
+    CHECK(test_wait_until([&] { motor_get_outputs(duty); return duty[0] > 0; }, 500));
+
+    // Once a is silent for the idle period, b takes over from seq 1
+    test_sleep_ms(UDP_SESSION_IDLE_MS + 100);
+    send_drive(b, -Q15_ONE / 2, 1);
+    s = wait_packets(12);
+    CHECK_EQ(s.sessions, 2);
+    CHECK_EQ(s.accepted, 7);
+    CHECK(test_wait_until([&] { motor_get_outputs(duty); return duty[0] < 0; }, 500));
+
+    // Now a is the one shut out
+    send_drive(a, Q15_ONE / 2, 100);
+    s = wait_packets(13);
+    CHECK_EQ(s.busy, 6);
+    CHECK_EQ(s.accepted, 7);
+
+    // The holder's own stale frames are still rejected by sequence
+    send_drive(b, -Q15_ONE / 2, 1);
+    s = wait_packets(14);
+    CHECK_EQ(s.stale, 1);
+
+    test_exit("test_udp_control");
+}
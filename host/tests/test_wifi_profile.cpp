@@ -0,0 +1,193 @@
+// Wi-Fi profile: channel selection from scan results, profile selection
+// through the config, and the NVS overrides with their range checks.
+
+#include "test_support.h"
+
+#include "app_config.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "wifi_profile.h"
+
+static void test_pick_channel(void)
+{
+    // Nothing heard: channel 1
+    CHECK_EQ(wifi_profile_pick_channel(NULL, 0), 1);
+
+    // One AP on 1 loads 1 .. 4; 6 and 11 are both clear, 6 wins the tie
+    wifi_scan_entry_t one[] = {{1, -40}};
+    CHECK_EQ(wifi_profile_pick_channel(one, 1), 6);
+
+    // Busy 1 and 6: 11 is clear
+    wifi_scan_entry_t two[] = {{1, -40}, {6, -50}};
+    CHECK_EQ(wifi_profile_pick_channel(two, 2), 11);
+
+    // Equal APs on 1, 6 and 11 load every channel alike: 1 wins the tie
+    wifi_scan_entry_t three[] = {{1, -60}, {6, -60}, {11, -60}};
+    CHECK_EQ(wifi_profile_pick_channel(three, 3), 1);
+
+    // Sharing with one faint AP beats overlapping two strong ones
+    wifi_scan_entry_t shared[] = {{1, -40}, {6, -85}, {11, -40}};
+    CHECK_EQ(wifi_profile_pick_channel(shared, 3), 6);
+
+    // A strong AP outweighs several weak ones
+    wifi_scan_entry_t mixed[] = {{1, -90}, {1, -90}, {1, -90}, {11, -30}};
+    CHECK_EQ(wifi_profile_pick_channel(mixed, 4), 6);
+
+    // Below the -95 dBm floor an AP counts for nothing
+    wifi_scan_entry_t faint[] = {{1, -96}, {6, -100}};
+    CHECK_EQ(wifi_profile_pick_channel(faint, 2), 1);
+
+    // APs outside 1 .. 11 still load their neighbours
+    wifi_scan_entry_t high[] = {{13, -40}, {1, -40}};
+    CHECK_EQ(wifi_profile_pick_channel(high, 2), 6);
+}
+
+static bool same(const wifi_profile_t &a, const wifi_profile_t &b)
+{
+    return a.mode == b.mode && a.channel == b.channel &&
+           a.beacon_interval == b.beacon_interval && a.dtim_period == b.dtim_period &&
+           a.max_tx_power == b.max_tx_power && a.power_save == b.power_save &&
+           a.ampdu_tx == b.ampdu_tx && a.ampdu_rx == b.ampdu_rx &&
+           a.bandwidth_mhz == b.bandwidth_mhz;
+}
+
+static void test_defaults(void)
+{
+    wifi_profile_t p, d;
+
+    // Empty namespace: the mode's defaults, unchanged
+    CHECK_EQ(wifi_profile_load(WIFI_PROFILE_LOW_LATENCY, &p), ESP_OK);
+    wifi_profile_defaults(WIFI_PROFILE_LOW_LATENCY, &d);
+    CHECK(same(p, d));
+    CHECK_EQ(p.beacon_interval, 100);
+    CHECK_EQ(p.dtim_period, 1);
+    CHECK(!p.power_save);
+
+    CHECK_EQ(wifi_profile_load(WIFI_PROFILE_DEFAULT, &p), ESP_OK);
+    CHECK_EQ(p.mode, WIFI_PROFILE_DEFAULT);
+    CHECK_EQ(p.channel, 1);
+    CHECK(p.power_save);
+
+    CHECK_EQ(wifi_profile_load((wifi_profile_mode_t)7, &p), ESP_OK);
+    CHECK_EQ(p.mode, WIFI_PROFILE_DEFAULT_MODE);
+
+    // Low latency scans at boot, so it is opt-in through the config
+    // field, a boot field
+    CHECK_EQ(WIFI_PROFILE_DEFAULT_MODE, WIFI_PROFILE_DEFAULT);
+    app_config_t cfg;
+    app_config_get(&cfg);
+    CHECK_EQ(cfg.wifi_profile, WIFI_PROFILE_DEFAULT);
+    char err[64];
+    bool reboot = false;
+    const char *bad = "{\"wifi_profile\":2}";
+    CHECK_EQ(app_config_update_json(bad, strlen(bad), err, sizeof(err), NULL),
+             ESP_ERR_INVALID_ARG);
+    const char *good = "{\"wifi_profile\":1}";
+    CHECK_EQ(app_config_update_json(good, strlen(good), err, sizeof(err), &reboot), ESP_OK);
+    CHECK(reboot);
+    app_config_init();
+    app_config_get(&cfg);
+    CHECK_EQ(cfg.wifi_profile, WIFI_PROFILE_LOW_LATENCY);
+}
+
+static void test_nvs_round_trip(void)
+{
+    wifi_profile_t saved;
+    wifi_profile_defaults(WIFI_PROFILE_LOW_LATENCY, &saved);
+    saved.channel = 11;
+    saved.beacon_interval = 200;
+    saved.dtim_period = 3;
+    saved.max_tx_power = 60;
+    saved.power_save = true;
+    saved.ampdu_rx = true;
+    saved.bandwidth_mhz = 40;
+    CHECK_EQ(wifi_profile_save(&saved), ESP_OK);
+
+    // Overrides apply on top of whichever mode is selected
+    wifi_profile_t p;
+    CHECK_EQ(wifi_profile_load(WIFI_PROFILE_LOW_LATENCY, &p), ESP_OK);
+    CHECK(same(p, saved));
+    CHECK_EQ(wifi_profile_load(WIFI_PROFILE_DEFAULT, &p), ESP_OK);
+    CHECK_EQ(p.mode, WIFI_PROFILE_DEFAULT);
+    CHECK_EQ(p.channel, 11);
+    CHECK_EQ(p.bandwidth_mhz, 40);
+
+    // 0 means "driver default" and is always accepted
+    wifi_profile_t zero = saved;
+    zero.channel = 0;
+    zero.beacon_interval = 0;
+    zero.dtim_period = 0;
+    zero.max_tx_power = 0;
+    zero.bandwidth_mhz = 0;
+    CHECK_EQ(wifi_profile_save(&zero), ESP_OK);
+    CHECK_EQ(wifi_profile_load(WIFI_PROFILE_LOW_LATENCY, &p), ESP_OK);
+    CHECK(same(p, zero));
+}
+
+static void test_out_of_range(void)
+{
+    wifi_profile_t d;
+    wifi_profile_defaults(WIFI_PROFILE_LOW_LATENCY, &d);
+
+    struct {
+        const char *key;
+        int type;       // 0 = u8, 1 = u16, 2 = i8
+        int value;
+    } cases[] = {
+        {"channel", 0, 12}, {"channel", 0, 14},
+        {"beacon", 1, 50}, {"beacon", 1, 99}, {"beacon", 1, 60001},
+        {"dtim", 0, 11},
+        {"tx_power", 2, 7}, {"tx_power", 2, 85}, {"tx_power", 2, -4},
+        {"bandwidth", 0, 10}, {"bandwidth", 0, 80},
+    };
+
+    for (const auto &c : cases) {
+        // Start from a clean namespace holding only this one value
+        nvs_handle_t h;
+        CHECK_EQ(nvs_open(WIFI_PROFILE_NVS_NAMESPACE, NVS_READWRITE, &h), ESP_OK);
+        nvs_erase_all(h);
+        if (c.type == 0)
+            nvs_set_u8(h, c.key, (uint8_t)c.value);
+        else if (c.type == 1)
+            nvs_set_u16(h, c.key, (uint16_t)c.value);
+        else
+            nvs_set_i8(h, c.key, (int8_t)c.value);
+        nvs_commit(h);
+        nvs_close(h);
+
+        wifi_profile_t p;
+        esp_err_t err = wifi_profile_load(WIFI_PROFILE_LOW_LATENCY, &p);
+        if (err != ESP_ERR_INVALID_ARG || !same(p, d))
+            fprintf(stderr, "%s = %d not rejected\n", c.key, c.value);
+        CHECK_EQ(err, ESP_ERR_INVALID_ARG);
+        CHECK(same(p, d));
+    }
+
+    // One bad field does not discard the good ones next to it
+    nvs_handle_t h;
+    CHECK_EQ(nvs_open(WIFI_PROFILE_NVS_NAMESPACE, NVS_READWRITE, &h), ESP_OK);
+    nvs_erase_all(h);
+    nvs_set_u8(h, "channel", 6);
+    nvs_set_u16(h, "beacon", 20);
+    nvs_set_u8(h, "dtim", 2);
+    nvs_commit(h);
+    nvs_close(h);
+
+    wifi_profile_t p;
+    CHECK_EQ(wifi_profile_load(WIFI_PROFILE_LOW_LATENCY, &p), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(p.channel, 6);
+    CHECK_EQ(p.beacon_interval, d.beacon_interval);
+    CHECK_EQ(p.dtim_period, 2);
+}
+
+int main(void)
+{
+    nvs_flash_init();
+    app_config_init();
+
+    test_pick_channel();
+    test_defaults();
+    test_nvs_round_trip();
+    test_out_of_range();
+    test_exit("test_wifi_profile");
+}
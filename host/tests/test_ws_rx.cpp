@@ -0,0 +1,180 @@
+// WebSocket receive limits: frames over WS_MAX_FRAME_LEN, truncated
+// payloads, wrongly sized binary frames and fragmented messages are each
+// counted and close the connection; a frame of exactly the maximum size
+// still goes through. Control frames sent before the switch to binary,
+// or that do not decode, are counted and dropped on an open connection.
+
+#include "test_support.h"
+
+#include "control_protocol.h"
+
+#include <sys/socket.h>
+
+static ws_rx_stats_t stats_now(void)
+{
+    ws_rx_stats_t s;
+    ws_get_rx_stats(&s);
+    return s;
+}
+
+// Frame header promising len payload bytes, then only part of it and EOF
+static void send_truncated(int fd, uint8_t opcode, size_t len, size_t sent)
+{
+    uint8_t hdr[8] = {(uint8_t)(0x80 | opcode), (uint8_t)(0x80 | len), 1, 2, 3, 4};
+    std::string payload(sent, 'x');
+    test_send_all(fd, hdr, 6);
+    test_send_all(fd, payload.data(), payload.size());
+    shutdown(fd, SHUT_WR);
+}
+
+static void test_max_size(uint16_t port)
+{
+    // A ping padded with whitespace to exactly the limit
+    std::string cmd = "{\"cmd\":\"ping\"}";
+    cmd.insert(1, WS_MAX_FRAME_LEN - cmd.size(), ' ');
+    CHECK_EQ(cmd.size(), WS_MAX_FRAME_LEN);
+
+    ws_rx_stats_t before = stats_now();
+    int ws = test_ws_connect(port);
+    CHECK(ws >= 0);
+    CHECK(test_ws_send(ws, 0x1, cmd.data(), cmd.size()));
+    static const char req[] = "{\"cmd\":\"metrics\"}";
+    CHECK(test_ws_send(ws, 0x1, req, sizeof(req) - 1));
+    CHECK(!test_ws_recv_text(ws).empty());
+    CHECK(!test_ws_closed(ws, 100));
+    close(ws);
+
+    ws_rx_stats_t after = stats_now();
+    CHECK_EQ(after.oversized, before.oversized);
+    CHECK_EQ(after.truncated, before.truncated);
+}
+
+static void test_oversized(uint16_t port)
+{
+    ws_rx_stats_t before = stats_now();
+
+    int ws = test_ws_connect(port);
+    std::string big(WS_MAX_FRAME_LEN + 1, ' ');
+    CHECK(test_ws_send(ws, 0x1, big.data(), big.size()));
+    CHECK(test_ws_closed(ws, 2000));
+    close(ws);
+
+    // 64-bit length field, nowhere near a real payload
+    ws = test_ws_connect(port);
+    uint8_t hdr[14] = {0x81, 0x80 | 127, 0, 0, 0, 1, 0, 0, 0, 0, 1, 2, 3, 4};
+    CHECK(test_send_all(ws, hdr, sizeof(hdr)));
+    CHECK(test_ws_closed(ws, 2000));
+    close(ws);
+
+    CHECK_EQ(stats_now().oversized - before.oversized, 2);
+}
+
+static void test_truncated(uint16_t port)
+{
+    ws_rx_stats_t before = stats_now();
+
+    // Binary control frame cut short: 5 of 8 bytes
+    int ws = test_ws_connect(port);
+    send_truncated(ws, 0x2, CTRL_FRAME_SIZE, 5);
+    CHECK(test_ws_closed(ws, 2000));
+    close(ws);
+
+    // Text frame cut short
+    ws = test_ws_connect(port);
+    send_truncated(ws, 0x1, 100, 10);
+    CHECK(test_ws_closed(ws, 2000));
+    close(ws);
+
+    CHECK(test_wait_until([&] { return stats_now().truncated - before.truncated == 2; }, 2000));
+
+    // Binary frames of the wrong size never get as far as a read
+    ws = test_ws_connect(port);
+    uint8_t seven[7] = {CTRL_PROTO_VERSION};
+    CHECK(test_ws_send(ws, 0x2, seven, sizeof(seven)));
+    CHECK(test_ws_closed(ws, 2000));
+    close(ws);
+    CHECK_EQ(stats_now().bad_binary - before.bad_binary, 1);
+}
+
+static void test_fragmented(uint16_t port)
+{
+    ws_rx_stats_t before = stats_now();
+
+    // First fragment of a text message
+    int ws = test_ws_connect(port);
+    static const char part[] = "{\"cmd\":";
+    CHECK(test_ws_send(ws, 0x1, part, sizeof(part) - 1, false));
+    CHECK(test_ws_closed(ws, 2000));
+    close(ws);
+
+    // A stray continuation frame
+    ws = test_ws_connect(port);
+    static const char rest[] = "\"ping\"}";
+    CHECK(test_ws_send(ws, 0x0, rest, sizeof(rest) - 1));
+    CHECK(test_ws_closed(ws, 2000));
+    close(ws);
+
+    ws_rx_stats_t after = stats_now();
+    CHECK_EQ(after.fragmented - before.fragmented, 2);
+    CHECK_EQ(after.oversized, before.oversized);
+
+    std::string metrics;
+    CHECK_EQ(test_http(port, "GET", "/metrics", "", &metrics), 200);
+    char line[64];
+    snprintf(line, sizeof(line), "rc_ws_rx_rejected{reason=\"fragmented\"} %u\n",
+             (unsigned)after.fragmented);
+    CHECK(metrics.find(line) != std::string::npos);
+}
+
+static void test_dropped_binary(uint16_t port)
+{
+    ws_rx_stats_t before = stats_now();
+
+    // A valid drive frame, but the session is still in JSON mode
+    int ws = test_ws_connect(port);
+    ctrl_frame_t cf = {CTRL_PROTO_VERSION, 0, 1000, 0, 1};
+    uint8_t buf[CTRL_FRAME_MAX];
+    size_t len = ctrl_encode_binary(&cf, buf);
+    CHECK(test_ws_send(ws, 0x2, buf, len));
+    CHECK(test_wait_until([&] { return stats_now().binary_in_json - before.binary_in_json == 1; }, 2000));
+
+    // After the switch: an unknown version, and a wheel-sized frame
+    // without the wheel flag
+    static const char hello[] = "{\"cmd\":\"hello\",\"proto\":\"bin\"}";
+    CHECK(test_ws_send(ws, 0x1, hello, sizeof(hello) - 1));
+    CHECK(test_ws_recv_text(ws).find("\"proto\":\"bin\"") != std::string::npos);
+    buf[0] = 9;
+    CHECK(test_ws_send(ws, 0x2, buf, len));
+    uint8_t wide[CTRL_WHEELS_FRAME_SIZE] = {CTRL_PROTO_VERSION};
+    CHECK(test_ws_send(ws, 0x2, wide, sizeof(wide)));
+    CHECK(test_wait_until([&] { return stats_now().bad_decode - before.bad_decode == 2; }, 2000));
+    CHECK(!test_ws_closed(ws, 100));
+    close(ws);
+
+    ws_rx_stats_t after = stats_now();
+    CHECK_EQ(after.binary_in_json - before.binary_in_json, 1);
+    CHECK_EQ(after.bad_binary, before.bad_binary);
+
+    std::string metrics;
+    CHECK_EQ(test_http(port, "GET", "/metrics", "", &metrics), 200);
+    char line[64];
+    snprintf(line, sizeof(line), "rc_ws_rx_rejected{reason=\"binary_in_json\"} %u\n",
+             (unsigned)after.binary_in_json);
+    CHECK(metrics.find(line) != std::string::npos);
+    snprintf(line, sizeof(line), "rc_ws_rx_rejected{reason=\"bad_decode\"} %u\n",
+             (unsigned)after.bad_decode);
+    CHECK(metrics.find(line) != std::string::npos);
+}
+
+int main(void)
+{
+    test_boot_motor();
+    uint16_t port = test_start_server();
+
+    test_max_size(port);
+    test_oversized(port);
+    test_truncated(port);
+    test_fragmented(port);
+    test_dropped_binary(port);
+    test_exit("test_ws_rx");
+}
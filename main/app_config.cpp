@@ -0,0 +1,499 @@
+#include "app_config.h"
+#include "motor_control.h"
+#include "drive_mixer.h"
+#include "failsafe.h"
+#include "drivetrain.h"
+#include "wifi_profile.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "nvs.h"
+#include "cJSON.h"
+
+static const char *TAG = "app_config";
+
+/* =====================================================
+ *              DEFAULTS
+ * ===================================================== */
+
+// Pin defaults come from the chassis description; slots without a
+// wheel stay 0 and are ignored
+void app_config_defaults(app_config_t *out)
+{
+    *out = app_config_t{};
+    out->pin_stby = drivetrain.stby;
+    for (const auto &w : drivetrain.wheels)
+        out->wheel[w.slot] = app_config_wheel_t{w.in1, w.in2, w.pwm};
+    out->pwm_freq_hz = MOTOR_PWM_FREQ_HZ;
+    out->control_rate_hz = MOTOR_CONTROL_RATE_HZ;
+    out->min_duty_pct = MOTOR_MIN_DUTY_PCT;
+    out->curve_pct = MOTOR_CURVE_PCT;
+    out->accel_ms = MOTOR_ACCEL_MS;
+    out->decel_ms = MOTOR_DECEL_MS;
+    out->failsafe_timeout_ms = FAILSAFE_TIMEOUT_MS;
+    out->failsafe_ramp_ms = FAILSAFE_RAMP_MS;
+    out->mixer = DRIVE_MIXER_DEFAULT_MODE;
+    snprintf(out->ssid, sizeof(out->ssid), "RC-ESP32");
+    out->max_connection = 4;
+    out->wifi_profile = WIFI_PROFILE_DEFAULT_MODE;
+}
+
+/* =====================================================
+ *              FIELD TABLE
+ * =====================================================
+ *
+ * One row per field: its NVS key and JSON member name (at most 15
+ * characters), storage type, location in app_config_t and valid range.
+ * For strings the range is the length.
+ */
+
+typedef enum { F_U8, F_U16, F_U32, F_STR } field_type_t;
+
+typedef struct {
+    const char *key;
+    field_type_t type;
+    uint16_t offset;
+    uint16_t size;
+    uint32_t min;
+    uint32_t max;
+    bool live;          // applied without a restart
+    bool secret;        // write-only, never reported
+} field_t;
+
+#define MEMBER_SIZE(m) sizeof(((app_config_t *)0)->m)
+#define FIELD(key, type, m, min, max, live) \
+    {key, type, offsetof(app_config_t, m), MEMBER_SIZE(m), min, max, live, false}
+#define PIN(key, m) FIELD(key, F_U8, m, 0, 33, false)   // GPIO34+ are input-only
+
+static const field_t fields[] = {
+    PIN("pin_stby", pin_stby),
+    PIN("lf_in1", wheel[0].in1), PIN("lf_in2", wheel[0].in2), PIN("lf_pwm", wheel[0].pwm),
+    PIN("lb_in1", wheel[1].in1), PIN("lb_in2", wheel[1].in2), PIN("lb_pwm", wheel[1].pwm),
+    PIN("rf_in1", wheel[2].in1), PIN("rf_in2", wheel[2].in2), PIN("rf_pwm", wheel[2].pwm),
+    PIN("rb_in1", wheel[3].in1), PIN("rb_in2", wheel[3].in2), PIN("rb_pwm", wheel[3].pwm),
+    FIELD("pwm_freq_hz", F_U32, pwm_freq_hz, 100, 40000, false),
+    FIELD("ctrl_rate_hz", F_U16, control_rate_hz, 10, 1000, false),
+    FIELD("min_duty_pct", F_U8, min_duty_pct, 0, 50, false),
+    FIELD("curve_pct", F_U8, curve_pct, 0, 100, false),
+    FIELD("accel_ms", F_U16, accel_ms, 0, 5000, true),
+    FIELD("decel_ms", F_U16, decel_ms, 0, 5000, true),
+    FIELD("fs_timeout_ms", F_U16, failsafe_timeout_ms, 20, 5000, true),
+    FIELD("fs_ramp_ms", F_U16, failsafe_ramp_ms, 1, 5000, true),
+    FIELD("mixer", F_U8, mixer, 0, DRIVE_MIXER_COUNT - 1, true),
+    FIELD("ssid", F_STR, ssid, 1, 32, false),
+    {"password", F_STR, offsetof(app_config_t, password), MEMBER_SIZE(password),
+     0, 64, false, true},
+    FIELD("max_conn", F_U8, max_connection, 1, 10, false),
+    FIELD("wifi_profile", F_U8, wifi_profile, 0, WIFI_PROFILE_COUNT - 1, false),
+};
+
+#define FIELD_COUNT (sizeof(fields) / sizeof(fields[0]))
+
+static inline void *field_ptr(app_config_t *cfg, const field_t &f)
+{
+    return (uint8_t *)cfg + f.offset;
+}
+
+static inline const void *field_ptr(const app_config_t *cfg, const field_t &f)
+{
+    return (const uint8_t *)cfg + f.offset;
+}
+
+static uint32_t get_uint(const app_config_t *cfg, const field_t &f)
+{
+    const void *p = field_ptr(cfg, f);
+    switch (f.type) {
+    case F_U8: return *(const uint8_t *)p;
+    case F_U16: return *(const uint16_t *)p;
+    case F_U32: return *(const uint32_t *)p;
+    default: return 0;
+    }
+}
+
+static void set_uint(app_config_t *cfg, const field_t &f, uint32_t v)
+{
+    void *p = field_ptr(cfg, f);
+    switch (f.type) {
+    case F_U8: *(uint8_t *)p = (uint8_t)v; break;
+    case F_U16: *(uint16_t *)p = (uint16_t)v; break;
+    case F_U32: *(uint32_t *)p = v; break;
+    default: break;
+    }
+}
+
+static bool field_equal(const app_config_t *a, const app_config_t *b, const field_t &f)
+{
+    if (f.type == F_STR)
+        return strcmp((const char *)field_ptr(a, f), (const char *)field_ptr(b, f)) == 0;
+    return get_uint(a, f) == get_uint(b, f);
+}
+
+// Rules spanning several fields; returns NULL or the reason
+static const char *check_consistency(const app_config_t *cfg)
+{
+    size_t pw = strlen(cfg->password);
+    if (pw > 0 && pw < 8)
+        return "password must be empty or 8-64 characters";
+
+    // Only the STBY pin and the wheels the chassis has are driven
+    uint64_t used = 1ULL << cfg->pin_stby;
+    if (!(DRIVETRAIN_OUTPUT_PINS & used))
+        return "motor pin is not an output GPIO";
+    for (const auto &w : drivetrain.wheels) {
+        const app_config_wheel_t &p = cfg->wheel[w.slot];
+        for (uint8_t pin : {p.in1, p.in2, p.pwm}) {
+            uint64_t bit = 1ULL << pin;
+            if (!(DRIVETRAIN_OUTPUT_PINS & bit))
+                return "motor pin is not an output GPIO";
+            if (used & bit)
+                return "motor pins must be distinct";
+            used |= bit;
+        }
+    }
+    return NULL;
+}
+
+/* =====================================================
+ *              RAM COPY
+ * =====================================================
+ *
+ * Readers copy the struct inside a short critical section, so they
+ * never see half an update. Updates come from one task (the HTTP
+ * server), and only that task writes NVS.
+ */
+
+static app_config_t current;
+static portMUX_TYPE current_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static app_config_listener_t listeners[APP_CONFIG_MAX_LISTENERS];
+static size_t listener_count = 0;
+
+static app_config_stats_t stats;
+
+void app_config_get(app_config_t *out)
+{
+    portENTER_CRITICAL(&current_mux);
+    *out = current;
+    portEXIT_CRITICAL(&current_mux);
+}
+
+static void publish(const app_config_t *cfg)
+{
+    portENTER_CRITICAL(&current_mux);
+    current = *cfg;
+    portEXIT_CRITICAL(&current_mux);
+}
+
+void app_config_subscribe(app_config_listener_t cb)
+{
+    if (listener_count < APP_CONFIG_MAX_LISTENERS)
+        listeners[listener_count++] = cb;
+    else
+        ESP_LOGE(TAG, "Too many config listeners");
+}
+
+void app_config_get_stats(app_config_stats_t *out)
+{
+    *out = stats;
+}
+
+/* =====================================================
+ *              NVS STORAGE
+ * ===================================================== */
+
+static esp_err_t read_field(nvs_handle_t h, const field_t &f, app_config_t *cfg)
+{
+    esp_err_t err;
+    uint32_t v = 0;
+
+    switch (f.type) {
+    case F_U8: {
+        uint8_t u = 0;
+        err = nvs_get_u8(h, f.key, &u);
+        v = u;
+        break;
+    }
+    case F_U16: {
+        uint16_t u = 0;
+        err = nvs_get_u16(h, f.key, &u);
+        v = u;
+        break;
+    }
+    case F_U32:
+        err = nvs_get_u32(h, f.key, &v);
+        break;
+    case F_STR: {
+        char buf[sizeof(app_config_t::password)];
+        size_t len = f.size;
+        err = nvs_get_str(h, f.key, buf, &len);
+        if (err != ESP_OK)
+            return err;
+        if (len - 1 < f.min || len - 1 > f.max)
+            return ESP_ERR_INVALID_SIZE;
+        memcpy(field_ptr(cfg, f), buf, len);
+        return ESP_OK;
+    }
+    default:
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (err != ESP_OK)
+        return err;
+    if (v < f.min || v > f.max)
+        return ESP_ERR_INVALID_SIZE;
+    set_uint(cfg, f, v);
+    return ESP_OK;
+}
+
+static esp_err_t write_field(nvs_handle_t h, const field_t &f, const app_config_t *cfg)
+{
+    uint32_t v = get_uint(cfg, f);
+    switch (f.type) {
+    case F_U8: return nvs_set_u8(h, f.key, (uint8_t)v);
+    case F_U16: return nvs_set_u16(h, f.key, (uint16_t)v);
+    case F_U32: return nvs_set_u32(h, f.key, v);
+    case F_STR: return nvs_set_str(h, f.key, (const char *)field_ptr(cfg, f));
+    default: return ESP_ERR_INVALID_ARG;
+    }
+}
+
+static void load(app_config_t *cfg)
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(APP_CONFIG_NVS_NAMESPACE, NVS_READONLY, &h);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+        return;
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Config not readable (%s), using defaults", esp_err_to_name(err));
+        stats.nvs_errors++;
+        return;
+    }
+
+    uint8_t schema = 0;
+    if (nvs_get_u8(h, "schema", &schema) == ESP_OK && schema > APP_CONFIG_SCHEMA) {
+        ESP_LOGW(TAG, "Config schema %u is newer than %u, using defaults",
+                 schema, APP_CONFIG_SCHEMA);
+        nvs_close(h);
+        return;
+    }
+    nvs_get_u32(h, "version", &cfg->version);
+
+    for (const field_t &f : fields) {
+        err = read_field(h, f, cfg);
+        if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(TAG, "Config %s ignored: %s", f.key, esp_err_to_name(err));
+            stats.nvs_errors++;
+        }
+    }
+    nvs_close(h);
+
+    const char *why = check_consistency(cfg);
+    if (why) {
+        ESP_LOGW(TAG, "Stored config rejected (%s), using defaults", why);
+        uint32_t version = cfg->version;
+        app_config_defaults(cfg);
+        cfg->version = version;
+    }
+}
+
+// Writes the fields that differ from old, then the new version
+static esp_err_t store(const app_config_t *old, const app_config_t *cfg)
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(APP_CONFIG_NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK)
+        return err;
+
+    err = nvs_set_u8(h, "schema", APP_CONFIG_SCHEMA);
+    for (size_t i = 0; i < FIELD_COUNT && err == ESP_OK; i++) {
+        if (!field_equal(old, cfg, fields[i]))
+            err = write_field(h, fields[i], cfg);
+    }
+    if (err == ESP_OK)
+        err = nvs_set_u32(h, "version", cfg->version);
+    if (err == ESP_OK)
+        err = nvs_commit(h);
+
+    nvs_close(h);
+    return err;
+}
+
+void app_config_init(void)
+{
+    app_config_t cfg;
+    app_config_defaults(&cfg);
+    load(&cfg);
+    publish(&cfg);
+
+    ESP_LOGI(TAG, "Config version %u loaded", (unsigned)cfg.version);
+}
+
+/* =====================================================
+ *              JSON
+ * ===================================================== */
+
+static void set_err(char *err, size_t err_len, const char *fmt, const char *arg)
+{
+    if (err && err_len)
+        snprintf(err, err_len, fmt, arg);
+}
+
+static const field_t *find_field(const char *key)
+{
+    for (const field_t &f : fields) {
+        if (strcmp(f.key, key) == 0)
+            return &f;
+    }
+    return NULL;
+}
+
+// Copies one JSON member into cfg; false if the key, type or range is wrong
+static bool parse_member(const cJSON *item, app_config_t *cfg,
+                         char *err, size_t err_len)
+{
+    const field_t *f = find_field(item->string);
+    if (!f) {
+        set_err(err, err_len, "unknown field %s", item->string);
+        return false;
+    }
+
+    if (f->type == F_STR) {
+        size_t len = cJSON_IsString(item) ? strlen(item->valuestring) : SIZE_MAX;
+        if (len < f->min || len > f->max) {
+            set_err(err, err_len, "bad value for %s", f->key);
+            return false;
+        }
+        memcpy(field_ptr(cfg, *f), item->valuestring, len + 1);
+        return true;
+    }
+
+    double v = cJSON_IsNumber(item) ? item->valuedouble : -1;
+    if (v < f->min || v > f->max || v != floor(v)) {
+        set_err(err, err_len, "bad value for %s", f->key);
+        return false;
+    }
+    set_uint(cfg, *f, (uint32_t)v);
+    return true;
+}
+
+esp_err_t app_config_update_json(const char *json, size_t len,
+                                 char *err, size_t err_len, bool *reboot)
+{
+    if (reboot)
+        *reboot = false;
+
+    app_config_t old, next;
+    app_config_get(&old);
+    next = old;
+
+    cJSON *root = cJSON_ParseWithLength(json, len);
+    if (!cJSON_IsObject(root)) {
+        cJSON_Delete(root);
+        set_err(err, err_len, "%s", "expected a JSON object");
+        stats.rejected++;
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bool ok = true;
+    bool stale = false;
+    const cJSON *item;
+    cJSON_ArrayForEach(item, root) {
+        if (strcmp(item->string, "version") == 0) {
+            stale = !cJSON_IsNumber(item) || item->valuedouble != (double)old.version;
+            continue;
+        }
+        if (!parse_member(item, &next, err, err_len)) {
+            ok = false;
+            break;
+        }
+    }
+    cJSON_Delete(root);
+
+    if (ok && stale) {
+        set_err(err, err_len, "%s", "version mismatch");
+        stats.rejected++;
+        return ESP_ERR_INVALID_VERSION;
+    }
+    const char *why = ok ? check_consistency(&next) : NULL;
+    if (!ok || why) {
+        if (why)
+            set_err(err, err_len, "%s", why);
+        stats.rejected++;
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bool changed = false;
+    for (const field_t &f : fields) {
+        if (field_equal(&old, &next, f))
+            continue;
+        changed = true;
+        if (!f.live && reboot)
+            *reboot = true;
+    }
+    if (!changed)
+        return ESP_OK;
+
+    next.version = old.version + 1;
+    esp_err_t e = store(&old, &next);
+    if (e != ESP_OK) {
+        stats.nvs_errors++;
+        set_err(err, err_len, "NVS: %s", esp_err_to_name(e));
+        return e;
+    }
+
+    publish(&next);
+    stats.updates++;
+    ESP_LOGI(TAG, "Config version %u stored", (unsigned)next.version);
+
+    for (size_t i = 0; i < listener_count; i++)
+        listeners[i](&next);
+    return ESP_OK;
+}
+
+// snprintf at offset *n that keeps counting once buf is full
+static void append(char *buf, size_t len, int *n, const char *fmt, ...)
+{
+    size_t at = (size_t)*n < len ? (size_t)*n : len;
+    va_list ap;
+    va_start(ap, fmt);
+    int r = vsnprintf(buf + at, len - at, fmt, ap);
+    va_end(ap);
+    if (r > 0)
+        *n += r;
+}
+
+int app_config_to_json(const app_config_t *cfg, char *buf, size_t len)
+{
+    int n = 0;
+    append(buf, len, &n, "{\"version\":%u", (unsigned)cfg->version);
+
+    for (const field_t &f : fields) {
+        if (f.secret)
+            continue;
+        if (f.type != F_STR) {
+            append(buf, len, &n, ",\"%s\":%u", f.key, (unsigned)get_uint(cfg, f));
+            continue;
+        }
+
+        // Quotes, backslashes and control characters are escaped
+        append(buf, len, &n, ",\"%s\":\"", f.key);
+        for (const char *c = (const char *)field_ptr(cfg, f); *c; c++) {
+            if (*c == '"' || *c == '\\')
+                append(buf, len, &n, "\\%c", *c);
+            else if ((unsigned char)*c < 0x20)
+                append(buf, len, &n, "\\u%04x", *c);
+            else
+                append(buf, len, &n, "%c", *c);
+        }
+        append(buf, len, &n, "\"");
+    }
+
+    append(buf, len, &n, "}");
+    return n;
+}
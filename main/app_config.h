@@ -0,0 +1,135 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =====================================================
+ *              PERSISTENT CONFIGURATION
+ * =====================================================
+ *
+ * Board and tuning parameters, one typed NVS entry per field in the
+ * "config" namespace. app_config_init() loads them once into RAM;
+ * after that, reads are plain struct copies and never touch flash.
+ *
+ * Updates arrive as JSON on /config. Every accepted update bumps the
+ * version, is written back to NVS and is passed to the subscribers.
+ * Live fields take effect straight away. Boot fields (pins, PWM
+ * frequency, Wi-Fi) are stored, but only take effect after a restart.
+ */
+
+#define APP_CONFIG_NVS_NAMESPACE "config"
+
+/** NVS layout version; stored values from a newer layout are ignored */
+#define APP_CONFIG_SCHEMA 1
+
+/** Largest /config request body and JSON rendering */
+#define APP_CONFIG_JSON_MAX 1024
+
+/** Subscribers notified after each accepted update */
+#define APP_CONFIG_MAX_LISTENERS 4
+
+typedef struct {
+    uint8_t in1;
+    uint8_t in2;
+    uint8_t pwm;
+} app_config_wheel_t;
+
+typedef struct {
+    uint32_t version;               // bumped by every accepted update
+
+    // Motor driver (boot)
+    uint8_t pin_stby;
+    app_config_wheel_t wheel[4];    // LF, LB, RF, RB
+    uint32_t pwm_freq_hz;
+    uint16_t control_rate_hz;
+    uint8_t min_duty_pct;           // duty just above gearmotor stall
+    uint8_t curve_pct;              // 0 = linear, 100 = cubic
+
+    // Motor and failsafe (live)
+    uint16_t accel_ms;
+    uint16_t decel_ms;
+    uint16_t failsafe_timeout_ms;
+    uint16_t failsafe_ramp_ms;
+    uint8_t mixer;                  // drive_mixer_mode_t
+
+    // Soft-AP (boot)
+    char ssid[33];
+    char password[65];              // empty = open network
+    uint8_t max_connection;
+    uint8_t wifi_profile;           // wifi_profile_mode_t
+} app_config_t;
+
+typedef void (*app_config_listener_t)(const app_config_t *cfg);
+
+typedef struct {
+    uint32_t updates;               // accepted updates since boot
+    uint32_t rejected;              // invalid values or stale versions
+    uint32_t nvs_errors;            // failed NVS reads or writes
+} app_config_stats_t;
+
+/**
+ * @brief Load the configuration from NVS over the built-in defaults
+ *
+ * Call once after nvs_flash_init() and before any module that reads the
+ * configuration. Unreadable or out-of-range entries keep their default.
+ */
+void app_config_init(void);
+
+/**
+ * @brief Copy the current configuration
+ */
+void app_config_get(app_config_t *out);
+
+/**
+ * @brief Fill out with the built-in defaults (version 0)
+ */
+void app_config_defaults(app_config_t *out);
+
+/**
+ * @brief Call cb after every accepted update
+ *
+ * Listeners run on the task that applied the update (the HTTP server)
+ * and receive the new configuration.
+ */
+void app_config_subscribe(app_config_listener_t cb);
+
+/**
+ * @brief Apply a JSON object of field values
+ *
+ * Unknown keys and out-of-range values reject the whole update. If the
+ * object has a "version" member, the update applies only when it equals
+ * the current version. This stops two editors from silently overwriting
+ * each other.
+ *
+ * @param json Object such as {"version":3,"accel_ms":250}
+ * @param len Length of json
+ * @param err Receives a short reason on failure (may be NULL)
+ * @param err_len Size of err
+ * @param reboot Set when a boot field changed (may be NULL)
+ * @return ESP_OK, ESP_ERR_INVALID_ARG (bad JSON or value),
+ *         ESP_ERR_INVALID_VERSION (stale version) or an NVS error
+ */
+esp_err_t app_config_update_json(const char *json, size_t len,
+                                 char *err, size_t err_len, bool *reboot);
+
+/**
+ * @brief Format cfg as a JSON object, including its version
+ * @return Length written (snprintf semantics)
+ */
+int app_config_to_json(const app_config_t *cfg, char *buf, size_t len);
+
+/**
+ * @brief Snapshot update counters
+ */
+void app_config_get_stats(app_config_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
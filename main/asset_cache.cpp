@@ -0,0 +1,291 @@
+#include "asset_cache.h"
+
+#include <atomic>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "asset_cache";
+
+#define MOUNT_TASK_STACK 4096
+#define MOUNT_TASK_PRIO (tskIDLE_PRIORITY + 1)
+
+/* =====================================================
+ *              CACHE STATE
+ * ===================================================== */
+
+typedef struct {
+    char path[ASSET_PATH_MAX];
+    char etag[24];
+    uint8_t *data;      // NULL for a remembered miss
+    size_t size;
+    uint32_t last_used;
+    bool used;
+    bool found;
+} entry_t;
+
+typedef struct {
+    char path[ASSET_PATH_MAX];
+    char etag[24];
+    const uint8_t *data;
+    size_t size;
+} static_entry_t;
+
+static entry_t entries[ASSET_CACHE_MAX_ENTRIES];
+static static_entry_t static_entries[ASSET_CACHE_MAX_STATIC];
+static size_t static_count = 0;
+typedef enum { FS_READY, FS_PENDING, FS_FAILED } fs_state_t;
+
+static asset_mount_fn_t mount_fn = NULL;
+static std::atomic<int> fs_state{FS_READY};     // fs_state_t
+static uint32_t mount_us = 0;                   // written before fs_state leaves FS_PENDING
+static char root_dir[64] = "";
+static size_t budget = ASSET_CACHE_MAX_BYTES;
+static size_t bytes_used = 0;
+static uint32_t clock_tick = 0;
+static asset_cache_stats_t stats;
+
+/* =====================================================
+ *              HELPERS
+ * ===================================================== */
+
+static void entry_release(entry_t *e)
+{
+    if (e->data) {
+        bytes_used -= e->size;
+        free(e->data);
+    }
+    memset(e, 0, sizeof(*e));
+}
+
+static entry_t *find(const char *path)
+{
+    for (auto &e : entries) {
+        if (e.used && !strcmp(e.path, path))
+            return &e;
+    }
+    return NULL;
+}
+
+static entry_t *lru_victim(void)
+{
+    entry_t *victim = NULL;
+    for (auto &e : entries) {
+        if (!e.used)
+            return &e;
+        if (!victim || e.last_used < victim->last_used)
+            victim = &e;
+    }
+    return victim;
+}
+
+static bool evict_for(size_t size)
+{
+    while (bytes_used + size > budget) {
+        entry_t *victim = NULL;
+        for (auto &e : entries) {
+            if (e.used && e.data && (!victim || e.last_used < victim->last_used))
+                victim = &e;
+        }
+        if (!victim)
+            return false;
+        entry_release(victim);
+        stats.evictions++;
+    }
+    return true;
+}
+
+static void make_etag(const uint8_t *data, size_t size, char *etag, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ data[i]) * 16777619u;
+    snprintf(etag, len, "\"%08x-%x\"", (unsigned)hash, (unsigned)size);
+}
+
+static void mount_task_fn(void *arg)
+{
+    int64_t t0 = esp_timer_get_time();
+    bool ok = mount_fn();
+    mount_us = (uint32_t)(esp_timer_get_time() - t0);
+    fs_state.store(ok ? FS_READY : FS_FAILED, std::memory_order_release);
+
+    ESP_LOGI(TAG, "Filesystem %s in the background (%u ms)",
+             ok ? "mounted" : "mount failed", (unsigned)(mount_us / 1000));
+    vTaskDelete(NULL);
+}
+
+static asset_result_t load(const char *full, entry_t *e)
+{
+    struct stat st;
+    if (stat(full, &st) != 0)
+        return ASSET_NOT_FOUND;
+
+    size_t size = (size_t)st.st_size;
+    if (size > budget)
+        return ASSET_TOO_LARGE;
+
+    FILE *f = fopen(full, "r");
+    if (!f)
+        return ASSET_NOT_FOUND;
+
+    if (!evict_for(size)) {
+        fclose(f);
+        return ASSET_TOO_LARGE;
+    }
+
+    uint8_t *data = (uint8_t *)malloc(size ? size : 1);
+    if (!data) {
+        fclose(f);
+        return ASSET_TOO_LARGE;
+    }
+
+    size_t r = fread(data, 1, size, f);
+    fclose(f);
+    if (r != size) {
+        free(data);
+        return ASSET_NOT_FOUND;
+    }
+
+    e->data = data;
+    e->size = size;
+    e->found = true;
+    bytes_used += size;
+    make_etag(data, size, e->etag, sizeof(e->etag));
+    return ASSET_OK;
+}
+
+/* =====================================================
+ *              CACHE API
+ * ===================================================== */
+
+void asset_cache_init(const char *root, size_t max_bytes)
+{
+    for (auto &e : entries)
+        entry_release(&e);
+
+    memset(static_entries, 0, sizeof(static_entries));
+    static_count = 0;
+
+    snprintf(root_dir, sizeof(root_dir), "%s", root);
+    budget = max_bytes ? max_bytes : ASSET_CACHE_MAX_BYTES;
+    memset(&stats, 0, sizeof(stats));
+
+    ESP_LOGI(TAG, "Asset cache on %s, %u bytes", root_dir, (unsigned)budget);
+}
+
+void asset_cache_mount_async(asset_mount_fn_t mount)
+{
+    mount_fn = mount;
+    fs_state.store(FS_PENDING, std::memory_order_relaxed);
+    xTaskCreate(mount_task_fn, "fs_mount", MOUNT_TASK_STACK, NULL, MOUNT_TASK_PRIO, NULL);
+}
+
+bool asset_cache_add_static(const char *path, const uint8_t *data, size_t size)
+{
+    if (static_count >= ASSET_CACHE_MAX_STATIC ||
+        strlen(path) >= sizeof(static_entries[0].path))
+        return false;
+
+    static_entry_t *s = &static_entries[static_count++];
+    snprintf(s->path, sizeof(s->path), "%s", path);
+    s->data = data;
+    s->size = size;
+    make_etag(data, size, s->etag, sizeof(s->etag));
+
+    ESP_LOGI(TAG, "%s: %u bytes in the firmware image", path, (unsigned)size);
+    return true;
+}
+
+asset_result_t asset_cache_get_static(const char *path, asset_t *out)
+{
+    for (size_t i = 0; i < static_count; i++) {
+        const static_entry_t *s = &static_entries[i];
+        if (!strcmp(s->path, path)) {
+            stats.static_hits++;
+            out->data = s->data;
+            out->size = s->size;
+            out->etag = s->etag;
+            return ASSET_OK;
+        }
+    }
+    return ASSET_NOT_FOUND;
+}
+
+asset_result_t asset_cache_get(const char *path, asset_t *out)
+{
+    if (asset_cache_get_static(path, out) == ASSET_OK)
+        return ASSET_OK;
+
+    entry_t *e = find(path);
+    if (e) {
+        stats.hits++;
+        e->last_used = ++clock_tick;
+        if (!e->found)
+            return ASSET_NOT_FOUND;
+        out->data = e->data;
+        out->size = e->size;
+        out->etag = e->etag;
+        return ASSET_OK;
+    }
+
+    // Unmounted: a miss, but not remembered, so the file is found once
+    // the mount is done
+    if (fs_state.load(std::memory_order_acquire) != FS_READY) {
+        stats.fs_deferred++;
+        return ASSET_NOT_FOUND;
+    }
+
+    stats.misses++;
+
+    char full[128];
+    if (snprintf(full, sizeof(full), "%s%s", root_dir, path) >= (int)sizeof(full))
+        return ASSET_NOT_FOUND;
+
+    // No entry can hold the path: let the caller stream the file, and
+    // do not remember a miss under a truncated name either
+    if (strlen(path) >= sizeof(entries[0].path)) {
+        struct stat st;
+        return stat(full, &st) == 0 ? ASSET_UNCACHED : ASSET_NOT_FOUND;
+    }
+
+    e = lru_victim();
+    if (e->used) {
+        entry_release(e);
+        stats.evictions++;
+    }
+
+    asset_result_t res = load(full, e);
+    if (res == ASSET_TOO_LARGE)
+        return res;
+
+    // Cache hits and misses alike; the filesystem is read-only at runtime
+    snprintf(e->path, sizeof(e->path), "%s", path);
+    e->used = true;
+    e->last_used = ++clock_tick;
+
+    if (res == ASSET_OK) {
+        out->data = e->data;
+        out->size = e->size;
+        out->etag = e->etag;
+    }
+    return res;
+}
+
+void asset_cache_get_stats(asset_cache_stats_t *out)
+{
+    *out = stats;
+    out->bytes = bytes_used;
+    out->fs_mounted = fs_state.load(std::memory_order_acquire) == FS_READY;
+    out->mount_us = mount_us;
+    out->entries = 0;
+    for (const auto &e : entries)
+        out->entries += e.used;
+}
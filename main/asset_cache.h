@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Default RAM budget for cached file contents */
+#define ASSET_CACHE_MAX_BYTES (96 * 1024)
+
+/** Maximum number of cached paths (including remembered misses) */
+#define ASSET_CACHE_MAX_ENTRIES 16
+
+/** Maximum number of assets added with asset_cache_add_static() */
+#define ASSET_CACHE_MAX_STATIC 4
+
+/** Longest asset path below the root, including the terminating NUL */
+#define ASSET_PATH_MAX 64
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    const char *etag;   // strong ETag, quoted
+} asset_t;
+
+typedef enum {
+    ASSET_OK = 0,
+    ASSET_NOT_FOUND,
+    ASSET_TOO_LARGE,    // exists but exceeds the cache budget
+    ASSET_UNCACHED,     // exists but its path does not fit an entry
+} asset_result_t;
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t entries;
+    size_t bytes;
+    uint32_t static_hits;   // served from asset_cache_add_static() memory
+    bool fs_mounted;        // filesystem usable (always true without a mount hook)
+    uint32_t mount_us;      // time spent in the background mount, 0 if none ran
+    uint32_t fs_deferred;   // lookups refused while unmounted
+} asset_cache_stats_t;
+
+/** Mounts the asset filesystem; returns false on failure */
+typedef bool (*asset_mount_fn_t)(void);
+
+/**
+ * @brief Initialize the asset cache
+ * @param root Filesystem directory assets are read from (e.g. "/littlefs")
+ * @param max_bytes RAM budget for file contents (0 = ASSET_CACHE_MAX_BYTES)
+ */
+void asset_cache_init(const char *root, size_t max_bytes);
+
+/**
+ * @brief Mount the filesystem on a low-priority background task
+ *
+ * Without a call the filesystem is assumed to be mounted already. The
+ * hook runs once, never on the task calling asset_cache_get(): until it
+ * has succeeded, lookups that would read the filesystem return
+ * ASSET_NOT_FOUND without remembering the miss. If it fails, they always
+ * do. Kept across asset_cache_init().
+ */
+void asset_cache_mount_async(asset_mount_fn_t mount);
+
+/**
+ * @brief Serve path straight from memory that stays valid for the whole run
+ *
+ * Meant for files linked into the firmware image: the data is used in
+ * place (flash-mapped, no RAM copy), is not counted against the budget,
+ * is never evicted and is found without touching the filesystem.
+ * Registrations are cleared by asset_cache_init().
+ *
+ * @return false if the path is too long or the table is full
+ */
+bool asset_cache_add_static(const char *path, const uint8_t *data, size_t size);
+
+/**
+ * @brief Look up only assets added with asset_cache_add_static()
+ */
+asset_result_t asset_cache_get_static(const char *path, asset_t *out);
+
+/**
+ * @brief Look up an asset, loading it from the filesystem on a miss
+ *
+ * Least recently used entries are evicted to stay within the budget.
+ * Missing files are remembered too, so probing for optional variants
+ * (".br", ".gz") does not hit the filesystem every time. The returned
+ * memory stays valid until the next call; the cache is meant to be used
+ * from the single httpd task. ASSET_TOO_LARGE and ASSET_UNCACHED leave
+ * out unset: stream such a file from the filesystem instead.
+ *
+ * @param path Path below the root, starting with '/'
+ * @param out Asset contents on ASSET_OK
+ */
+asset_result_t asset_cache_get(const char *path, asset_t *out);
+
+/**
+ * @brief Snapshot hit/miss counters and memory usage
+ */
+void asset_cache_get_stats(asset_cache_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
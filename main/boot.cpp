@@ -0,0 +1,138 @@
+#include "boot.h"
+#include "event_log.h"
+
+#include <atomic>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+
+static const char *TAG = "boot";
+
+// Above the stages' own helper tasks, below the motor control loop
+#define BOOT_STAGE_PRIO 5
+
+static const boot_stage_t *table = NULL;
+static size_t table_len = 0;
+static boot_stage_time_t times[BOOT_MAX_STAGES];
+
+// Stage tasks wait on done_bits for their dependencies; the boot task
+// waits for one notification per stage instead, so it only deletes the
+// group once no stage task can still be inside xEventGroupSetBits()
+static EventGroupHandle_t done_bits = NULL;
+static TaskHandle_t boot_task = NULL;
+static std::atomic<uint32_t> ready_us{0};
+static std::atomic<uint32_t> first_command_us{0};
+
+/* =====================================================
+ *              STAGES
+ * ===================================================== */
+
+static void run_stage(size_t i)
+{
+    times[i].name = table[i].name;
+    times[i].start_us = (uint32_t)esp_timer_get_time();
+    table[i].run();
+    times[i].end_us = (uint32_t)esp_timer_get_time();
+
+    ESP_LOGI(TAG, "%s: %u ms (started at %u ms)", table[i].name,
+             (unsigned)((times[i].end_us - times[i].start_us) / 1000),
+             (unsigned)(times[i].start_us / 1000));
+}
+
+static void stage_task_fn(void *arg)
+{
+    size_t i = (size_t)arg;
+
+    if (table[i].deps)
+        xEventGroupWaitBits(done_bits, table[i].deps, pdFALSE, pdTRUE, portMAX_DELAY);
+    run_stage(i);
+    xEventGroupSetBits(done_bits, BOOT_DEP(i));
+
+    // Last touch of shared state: the boot task may free done_bits now
+    xTaskNotifyGive(boot_task);
+    vTaskDelete(NULL);
+}
+
+/* =====================================================
+ *              BOOT API
+ * ===================================================== */
+
+/*
+ * A dependency on the stage itself or a later one could deadlock the
+ * parallel boot, and would run a stage early in sequential mode. The
+ * table is fixed at build time, so a bad one is a bug: refuse to boot.
+ */
+static esp_err_t check_table(const boot_stage_t *stages, size_t n)
+{
+    if (n > BOOT_MAX_STAGES) {
+        ESP_LOGE(TAG, "%u stages, at most %u supported", (unsigned)n, BOOT_MAX_STAGES);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (stages[i].deps & ~(BOOT_DEP(i) - 1)) {
+            ESP_LOGE(TAG, "%s depends on itself or a later stage", stages[i].name);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
+}
+
+void boot_run(const boot_stage_t *stages, size_t n)
+{
+    ESP_ERROR_CHECK(check_table(stages, n));
+
+    table = stages;
+    table_len = n;
+
+    if (BOOT_PARALLEL) {
+        done_bits = xEventGroupCreate();
+        boot_task = xTaskGetCurrentTaskHandle();
+        for (size_t i = 0; i < n; i++)
+            xTaskCreate(stage_task_fn, stages[i].name, BOOT_STAGE_STACK,
+                        (void *)i, BOOT_STAGE_PRIO, NULL);
+        for (size_t i = 0; i < n; i++)
+            ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+        vEventGroupDelete(done_bits);
+        done_bits = NULL;
+    } else {
+        for (size_t i = 0; i < n; i++)
+            run_stage(i);
+    }
+
+    ready_us.store((uint32_t)esp_timer_get_time(), std::memory_order_relaxed);
+    ESP_LOGI(TAG, "Ready at %u ms", (unsigned)(ready_us.load() / 1000));
+}
+
+bool boot_get_stage_time(size_t i, boot_stage_time_t *out)
+{
+    if (i >= table_len)
+        return false;
+    *out = times[i];
+    return true;
+}
+
+uint32_t boot_ready_us(void)
+{
+    return ready_us.load(std::memory_order_relaxed);
+}
+
+void boot_note_command(void)
+{
+    if (first_command_us.load(std::memory_order_relaxed))
+        return;
+
+    uint32_t expected = 0;
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    if (first_command_us.compare_exchange_strong(expected, now ? now : 1,
+                                                 std::memory_order_relaxed))
+        EVLOG_I(EVT_BOOT_FIRST_COMMAND, now / 1000);
+}
+
+uint32_t boot_first_command_us(void)
+{
+    return first_command_us.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =====================================================
+ *              BOOT ORCHESTRATOR
+ * =====================================================
+ *
+ * Startup is a small graph of stages. Each stage runs on its own
+ * short-lived task as soon as the stages it depends on have finished,
+ * so independent work overlaps. For example, the Wi-Fi bring-up (and
+ * the low-latency profile's channel scan) overlaps the LittleFS mount
+ * and motor setup. Start and end times are recorded for every stage,
+ * and the time from power-up to the first accepted drive command is
+ * recorded too.
+ */
+
+/** 0 runs the stages one after another on the calling task, in table order */
+#ifndef BOOT_PARALLEL
+#define BOOT_PARALLEL 1
+#endif
+
+#define BOOT_MAX_STAGES 8
+#define BOOT_STAGE_STACK 4096
+
+/** Dependency mask bit for the stage at index i of the table */
+#define BOOT_DEP(i) (1u << (i))
+
+typedef struct {
+    const char *name;
+    void (*run)(void);
+    uint32_t deps;              // BOOT_DEP() of stages that must finish first
+} boot_stage_t;
+
+typedef struct {
+    const char *name;
+    uint32_t start_us;          // esp_timer time the stage started
+    uint32_t end_us;            // esp_timer time the stage finished
+} boot_stage_time_t;
+
+/**
+ * @brief Run every stage and return once all have finished
+ *
+ * A stage may only depend on stages earlier in the table, which keeps
+ * the graph acyclic and gives the sequential (BOOT_PARALLEL 0) order.
+ * A table that breaks this rule, or has more than BOOT_MAX_STAGES
+ * entries, aborts through ESP_ERROR_CHECK().
+ *
+ * @param stages Stage table (kept, must stay valid)
+ * @param n Number of stages, at most BOOT_MAX_STAGES
+ */
+void boot_run(const boot_stage_t *stages, size_t n);
+
+/**
+ * @brief Timestamps of stage i
+ * @return false if i is out of range or boot_run() has not been called
+ */
+bool boot_get_stage_time(size_t i, boot_stage_time_t *out);
+
+/**
+ * @brief esp_timer time boot_run() returned, 0 while still booting
+ */
+uint32_t boot_ready_us(void);
+
+/**
+ * @brief Record an accepted drive command; only the first one counts
+ *
+ * Cheap enough for the command path: after the first call it is one
+ * relaxed atomic load.
+ */
+void boot_note_command(void);
+
+/**
+ * @brief esp_timer time of the first accepted command, 0 if none yet
+ */
+uint32_t boot_first_command_us(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,367 @@
+#include "control_protocol.h"
+#include "motor_control.h"
+#include "failsafe.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* =====================================================
+ *              LITTLE-ENDIAN HELPERS
+ * ===================================================== */
+
+static inline uint16_t rd_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline void wr_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v & 0xff);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline uint32_t rd_u32(const uint8_t *p)
+{
+    return rd_u16(p) | ((uint32_t)rd_u16(p + 2) << 16);
+}
+
+static inline void wr_u32(uint8_t *p, uint32_t v)
+{
+    wr_u16(p, (uint16_t)v);
+    wr_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+/* =====================================================
+ *              FRAME CODEC
+ * ===================================================== */
+
+static inline int16_t v1_to_q15(int16_t v)
+{
+    if (v > 10) v = 10;
+    if (v < -10) v = -10;
+    return (int16_t)((v * 32767) / 10);
+}
+
+bool ctrl_decode_binary(const uint8_t *buf, size_t len, ctrl_frame_t *out)
+{
+    if (len != CTRL_FRAME_SIZE && len != CTRL_WHEELS_FRAME_SIZE)
+        return false;
+    if (buf[0] != CTRL_PROTO_VERSION && buf[0] != CTRL_PROTO_VERSION_V1)
+        return false;
+
+    // The flag and the length must agree, and version 1 has no wheels
+    bool wheels = buf[1] & CTRL_FLAG_WHEELS;
+    if (wheels != (len == CTRL_WHEELS_FRAME_SIZE) ||
+        (wheels && buf[0] != CTRL_PROTO_VERSION))
+        return false;
+
+    out->version = buf[0];
+    out->flags = buf[1];
+    if (wheels) {
+        out->speed = 0;
+        out->steer = 0;
+        for (int i = 0; i < 4; i++)
+            out->wheels[i] = (int16_t)rd_u16(buf + 2 + 2 * i);
+        out->seq = rd_u16(buf + 10);
+        return true;
+    }
+
+    out->speed = (int16_t)rd_u16(buf + 2);
+    out->steer = (int16_t)rd_u16(buf + 4);
+    out->seq = rd_u16(buf + 6);
+    memset(out->wheels, 0, sizeof(out->wheels));
+
+    if (out->version == CTRL_PROTO_VERSION_V1) {
+        out->speed = v1_to_q15(out->speed);
+        out->steer = v1_to_q15(out->steer);
+    }
+    return true;
+}
+
+size_t ctrl_encode_binary(const ctrl_frame_t *in, uint8_t *buf)
+{
+    buf[0] = in->version;
+    buf[1] = in->flags;
+    if (in->flags & CTRL_FLAG_WHEELS) {
+        for (int i = 0; i < 4; i++)
+            wr_u16(buf + 2 + 2 * i, (uint16_t)in->wheels[i]);
+        wr_u16(buf + 10, in->seq);
+        return CTRL_WHEELS_FRAME_SIZE;
+    }
+    wr_u16(buf + 2, (uint16_t)in->speed);
+    wr_u16(buf + 4, (uint16_t)in->steer);
+    wr_u16(buf + 6, in->seq);
+    return CTRL_FRAME_SIZE;
+}
+
+bool ctrl_dispatch_frame(const ctrl_frame_t *cf, drive_seq_t *src)
+{
+    failsafe_feed();
+
+    if (cf->flags & CTRL_FLAG_HEARTBEAT)
+        return false;
+
+    if (cf->flags & CTRL_FLAG_STOP) {
+        stop_motors();
+        return true;
+    }
+
+    if (cf->flags & CTRL_FLAG_WHEELS)
+        return set_wheels_q15(cf->wheels[0], cf->wheels[1], cf->wheels[2],
+                              cf->wheels[3], cf->seq, src);
+
+    return set_drive_q15(cf->speed, cf->steer, cf->seq, src);
+}
+
+/* =====================================================
+ *              TELEMETRY CODEC
+ * ===================================================== */
+
+void ctrl_encode_telemetry(const ctrl_telemetry_t *in, uint8_t *buf)
+{
+    buf[0] = CTRL_TELEM_KIND;
+    buf[1] = CTRL_TELEM_VERSION;
+    wr_u16(buf + 2, in->seq);
+    wr_u32(buf + 4, in->t_ms);
+    for (int i = 0; i < 4; i++)
+        wr_u16(buf + 8 + 2 * i, (uint16_t)in->duty[i]);
+    wr_u16(buf + 16, in->lat_us);
+    wr_u16(buf + 18, in->lat_p99_us);
+    wr_u32(buf + 20, in->heap_free);
+    buf[24] = (uint8_t)in->rssi;
+    buf[25] = in->flags;
+    wr_u16(buf + 26, in->loop_max_us);
+    wr_u16(buf + 28, in->work_max_us);
+}
+
+bool ctrl_decode_telemetry(const uint8_t *buf, size_t len, ctrl_telemetry_t *out)
+{
+    if (len != CTRL_TELEM_SIZE || buf[0] != CTRL_TELEM_KIND ||
+        buf[1] != CTRL_TELEM_VERSION)
+        return false;
+
+    out->seq = rd_u16(buf + 2);
+    out->t_ms = rd_u32(buf + 4);
+    for (int i = 0; i < 4; i++)
+        out->duty[i] = (int16_t)rd_u16(buf + 8 + 2 * i);
+    out->lat_us = rd_u16(buf + 16);
+    out->lat_p99_us = rd_u16(buf + 18);
+    out->heap_free = rd_u32(buf + 20);
+    out->rssi = (int8_t)buf[24];
+    out->flags = buf[25];
+    out->loop_max_us = rd_u16(buf + 26);
+    out->work_max_us = rd_u16(buf + 28);
+    return true;
+}
+
+/* =====================================================
+ *              JSON COMMAND PARSER
+ * =====================================================
+ *
+ * The key and command sets are fixed, so both are matched by length
+ * first and a single memcmp; values are scanned in place and only
+ * numbers are copied (to a small stack buffer for strtod).
+ */
+
+enum ctrl_key_t : uint8_t {
+    KEY_NONE = 0,
+    KEY_CMD,
+    KEY_VALUE,
+    KEY_ANGLE,
+    KEY_SPEED,
+    KEY_STEER,
+    KEY_SEQ,
+    KEY_DIR,
+    KEY_PROTO,
+};
+
+static inline bool eq(const char *s, size_t n, const char *lit, size_t lit_len)
+{
+    return n == lit_len && !memcmp(s, lit, lit_len);
+}
+
+#define EQ(s, n, lit) eq(s, n, lit, sizeof(lit) - 1)
+
+static ctrl_key_t key_lookup(const char *k, size_t n)
+{
+    switch (n) {
+    case 3:
+        if (EQ(k, n, "cmd")) return KEY_CMD;
+        if (EQ(k, n, "seq")) return KEY_SEQ;
+        if (EQ(k, n, "dir")) return KEY_DIR;
+        break;
+    case 5:
+        if (EQ(k, n, "speed")) return KEY_SPEED;
+        if (EQ(k, n, "steer")) return KEY_STEER;
+        if (EQ(k, n, "value")) return KEY_VALUE;
+        if (EQ(k, n, "angle")) return KEY_ANGLE;
+        if (EQ(k, n, "proto")) return KEY_PROTO;
+        break;
+    }
+    return KEY_NONE;
+}
+
+ctrl_cmd_id_t ctrl_cmd_lookup(const char *name, size_t n)
+{
+    switch (n) {
+    case 3:
+        if (EQ(name, n, "set")) return CTRL_CMD_SET;
+        break;
+    case 4:
+        if (EQ(name, n, "ping")) return CTRL_CMD_PING;
+        if (EQ(name, n, "move")) return CTRL_CMD_MOVE;
+        break;
+    case 5:
+        if (EQ(name, n, "drive")) return CTRL_CMD_DRIVE;
+        if (EQ(name, n, "steer")) return CTRL_CMD_STEER;
+        if (EQ(name, n, "hello")) return CTRL_CMD_HELLO;
+        break;
+    case 7:
+        if (EQ(name, n, "metrics")) return CTRL_CMD_METRICS;
+        break;
+    }
+    return CTRL_CMD_UNKNOWN;
+}
+
+static inline const char *skip_ws(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        p++;
+    return p;
+}
+
+// Plain string without escapes; [*s, *s + *n) excludes the quotes
+static const char *scan_string(const char *p, const char *end,
+                               const char **s, size_t *n)
+{
+    if (p >= end || *p != '"')
+        return NULL;
+    const char *start = ++p;
+    while (p < end && *p != '"') {
+        if (*p == '\\' || (uint8_t)*p < 0x20)
+            return NULL;
+        p++;
+    }
+    if (p >= end)
+        return NULL;
+    *s = start;
+    *n = (size_t)(p - start);
+    return p + 1;
+}
+
+// Same character set cJSON hands to strtod
+static const char *scan_number(const char *p, const char *end, double *out)
+{
+    // Like cJSON, a number must start with '-' or a digit
+    if (p >= end || !(*p == '-' || (*p >= '0' && *p <= '9')))
+        return NULL;
+
+    char tmp[32];
+    size_t n = 0;
+    while (p + n < end && n < sizeof(tmp) - 1 &&
+           ((p[n] >= '0' && p[n] <= '9') || p[n] == '+' || p[n] == '-' ||
+            p[n] == '.' || p[n] == 'e' || p[n] == 'E'))
+        n++;
+    if (n == 0 || n == sizeof(tmp) - 1)
+        return NULL;
+
+    memcpy(tmp, p, n);
+    tmp[n] = 0;
+    char *stop;
+    *out = strtod(tmp, &stop);
+    if (stop != tmp + n)
+        return NULL;
+    return p + n;
+}
+
+static uint32_t number_slot(ctrl_command_t *c, ctrl_key_t key, double **dst)
+{
+    switch (key) {
+    case KEY_VALUE: *dst = &c->value; return CTRL_FIELD_VALUE;
+    case KEY_ANGLE: *dst = &c->angle; return CTRL_FIELD_ANGLE;
+    case KEY_SPEED: *dst = &c->speed; return CTRL_FIELD_SPEED;
+    case KEY_STEER: *dst = &c->steer; return CTRL_FIELD_STEER;
+    default: *dst = &c->seq; return CTRL_FIELD_SEQ;
+    }
+}
+
+bool ctrl_parse_json(const char *buf, size_t len, ctrl_command_t *out)
+{
+    const char *p = buf;
+    const char *end = buf + len;
+    uint32_t seen = 0;
+
+    memset(out, 0, sizeof(*out));
+
+    p = skip_ws(p, end);
+    if (p >= end || *p++ != '{')
+        return false;
+
+    p = skip_ws(p, end);
+    if (p < end && *p == '}') {
+        p++;
+    } else {
+        for (;;) {
+            const char *k, *s;
+            size_t kn, sn;
+
+            p = scan_string(skip_ws(p, end), end, &k, &kn);
+            if (!p)
+                return false;
+            p = skip_ws(p, end);
+            if (p >= end || *p++ != ':')
+                return false;
+            p = skip_ws(p, end);
+            if (p >= end)
+                return false;
+
+            ctrl_key_t key = key_lookup(k, kn);
+            if (key == KEY_NONE || (seen & (1u << key)))
+                return false;
+            seen |= 1u << key;
+
+            bool is_str = *p == '"';
+            switch (key) {
+            case KEY_CMD:
+            case KEY_DIR:
+            case KEY_PROTO:
+                if (!is_str || !(p = scan_string(p, end, &s, &sn)))
+                    return false;
+                if (key == KEY_CMD) {
+                    out->cmd = ctrl_cmd_lookup(s, sn);
+                } else {
+                    if (sn >= CTRL_STR_MAX)
+                        return false;
+                    char *dst = key == KEY_DIR ? out->dir : out->proto;
+                    memcpy(dst, s, sn);
+                    dst[sn] = 0;
+                    out->fields |= key == KEY_DIR ? CTRL_FIELD_DIR : CTRL_FIELD_PROTO;
+                }
+                break;
+
+            default: {
+                double *dst;
+                uint32_t field = number_slot(out, key, &dst);
+                if (is_str || !(p = scan_number(p, end, dst)))
+                    return false;
+                out->fields |= field;
+                break;
+            }
+            }
+
+            p = skip_ws(p, end);
+            if (p >= end)
+                return false;
+            if (*p == '}') {
+                p++;
+                break;
+            }
+            if (*p++ != ',')
+                return false;
+        }
+    }
+
+    // Trailing bytes (other than whitespace or a NUL) go to the fallback
+    p = skip_ws(p, end);
+    return p == end || (*p == 0 && p + 1 == end);
+}
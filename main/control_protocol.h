@@ -0,0 +1,223 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "motor_control.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =====================================================
+ *          BINARY CONTROL FRAME (WS BINARY)
+ * =====================================================
+ *
+ * Fixed 8-byte little-endian record:
+ *
+ *   [0]    version   CTRL_PROTO_VERSION
+ *   [1]    flags     CTRL_FLAG_*
+ *   [2..3] speed     int16, Q15 (-32767 .. +32767)
+ *   [4..5] steer     int16, Q15, negative = left
+ *   [6..7] seq       uint16, wraps
+ *
+ * Version 1 frames carried -10 .. +10 integers; they are still
+ * accepted and rescaled to Q15 by the decoder.
+ *
+ * With CTRL_FLAG_WHEELS set (version 2 only) the frame drives each
+ * wheel directly, bypassing the mixer, and is 12 bytes long:
+ *
+ *   [0]     version   CTRL_PROTO_VERSION
+ *   [1]     flags     CTRL_FLAG_WHEELS | CTRL_FLAG_*
+ *   [2..9]  wheels    4 x int16, LF LB RF RB, Q15, negative = reverse
+ *   [10..11] seq      uint16, shared with drive frames
+ *
+ * A connection starts in JSON mode and switches to binary
+ * after {"cmd":"hello","proto":"bin"} is acknowledged.
+ */
+
+#define CTRL_PROTO_VERSION 2
+#define CTRL_PROTO_VERSION_V1 1
+#define CTRL_FRAME_SIZE 8
+#define CTRL_WHEELS_FRAME_SIZE 12
+#define CTRL_FRAME_MAX CTRL_WHEELS_FRAME_SIZE
+
+#define CTRL_FLAG_STOP (1u << 0)
+#define CTRL_FLAG_HEARTBEAT (1u << 1)   // keep-alive only, speed/steer ignored
+#define CTRL_FLAG_WHEELS (1u << 2)      // per-wheel frame, speed/steer unused
+
+typedef struct {
+    uint8_t version;
+    uint8_t flags;
+    int16_t speed;
+    int16_t steer;
+    uint16_t seq;
+    int16_t wheels[4];      // CTRL_FLAG_WHEELS only
+} ctrl_frame_t;
+
+/**
+ * @brief Decode a binary control frame
+ * @param buf Raw WebSocket payload
+ * @param len Payload length in bytes
+ * @param out Decoded frame, speed/steer always in Q15
+ * @return true if the payload is a valid frame of a supported version
+ */
+bool ctrl_decode_binary(const uint8_t *buf, size_t len, ctrl_frame_t *out);
+
+/**
+ * @brief Encode a binary control frame into buf (CTRL_FRAME_MAX bytes)
+ * @return Frame length: CTRL_WHEELS_FRAME_SIZE with CTRL_FLAG_WHEELS,
+ *         CTRL_FRAME_SIZE otherwise
+ */
+size_t ctrl_encode_binary(const ctrl_frame_t *in, uint8_t *buf);
+
+/**
+ * @brief Act on a decoded frame, whichever transport carried it
+ *
+ * Feeds the failsafe, then stops or publishes the setpoint (speed and
+ * steer, or the wheels of a CTRL_FLAG_WHEELS frame). Frames not newer
+ * than the last one accepted from the same source are dropped.
+ *
+ * @param cf Decoded frame
+ * @param src Sequence state of the sender (its session or peer)
+ * @return true if the frame changed the setpoint (for latency tracing)
+ */
+bool ctrl_dispatch_frame(const ctrl_frame_t *cf, drive_seq_t *src);
+
+/* =====================================================
+ *          TELEMETRY FRAME (WS BINARY, SERVER -> CLIENT)
+ * =====================================================
+ *
+ * Fixed 30-byte little-endian record pushed to every WebSocket
+ * client at the telemetry rate:
+ *
+ *   [0]      kind      CTRL_TELEM_KIND
+ *   [1]      version   CTRL_TELEM_VERSION
+ *   [2..3]   seq       uint16, one per telemetry tick, wraps
+ *   [4..7]   t_ms      uint32, uptime
+ *   [8..15]  duty      4 x int16, LF LB RF RB applied duty in Q15 of
+ *                      full scale, negative = reverse
+ *   [16..17] lat_us    uint16, last command receive -> PWM latency
+ *   [18..19] lat_p99   uint16, p99 of the same since boot
+ *   [20..23] heap      uint32, free heap bytes
+ *   [24]     rssi      int8 dBm of the station, 0 if none
+ *   [25]     flags     CTRL_TELEM_FLAG_*
+ *   [26..27] loop_max  uint16, longest control tick period in the window
+ *   [28..29] work_max  uint16, longest control tick run time in the window
+ *
+ * Latencies and loop times are in us and saturate at 65535. Clients
+ * only ever send 8- or 12-byte control frames, so the size alone
+ * tells them apart.
+ */
+
+#define CTRL_TELEM_KIND 0x54    // 'T'
+#define CTRL_TELEM_VERSION 1
+#define CTRL_TELEM_SIZE 30
+
+#define CTRL_TELEM_FLAG_FAILSAFE (1u << 0)  // failsafe tripped, no command since
+
+typedef struct {
+    uint16_t seq;
+    uint32_t t_ms;
+    int16_t duty[4];
+    uint16_t lat_us;
+    uint16_t lat_p99_us;
+    uint32_t heap_free;
+    int8_t rssi;
+    uint8_t flags;
+    uint16_t loop_max_us;
+    uint16_t work_max_us;
+} ctrl_telemetry_t;
+
+/**
+ * @brief Encode a telemetry frame into buf (CTRL_TELEM_SIZE bytes)
+ */
+void ctrl_encode_telemetry(const ctrl_telemetry_t *in, uint8_t *buf);
+
+/**
+ * @brief Decode a telemetry frame
+ * @return true if the payload is a telemetry frame of a supported version
+ */
+bool ctrl_decode_telemetry(const uint8_t *buf, size_t len, ctrl_telemetry_t *out);
+
+/* =====================================================
+ *          JSON CONTROL COMMANDS (WS TEXT)
+ * =====================================================
+ *
+ *   {"cmd":"drive","speed":s,"steer":t,"seq":n}
+ *   {"cmd":"set","value":v}     {"cmd":"steer","angle":a}
+ *   {"cmd":"move","dir":"stop"} {"cmd":"hello","proto":"bin"}
+ *   {"cmd":"ping"}              {"cmd":"metrics"}
+ */
+
+typedef enum {
+    CTRL_CMD_NONE = 0,      // no "cmd" string: not a command
+    CTRL_CMD_UNKNOWN,       // well-formed but unrecognised command
+    CTRL_CMD_PING,
+    CTRL_CMD_SET,
+    CTRL_CMD_STEER,
+    CTRL_CMD_DRIVE,
+    CTRL_CMD_MOVE,
+    CTRL_CMD_METRICS,
+    CTRL_CMD_HELLO,
+} ctrl_cmd_id_t;
+
+#define CTRL_FIELD_VALUE (1u << 0)
+#define CTRL_FIELD_ANGLE (1u << 1)
+#define CTRL_FIELD_SPEED (1u << 2)
+#define CTRL_FIELD_STEER (1u << 3)
+#define CTRL_FIELD_SEQ (1u << 4)
+#define CTRL_FIELD_DIR (1u << 5)
+#define CTRL_FIELD_PROTO (1u << 6)
+
+#define CTRL_STR_MAX 8
+
+typedef struct {
+    ctrl_cmd_id_t cmd;
+    uint32_t fields;        // CTRL_FIELD_* present with the right type
+    double value;
+    double angle;
+    double speed;
+    double steer;
+    double seq;
+    char dir[CTRL_STR_MAX];
+    char proto[CTRL_STR_MAX];
+} ctrl_command_t;
+
+/**
+ * @brief Single-pass, non-allocating parser for JSON control commands
+ *
+ * Only flat objects made of the known keys, with numbers or short plain
+ * strings as values, are accepted. Anything else (unknown or repeated
+ * keys, escapes, nesting, trailing data) returns false and should be
+ * handed to a general JSON parser, which keeps the behaviour identical
+ * for unusual but valid input.
+ *
+ * @param buf Frame payload (need not be NUL terminated)
+ * @param len Payload length in bytes
+ * @param out Parsed command
+ * @return true if the frame was fully understood
+ */
+bool ctrl_parse_json(const char *buf, size_t len, ctrl_command_t *out);
+
+/**
+ * @brief Map a "cmd" string to its command id (CTRL_CMD_UNKNOWN if none)
+ */
+ctrl_cmd_id_t ctrl_cmd_lookup(const char *name, size_t len);
+
+/**
+ * @brief Integer view of a JSON number, saturating like cJSON's valueint
+ */
+static inline int ctrl_number_to_int(double v)
+{
+    if (v >= 2147483647.0)
+        return 2147483647;
+    if (v <= -2147483648.0)
+        return -2147483647 - 1;
+    return (int)v;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,90 @@
+#include "drive_mixer.h"
+#include "drivetrain.h"
+
+#include <stdlib.h>
+
+static inline int clamp_q15(int v)
+{
+    if (v > Q15_ONE) return Q15_ONE;
+    if (v < -Q15_ONE) return -Q15_ONE;
+    return v;
+}
+
+/* =====================================================
+ *              MIXERS
+ * ===================================================== */
+
+static void mix_differential(int speed, int steer, int *left, int *right)
+{
+    int mag = abs(speed);
+    int inner = mag - (int)(((int32_t)abs(steer) * mag) / Q15_ONE);
+
+    *left = *right = mag;
+    if (steer < 0)
+        *left = inner;
+    else if (steer > 0)
+        *right = inner;
+
+    if (speed < 0) {
+        *left = -*left;
+        *right = -*right;
+    }
+}
+
+/*
+ * The chassis' mixer matrix, by wheel slot. It is a compile-time
+ * constant, so the loops below unroll into straight-line adds and
+ * empty slots fold away.
+ */
+static constexpr drivetrain_matrix_t matrix = drivetrain_matrix();
+
+static void mix_tank(int speed, int steer, int out[WHEEL_SLOTS])
+{
+    int peak = 0;
+    for (int s = 0; s < WHEEL_SLOTS; s++) {
+        const int8_t *m = matrix.row[s];
+        // No command carries strafe yet; the column stays for mecanum
+        out[s] = m[MIX_FORWARD] * speed + m[MIX_YAW] * steer;
+        if (abs(out[s]) > peak)
+            peak = abs(out[s]);
+    }
+
+    // Keep the wheel ratios (the turn radius) when a wheel saturates
+    if (peak > Q15_ONE) {
+        for (int s = 0; s < WHEEL_SLOTS; s++)
+            out[s] = (int)((int32_t)out[s] * Q15_ONE / peak);
+    }
+}
+
+/* =====================================================
+ *              MIXER API
+ * ===================================================== */
+
+void drive_mixer_mix(drive_mixer_mode_t mode, int speed, int steer, q15_t out[4])
+{
+    speed = clamp_q15(speed);
+    steer = clamp_q15(steer);
+
+    int v[WHEEL_SLOTS];
+    if (mode == DRIVE_MIXER_TANK) {
+        mix_tank(speed, steer, v);
+    } else {
+        int left, right;
+        mix_differential(speed, steer, &left, &right);
+        for (int s = 0; s < WHEEL_SLOTS; s++)
+            v[s] = matrix.row[s][MIX_FORWARD] == 0 ? 0
+                 : matrix.row[s][MIX_YAW] > 0 ? left : right;
+    }
+
+    for (int s = 0; s < WHEEL_SLOTS; s++)
+        out[s] = (q15_t)v[s];
+}
+
+const char *drive_mixer_name(drive_mixer_mode_t mode)
+{
+    switch (mode) {
+    case DRIVE_MIXER_DIFFERENTIAL: return "differential";
+    case DRIVE_MIXER_TANK: return "tank";
+    default: return "?";
+    }
+}
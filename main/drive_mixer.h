@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "motor_control.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =====================================================
+ *              DRIVE MIXER
+ * =====================================================
+ *
+ * Turns a speed/steer setpoint into one signed command per wheel
+ * (LF, LB, RF, RB), Q15 with negative = reverse. Pure integer math
+ * with no hardware access, so it runs unchanged on the host. Wheels
+ * come from the chassis description in drivetrain.h; slots without a
+ * wheel are always 0.
+ */
+
+typedef enum {
+    DRIVE_MIXER_DIFFERENTIAL = 0,   // inner side slows down, never reverses
+    DRIVE_MIXER_TANK,               // sides run independently: pivots in place
+    DRIVE_MIXER_COUNT
+} drive_mixer_mode_t;
+
+/** Mixer used when the configuration does not select one */
+#define DRIVE_MIXER_DEFAULT_MODE DRIVE_MIXER_DIFFERENTIAL
+
+/**
+ * @brief Mix speed and steer into per-wheel commands
+ *
+ * DRIVE_MIXER_DIFFERENTIAL is the original car-like model: every wheel
+ * turns the way speed points and steering scales the inner side down
+ * to zero at full lock. Nothing moves at zero speed.
+ *
+ * DRIVE_MIXER_TANK is arcade mixing through the chassis' mixer matrix:
+ * on a 2WD or 4WD car left = speed + steer and right = speed - steer,
+ * scaled down together if any wheel exceeds full scale. Steering at
+ * zero speed spins the car in place, and at full lock the inner side
+ * reverses. Positive steer always yaws clockwise (seen from above), in
+ * reverse too.
+ *
+ * @param mode DRIVE_MIXER_*
+ * @param speed Q15, negative = reverse (clamped to full scale)
+ * @param steer Q15, negative = left (clamped to full scale)
+ * @param out LF, LB, RF, RB in Q15
+ */
+void drive_mixer_mix(drive_mixer_mode_t mode, int speed, int steer, q15_t out[4]);
+
+/**
+ * @brief Short name of a mixer mode ("differential", "tank")
+ */
+const char *drive_mixer_name(drive_mixer_mode_t mode);
+
+#ifdef __cplusplus
+}
+#endif
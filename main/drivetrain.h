@@ -0,0 +1,208 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <initializer_list>
+
+/* =====================================================
+ *              DRIVETRAIN DESCRIPTION
+ * =====================================================
+ *
+ * The chassis is described at compile time: which of the four wheel
+ * slots (LF, LB, RF, RB) carry a motor, each motor's default TB6612
+ * pins and LEDC channel, whether it is mounted mirrored, and its row
+ * of the mixer matrix. DRIVETRAIN selects one description; the motor
+ * driver and the mixer loop over it as constants, so a chassis only
+ * pays for the wheels it has. Every description is checked with
+ * static_assert below, including the ones not selected.
+ *
+ * Pins can still be changed through /config; the description only
+ * supplies their defaults. C++ only.
+ */
+
+#define DRIVETRAIN_2WD 0
+#define DRIVETRAIN_4WD 1
+#define DRIVETRAIN_MECANUM 2
+
+#ifndef DRIVETRAIN
+#define DRIVETRAIN DRIVETRAIN_4WD
+#endif
+
+/** Wheel slots of every per-wheel API and of the telemetry frame */
+enum { WHEEL_LF, WHEEL_LB, WHEEL_RF, WHEEL_RB, WHEEL_SLOTS };
+
+/** Mixer matrix columns */
+enum { MIX_FORWARD, MIX_STRAFE, MIX_YAW, MIX_AXES };
+
+/** LEDC channels of the speed mode the driver uses */
+#define DRIVETRAIN_LEDC_CHANNELS 8
+
+// ESP32 GPIOs usable as outputs: 6-11 drive the flash, 20/24/28-31 don't exist
+#define DRIVETRAIN_OUTPUT_PINS (0x0000003full | 0x000ff000ull | 0x00e00000ull | \
+                                0x0e000000ull | 0x300000000ull)
+
+typedef struct {
+    uint8_t slot;               // WHEEL_*
+    uint8_t in1, in2, pwm;      // default pins
+    uint8_t channel;            // LEDC channel
+    bool inverted;              // mounted mirrored: forward drives IN2 high
+    int8_t mix[MIX_AXES];       // -1, 0 or 1 per axis; strafe is to the right,
+                                // yaw clockwise seen from above
+} wheel_desc_t;
+
+template <size_t N>
+struct drivetrain_desc_t {
+    const char *name;
+    uint8_t stby;               // default STBY pin
+    wheel_desc_t wheels[N];
+
+    static constexpr size_t count = N;
+};
+
+/* =====================================================
+ *              CHASSIS VARIANTS
+ * ===================================================== */
+
+// Reference car: four TT gearmotors on two TB6612s
+constexpr drivetrain_desc_t<4> drivetrain_4wd = {"4wd", 19, {
+    {WHEEL_LF, 23, 22, 21, 0, false, {1, 0, 1}},
+    {WHEEL_LB, 18, 5, 17, 1, false, {1, 0, 1}},
+    {WHEEL_RF, 27, 26, 25, 2, false, {1, 0, -1}},
+    {WHEEL_RB, 33, 32, 14, 3, false, {1, 0, -1}},
+}};
+
+// One TB6612, one motor per side; uses the LF and RF slots and pins
+constexpr drivetrain_desc_t<2> drivetrain_2wd = {"2wd", 19, {
+    {WHEEL_LF, 23, 22, 21, 0, false, {1, 0, 1}},
+    {WHEEL_RF, 27, 26, 25, 1, false, {1, 0, -1}},
+}};
+
+// Mecanum wheels with rollers in an X seen from above. The strafe
+// column is a placeholder: no command carries that axis yet, so the
+// mixers only use the forward and yaw columns.
+constexpr drivetrain_desc_t<4> drivetrain_mecanum = {"mecanum", 19, {
+    {WHEEL_LF, 23, 22, 21, 0, false, {1, 1, 1}},
+    {WHEEL_LB, 18, 5, 17, 1, false, {1, -1, 1}},
+    {WHEEL_RF, 27, 26, 25, 2, false, {1, -1, -1}},
+    {WHEEL_RB, 33, 32, 14, 3, false, {1, 1, -1}},
+}};
+
+#if DRIVETRAIN == DRIVETRAIN_2WD
+static constexpr const auto &drivetrain = drivetrain_2wd;
+#elif DRIVETRAIN == DRIVETRAIN_4WD
+static constexpr const auto &drivetrain = drivetrain_4wd;
+#elif DRIVETRAIN == DRIVETRAIN_MECANUM
+static constexpr const auto &drivetrain = drivetrain_mecanum;
+#else
+#error "DRIVETRAIN must be DRIVETRAIN_2WD, DRIVETRAIN_4WD or DRIVETRAIN_MECANUM"
+#endif
+
+/** Wheels of the selected chassis */
+#define DRIVETRAIN_WHEELS (drivetrain.count)
+
+typedef struct {
+    int8_t row[WHEEL_SLOTS][MIX_AXES];
+} drivetrain_matrix_t;
+
+/** Mixer matrix of the selected chassis by wheel slot; empty slots are zero */
+constexpr drivetrain_matrix_t drivetrain_matrix(void)
+{
+    drivetrain_matrix_t m{};
+    for (const auto &w : drivetrain.wheels) {
+        for (int a = 0; a < MIX_AXES; a++)
+            m.row[w.slot][a] = w.mix[a];
+    }
+    return m;
+}
+
+/** Bitmap of the wheel slots the selected chassis uses */
+constexpr unsigned drivetrain_slot_mask(void)
+{
+    unsigned mask = 0;
+    for (const auto &w : drivetrain.wheels)
+        mask |= 1u << w.slot;
+    return mask;
+}
+
+/* =====================================================
+ *              VALIDATION
+ * ===================================================== */
+
+template <size_t N>
+constexpr bool drivetrain_slots_ok(const drivetrain_desc_t<N> &dt)
+{
+    unsigned used = 0;
+    for (const auto &w : dt.wheels) {
+        if (w.slot >= WHEEL_SLOTS || (used & (1u << w.slot)))
+            return false;
+        used |= 1u << w.slot;
+    }
+    return N > 0 && N <= WHEEL_SLOTS;
+}
+
+constexpr bool drivetrain_pin_ok(uint8_t pin, uint64_t used)
+{
+    return pin < 64 && ((DRIVETRAIN_OUTPUT_PINS >> pin) & 1) && !(used & (1ull << pin));
+}
+
+template <size_t N>
+constexpr bool drivetrain_pins_ok(const drivetrain_desc_t<N> &dt)
+{
+    if (!drivetrain_pin_ok(dt.stby, 0))
+        return false;
+    uint64_t used = 1ull << dt.stby;
+    for (const auto &w : dt.wheels) {
+        for (uint8_t pin : {w.in1, w.in2, w.pwm}) {
+            if (!drivetrain_pin_ok(pin, used))
+                return false;
+            used |= 1ull << pin;
+        }
+    }
+    return true;
+}
+
+template <size_t N>
+constexpr bool drivetrain_channels_ok(const drivetrain_desc_t<N> &dt)
+{
+    unsigned used = 0;
+    for (const auto &w : dt.wheels) {
+        if (w.channel >= DRIVETRAIN_LEDC_CHANNELS || (used & (1u << w.channel)))
+            return false;
+        used |= 1u << w.channel;
+    }
+    return true;
+}
+
+/*
+ * Every wheel drives forward, left wheels yaw clockwise when they speed
+ * up and right wheels the other way, and strafe and yaw cancel out when
+ * the car is driven straight ahead.
+ */
+template <size_t N>
+constexpr bool drivetrain_mix_ok(const drivetrain_desc_t<N> &dt)
+{
+    int strafe = 0, yaw = 0;
+    for (const auto &w : dt.wheels) {
+        for (int8_t c : w.mix) {
+            if (c < -1 || c > 1)
+                return false;
+        }
+        bool left = w.slot == WHEEL_LF || w.slot == WHEEL_LB;
+        if (w.mix[MIX_FORWARD] != 1 || w.mix[MIX_YAW] != (left ? 1 : -1))
+            return false;
+        strafe += w.mix[MIX_STRAFE];
+        yaw += w.mix[MIX_YAW];
+    }
+    return strafe == 0 && yaw == 0;
+}
+
+#define DRIVETRAIN_CHECK(dt)                                                     \
+    static_assert(drivetrain_slots_ok(dt), #dt ": 1-4 wheels, distinct slots");   \
+    static_assert(drivetrain_pins_ok(dt), #dt ": pins must be distinct outputs"); \
+    static_assert(drivetrain_channels_ok(dt), #dt ": LEDC channels 0-7, distinct"); \
+    static_assert(drivetrain_mix_ok(dt), #dt ": unbalanced mixer matrix")
+
+DRIVETRAIN_CHECK(drivetrain_2wd);
+DRIVETRAIN_CHECK(drivetrain_4wd);
+DRIVETRAIN_CHECK(drivetrain_mecanum);
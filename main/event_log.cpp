@@ -0,0 +1,176 @@
+#include "event_log.h"
+
+#include <atomic>
+#include <stdio.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define DRAIN_TASK_STACK 3072
+#define DRAIN_TASK_PRIO (tskIDLE_PRIORITY + 1)
+
+static_assert((EVENT_LOG_ENTRIES & (EVENT_LOG_ENTRIES - 1)) == 0,
+              "EVENT_LOG_ENTRIES must be a power of two");
+
+/* =====================================================
+ *              EVENT DESCRIPTIONS
+ * ===================================================== */
+
+typedef struct {
+    const char *tag;
+    const char *fmt;        // printf format for up to four int arguments
+} evlog_desc_t;
+
+static const evlog_desc_t descs[EVT_COUNT] = {
+    {"event_log", "(none)"},
+    {"motor_ctrl", "APPLY duty LF=%d LB=%d RF=%d RB=%d"},
+    {"motor_ctrl", "Direction change, wheel %d forward=%d"},
+    {"web_server", "WS close frame received on fd %d - stopping motors"},
+    {"web_server", "WS frame too long (%d bytes)"},
+    {"web_server", "Bad binary frame length %d"},
+    {"web_server", "Fragmented WS message rejected (%d bytes)"},
+    {"failsafe", "No command for %d ms (limit %d) - ramping to stop"},
+    {"udp_control", "New UDP controller from port %d"},
+    {"boot", "First command accepted %d ms after power-up"},
+};
+
+/* =====================================================
+ *              RING
+ * =====================================================
+ *
+ * Writers claim a sequence number with one atomic add and own its
+ * slot until they publish stamp = seq + 1. Readers copy the slot and
+ * re-check the stamp afterwards (seqlock style), so an event that was
+ * overwritten mid-copy is reported as lost rather than torn.
+ */
+
+typedef struct {
+    std::atomic<uint32_t> stamp;    // seq + 1 once written, 0 while busy
+    uint32_t t_us;
+    uint8_t level;
+    uint8_t id;
+    int32_t args[4];
+} slot_t;
+
+static slot_t ring[EVENT_LOG_ENTRIES];
+static std::atomic<uint32_t> head{0};
+
+static uint32_t dropped = 0;    // drain task only
+
+void event_log_write(uint8_t level, evlog_id_t id,
+                     int32_t a0, int32_t a1, int32_t a2, int32_t a3)
+{
+    uint32_t seq = head.fetch_add(1, std::memory_order_relaxed);
+    slot_t &s = ring[seq & (EVENT_LOG_ENTRIES - 1)];
+
+    s.stamp.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    s.t_us = (uint32_t)esp_timer_get_time();
+    s.level = level;
+    s.id = (uint8_t)id;
+    s.args[0] = a0;
+    s.args[1] = a1;
+    s.args[2] = a2;
+    s.args[3] = a3;
+
+    s.stamp.store(seq + 1, std::memory_order_release);
+}
+
+// 0 = copied, < 0 = not written yet (or in progress), > 0 = overwritten
+static int read_slot(uint32_t seq, evlog_event_t *out)
+{
+    const slot_t &s = ring[seq & (EVENT_LOG_ENTRIES - 1)];
+
+    uint32_t stamp = s.stamp.load(std::memory_order_acquire);
+    if (stamp != seq + 1)
+        return stamp == 0 || (int32_t)(stamp - (seq + 1)) < 0 ? -1 : 1;
+
+    out->seq = seq;
+    out->t_us = s.t_us;
+    out->level = s.level;
+    out->id = (evlog_id_t)s.id;
+    for (int i = 0; i < 4; i++)
+        out->args[i] = s.args[i];
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return s.stamp.load(std::memory_order_relaxed) == seq + 1 ? 0 : 1;
+}
+
+/* =====================================================
+ *              EVENT LOG API
+ * ===================================================== */
+
+uint32_t event_log_head(void)
+{
+    return head.load(std::memory_order_acquire);
+}
+
+bool event_log_read(uint32_t seq, evlog_event_t *out)
+{
+    return read_slot(seq, out) == 0;
+}
+
+int event_log_format(const evlog_event_t *e, char *buf, size_t len)
+{
+    const evlog_desc_t &d = descs[e->id < EVT_COUNT ? e->id : EVT_NONE];
+    char level = "-EWID"[e->level <= EVLOG_LEVEL_DEBUG ? e->level : 0];
+
+    int n = snprintf(buf, len, "%c (%u) %s: ", level,
+                     (unsigned)(e->t_us / 1000), d.tag);
+    if (n < 0 || (size_t)n >= len)
+        return n;
+    return n + snprintf(buf + n, len - n, d.fmt, (int)e->args[0],
+                        (int)e->args[1], (int)e->args[2], (int)e->args[3]);
+}
+
+void event_log_get_stats(event_log_stats_t *out)
+{
+    out->written = event_log_head();
+    out->dropped = dropped;
+}
+
+/* =====================================================
+ *              DRAIN TASK
+ * ===================================================== */
+
+static void drain_task_fn(void *arg)
+{
+    uint32_t next = 0;
+
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(EVENT_LOG_DRAIN_MS));
+
+        uint32_t end = event_log_head();
+        if (end - next > EVENT_LOG_ENTRIES) {
+            dropped += end - next - EVENT_LOG_ENTRIES;
+            next = end - EVENT_LOG_ENTRIES;
+        }
+
+        for (; next != end; next++) {
+            evlog_event_t e;
+            int r = read_slot(next, &e);
+            if (r < 0)
+                break;      // still being written, pick it up next round
+            if (r > 0) {
+                dropped++;
+                continue;
+            }
+
+            char line[128];
+            event_log_format(&e, line, sizeof(line));
+            esp_log_write((esp_log_level_t)e.level, descs[e.id].tag, "%s\n", line);
+        }
+    }
+}
+
+void event_log_start(void)
+{
+    if (EVENT_LOG_DRAIN_MS == 0)
+        return;
+
+    xTaskCreate(drain_task_fn, "event_log", DRAIN_TASK_STACK, NULL,
+                DRAIN_TASK_PRIO, NULL);
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =====================================================
+ *              BINARY EVENT LOG
+ * =====================================================
+ *
+ * Hot paths record a fixed-size binary event (timestamp, event id,
+ * up to four integer arguments) into a lock-free ring instead of
+ * formatting a log line. A low-priority task formats and prints the
+ * ring in the background; readers such as GET /log can also walk it
+ * by sequence number without consuming anything.
+ *
+ *   EVLOG_I(EVT_MOTOR_APPLY, duty_lf, duty_lb, duty_rf, duty_rb);
+ *
+ * Calls above EVLOG_LEVEL compile to nothing, arguments included.
+ */
+
+#define EVLOG_LEVEL_NONE 0
+#define EVLOG_LEVEL_ERROR 1
+#define EVLOG_LEVEL_WARN 2
+#define EVLOG_LEVEL_INFO 3
+#define EVLOG_LEVEL_DEBUG 4
+
+#ifndef EVLOG_LEVEL
+#define EVLOG_LEVEL EVLOG_LEVEL_INFO
+#endif
+
+/** Ring capacity in events (power of two); the oldest are overwritten */
+#define EVENT_LOG_ENTRIES 256
+
+/** Background drain period; 0 disables console output */
+#define EVENT_LOG_DRAIN_MS 200
+
+typedef enum {
+    EVT_NONE = 0,
+    EVT_MOTOR_APPLY,        // signed duty LF, LB, RF, RB
+    EVT_MOTOR_REVERSE,      // wheel index, forward
+    EVT_WS_CLOSE,           // socket fd
+    EVT_WS_OVERSIZED,       // frame length
+    EVT_WS_BAD_BINARY,      // frame length
+    EVT_WS_FRAGMENTED,      // frame length
+    EVT_FAILSAFE_TRIP,      // command gap ms, limit ms
+    EVT_UDP_SESSION,        // sender port
+    EVT_BOOT_FIRST_COMMAND, // ms since power-up
+    EVT_COUNT
+} evlog_id_t;
+
+typedef struct {
+    uint32_t seq;           // position in the log, counts up from 0
+    uint32_t t_us;          // esp_timer time of the event (wraps)
+    uint8_t level;          // EVLOG_LEVEL_*
+    evlog_id_t id;
+    int32_t args[4];
+} evlog_event_t;
+
+typedef struct {
+    uint32_t written;       // events recorded since boot
+    uint32_t dropped;       // events overwritten before the drain task saw them
+} event_log_stats_t;
+
+/**
+ * @brief Record one event; safe from any task or core, never blocks
+ *
+ * Use the EVLOG_x macros rather than calling this directly.
+ */
+void event_log_write(uint8_t level, evlog_id_t id,
+                     int32_t a0, int32_t a1, int32_t a2, int32_t a3);
+
+/**
+ * @brief Start the background drain task (no-op if EVENT_LOG_DRAIN_MS is 0)
+ */
+void event_log_start(void);
+
+/**
+ * @brief Sequence number the next event will get
+ *
+ * Events head - EVENT_LOG_ENTRIES .. head - 1 may still be in the ring.
+ */
+uint32_t event_log_head(void);
+
+/**
+ * @brief Copy one event out of the ring
+ * @return false if seq was never written, is still being written or
+ *         has been overwritten
+ */
+bool event_log_read(uint32_t seq, evlog_event_t *out);
+
+/**
+ * @brief Format an event like an ESP_LOGx line: "W (<ms>) <tag>: <message>"
+ * @return Length as snprintf
+ */
+int event_log_format(const evlog_event_t *e, char *buf, size_t len);
+
+/**
+ * @brief Snapshot ring counters
+ */
+void event_log_get_stats(event_log_stats_t *out);
+
+// Pads the argument list to exactly four values
+#define EVLOG_ARGS4_(a0, a1, a2, a3, ...) (int32_t)(a0), (int32_t)(a1), (int32_t)(a2), (int32_t)(a3)
+#define EVLOG_EMIT_(level, id, ...) \
+    event_log_write(level, id, EVLOG_ARGS4_(__VA_ARGS__, 0, 0, 0, 0))
+
+#if EVLOG_LEVEL >= EVLOG_LEVEL_ERROR
+#define EVLOG_E(id, ...) EVLOG_EMIT_(EVLOG_LEVEL_ERROR, id, __VA_ARGS__)
+#else
+#define EVLOG_E(id, ...) do { } while (0)
+#endif
+
+#if EVLOG_LEVEL >= EVLOG_LEVEL_WARN
+#define EVLOG_W(id, ...) EVLOG_EMIT_(EVLOG_LEVEL_WARN, id, __VA_ARGS__)
+#else
+#define EVLOG_W(id, ...) do { } while (0)
+#endif
+
+#if EVLOG_LEVEL >= EVLOG_LEVEL_INFO
+#define EVLOG_I(id, ...) EVLOG_EMIT_(EVLOG_LEVEL_INFO, id, __VA_ARGS__)
+#else
+#define EVLOG_I(id, ...) do { } while (0)
+#endif
+
+#if EVLOG_LEVEL >= EVLOG_LEVEL_DEBUG
+#define EVLOG_D(id, ...) EVLOG_EMIT_(EVLOG_LEVEL_DEBUG, id, __VA_ARGS__)
+#else
+#define EVLOG_D(id, ...) do { } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,110 @@
+#include "failsafe.h"
+#include "motor_control.h"
+#include "event_log.h"
+#include "app_config.h"
+
+#include <atomic>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "failsafe";
+
+/* =====================================================
+ *              WATCHDOG STATE
+ * ===================================================== */
+
+// Time of the last valid command in us, 0 while disarmed
+static std::atomic<int64_t> last_feed_us{0};
+
+// Written by config updates, read by the poll timer
+static std::atomic<uint32_t> timeout_us{FAILSAFE_TIMEOUT_MS * 1000};
+static std::atomic<uint32_t> ramp_ms{FAILSAFE_RAMP_MS};
+static esp_timer_handle_t poll_timer = NULL;
+
+static failsafe_stats_t stats;
+
+static void poll_cb(void *arg)
+{
+    failsafe_poll(esp_timer_get_time());
+}
+
+/* =====================================================
+ *              FAILSAFE API
+ * ===================================================== */
+
+// Check four times per window so a trip is late by at most 25%
+static void set_limits(uint32_t timeout_ms, uint32_t ramp)
+{
+    timeout_us.store(timeout_ms * 1000, std::memory_order_relaxed);
+    ramp_ms.store(ramp, std::memory_order_relaxed);
+
+    esp_timer_stop(poll_timer);
+    ESP_ERROR_CHECK(esp_timer_start_periodic(poll_timer, timeout_ms * 1000 / 4));
+}
+
+static void on_config_change(const app_config_t *cfg)
+{
+    if (cfg->failsafe_timeout_ms * 1000 != timeout_us.load(std::memory_order_relaxed) ||
+        cfg->failsafe_ramp_ms != ramp_ms.load(std::memory_order_relaxed))
+        set_limits(cfg->failsafe_timeout_ms, cfg->failsafe_ramp_ms);
+}
+
+void failsafe_init(uint32_t timeout_ms, uint32_t ramp)
+{
+    esp_timer_create_args_t args{};
+    args.callback = poll_cb;
+    args.name = "failsafe";
+    ESP_ERROR_CHECK(esp_timer_create(&args, &poll_timer));
+
+    set_limits(timeout_ms ? timeout_ms : FAILSAFE_TIMEOUT_MS,
+               ramp ? ramp : FAILSAFE_RAMP_MS);
+    app_config_subscribe(on_config_change);
+
+    ESP_LOGI(TAG, "Failsafe armed on first command, timeout %u ms",
+             (unsigned)(timeout_us.load() / 1000));
+}
+
+void failsafe_feed(void)
+{
+    failsafe_feed_at(esp_timer_get_time());
+}
+
+void failsafe_feed_at(int64_t now_us)
+{
+    last_feed_us.store(now_us, std::memory_order_relaxed);
+}
+
+bool failsafe_poll(int64_t now_us)
+{
+    int64_t last = last_feed_us.load(std::memory_order_relaxed);
+    uint32_t limit_us = timeout_us.load(std::memory_order_relaxed);
+    if (last == 0 || now_us - last <= (int64_t)limit_us) {
+        if (last != 0)
+            stats.tripped = false;
+        return false;
+    }
+
+    // Disarm until the next command; a newer feed wins the race
+    if (!last_feed_us.compare_exchange_strong(last, 0))
+        return false;
+
+    stats.trips++;
+    stats.tripped = true;
+    stats.last_gap_ms = (uint32_t)((now_us - last) / 1000);
+
+    // Runs in the esp_timer task, which must not block on the UART
+    EVLOG_W(EVT_FAILSAFE_TRIP, stats.last_gap_ms, limit_us / 1000);
+    ramp_stop_motors(ramp_ms.load(std::memory_order_relaxed));
+    return true;
+}
+
+bool failsafe_armed(void)
+{
+    return last_feed_us.load(std::memory_order_relaxed) != 0;
+}
+
+void failsafe_get_stats(failsafe_stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Default command timeout before the drive is ramped to zero */
+#define FAILSAFE_TIMEOUT_MS 150
+
+/** Default ramp-down duration once the failsafe trips */
+#define FAILSAFE_RAMP_MS 300
+
+typedef struct {
+    uint32_t trips;             // number of times the failsafe fired
+    uint32_t last_gap_ms;       // command gap measured at the last trip
+    bool tripped;               // no valid command since the last trip
+} failsafe_stats_t;
+
+/**
+ * @brief Start the dead-man watchdog
+ *
+ * The watchdog arms on the first failsafe_feed(). If no further feed
+ * arrives within timeout_ms, the drive is ramped to zero over ramp_ms.
+ *
+ * Configuration updates (fs_timeout_ms, fs_ramp_ms) replace both
+ * values at run time.
+ *
+ * @param timeout_ms Command timeout (0 = FAILSAFE_TIMEOUT_MS)
+ * @param ramp_ms Ramp-down duration (0 = FAILSAFE_RAMP_MS)
+ */
+void failsafe_init(uint32_t timeout_ms, uint32_t ramp_ms);
+
+/**
+ * @brief Record a valid control frame or heartbeat
+ */
+void failsafe_feed(void);
+
+/**
+ * @brief Record a valid control frame or heartbeat received at now_us
+ *
+ * failsafe_feed() with an explicit timestamp (esp_timer time base, > 0),
+ * so tests can drive the watchdog from a simulated clock together with
+ * failsafe_poll().
+ */
+void failsafe_feed_at(int64_t now_us);
+
+/**
+ * @brief Evaluate the watchdog at time now_us
+ *
+ * Called periodically from an esp_timer; exposed so the timeout logic can
+ * be driven by a simulated clock.
+ *
+ * @return true if the failsafe tripped on this call
+ */
+bool failsafe_poll(int64_t now_us);
+
+/**
+ * @brief Whether a controller is driving the car
+ *
+ * True from the first command or heartbeat until the watchdog trips, so
+ * for as long as a WebSocket or UDP controller keeps sending.
+ */
+bool failsafe_armed(void);
+
+/**
+ * @brief Snapshot trip counters
+ */
+void failsafe_get_stats(failsafe_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,103 @@
+#include "json_arena.h"
+
+#include <atomic>
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+extern "C" {
+#include "cJSON.h"
+}
+
+/* =====================================================
+ *              ARENA STATE
+ * =====================================================
+ *
+ * cJSON's hooks are global, so the arena only serves the task that
+ * claimed it for the current frame (the httpd task). Frees are no-ops
+ * for arena memory; the whole frame is dropped by resetting the offset.
+ */
+
+#define ARENA_ALIGN 8
+
+alignas(ARENA_ALIGN) static uint8_t arena[JSON_ARENA_SIZE];
+static size_t arena_used = 0;
+static std::atomic<TaskHandle_t> owner{NULL};
+static json_arena_stats_t stats;
+
+static inline bool in_arena(const void *p)
+{
+    return (const uint8_t *)p >= arena && (const uint8_t *)p < arena + sizeof(arena);
+}
+
+static inline bool is_owner(void)
+{
+    TaskHandle_t o = owner.load(std::memory_order_relaxed);
+    return o && o == xTaskGetCurrentTaskHandle();
+}
+
+/* =====================================================
+ *              cJSON HOOKS
+ * ===================================================== */
+
+static void *arena_malloc(size_t size)
+{
+    if (!is_owner()) {
+        stats.fallbacks++;
+        return malloc(size);
+    }
+    return json_arena_alloc(size);
+}
+
+static void arena_free(void *p)
+{
+    if (!in_arena(p))
+        free(p);
+}
+
+/* =====================================================
+ *              ARENA API
+ * ===================================================== */
+
+void json_arena_init(void)
+{
+    cJSON_Hooks hooks = {arena_malloc, arena_free};
+    cJSON_InitHooks(&hooks);
+}
+
+void json_arena_begin(void)
+{
+    arena_used = 0;
+    owner.store(xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
+    stats.frames++;
+}
+
+void *json_arena_alloc(size_t size)
+{
+    if (!is_owner())
+        return NULL;
+
+    size_t start = (arena_used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (start > sizeof(arena) || size > sizeof(arena) - start) {
+        stats.exhausted++;
+        return NULL;
+    }
+
+    arena_used = start + size;
+    if (arena_used > stats.peak_bytes)
+        stats.peak_bytes = arena_used;
+    stats.allocs++;
+    return arena + start;
+}
+
+void json_arena_end(void)
+{
+    owner.store(NULL, std::memory_order_relaxed);
+    arena_used = 0;
+}
+
+void json_arena_get_stats(json_arena_stats_t *out)
+{
+    *out = stats;
+}
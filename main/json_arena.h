@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Bump arena backing the cJSON tree of one control frame */
+#define JSON_ARENA_SIZE (4 * 1024)
+
+typedef struct {
+    uint32_t frames;        // frames parsed in the arena
+    uint32_t allocs;        // allocations served from the arena
+    uint32_t fallbacks;     // cJSON allocations from other tasks (heap)
+    uint32_t exhausted;     // allocations refused because the arena was full
+    size_t peak_bytes;      // high-water mark of arena usage
+} json_arena_stats_t;
+
+/**
+ * @brief Install the arena as cJSON's allocator
+ *
+ * Allocations made by the task inside json_arena_begin()/json_arena_end()
+ * come from a static arena and are released all at once; cJSON use from
+ * any other task falls back to malloc/free.
+ */
+void json_arena_init(void);
+
+/**
+ * @brief Claim the (emptied) arena for one parse on the calling task
+ */
+void json_arena_begin(void);
+
+/**
+ * @brief Allocate from the arena (NULL when exhausted or not claimed)
+ */
+void *json_arena_alloc(size_t size);
+
+/**
+ * @brief Release everything allocated since json_arena_begin()
+ */
+void json_arena_end(void);
+
+/**
+ * @brief Snapshot allocation counters
+ */
+void json_arena_get_stats(json_arena_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
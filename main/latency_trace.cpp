@@ -0,0 +1,178 @@
+#include "latency_trace.h"
+#include "boot.h"
+
+#include <atomic>
+#include <string.h>
+
+#include "esp_timer.h"
+
+/* =====================================================
+ *              LOG-LINEAR HISTOGRAM
+ * =====================================================
+ *
+ * HDR-style buckets: values below 8 us are exact, above that
+ * every power of two is split into 8 linear sub-buckets
+ * (~12% relative error). 22 magnitudes cover up to ~16 s.
+ * Apply and total have a single writer (the control task), so
+ * plain increments are sufficient there. Parse and dispatch are
+ * written by whichever transport task received the frame (httpd
+ * or UDP); with both in use at once an increment can be lost,
+ * which a latency histogram tolerates. Readers may see a torn
+ * snapshot.
+ */
+
+#define SUB_BITS 3
+#define SUB_COUNT (1u << SUB_BITS)
+#define MAX_MAGNITUDE 23
+#define BUCKET_COUNT ((MAX_MAGNITUDE - SUB_BITS + 2) * SUB_COUNT)
+
+typedef struct {
+    uint32_t buckets[BUCKET_COUNT];
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t last_us;
+} histogram_t;
+
+static histogram_t hist[TRACE_STAGE_COUNT];
+
+static std::atomic<uint32_t> pending_recv{0};
+static std::atomic<uint32_t> pending_dispatch{0};
+static std::atomic<uint16_t> pending_seq{0};
+static std::atomic<trace_applied_cb_t> applied_cb{nullptr};
+
+static inline int msb(uint32_t v)
+{
+    return 31 - __builtin_clz(v);
+}
+
+static inline uint32_t bucket_index(uint32_t v)
+{
+    if (v < SUB_COUNT)
+        return v;
+
+    int m = msb(v);
+    if (m > MAX_MAGNITUDE)
+        return BUCKET_COUNT - 1;
+
+    int shift = m - SUB_BITS;
+    return (m - SUB_BITS + 1) * SUB_COUNT + ((v >> shift) & (SUB_COUNT - 1));
+}
+
+static inline uint32_t bucket_value(uint32_t idx)
+{
+    if (idx < SUB_COUNT)
+        return idx;
+
+    uint32_t m = idx / SUB_COUNT + SUB_BITS - 1;
+    uint32_t sub = idx % SUB_COUNT;
+    return (SUB_COUNT + sub) << (m - SUB_BITS);
+}
+
+static void hist_record(histogram_t *h, uint32_t v)
+{
+    h->buckets[bucket_index(v)]++;
+    if (h->count == 0 || v < h->min_us)
+        h->min_us = v;
+    if (v > h->max_us)
+        h->max_us = v;
+    h->count++;
+    h->last_us = v;
+}
+
+static uint32_t hist_quantile(const histogram_t *h, uint32_t count,
+                              uint32_t permille)
+{
+    uint32_t target = (uint32_t)(((uint64_t)count * permille + 999) / 1000);
+    uint32_t seen = 0;
+
+    for (uint32_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += h->buckets[i];
+        if (seen >= target && seen > 0)
+            return bucket_value(i);
+    }
+    return h->max_us;
+}
+
+/* =====================================================
+ *              TRACE API
+ * ===================================================== */
+
+uint32_t trace_now(void)
+{
+    return (uint32_t)esp_timer_get_time();
+}
+
+void trace_command(uint32_t t_recv, uint32_t t_parse, uint16_t seq)
+{
+    uint32_t t_dispatch = trace_now();
+
+    hist_record(&hist[TRACE_PARSE], t_parse - t_recv);
+    hist_record(&hist[TRACE_DISPATCH], t_dispatch - t_parse);
+
+    // Only the newest command is followed to the outputs; commands
+    // coalesced by the control task are not double counted
+    pending_recv.store(t_recv, std::memory_order_relaxed);
+    pending_seq.store(seq, std::memory_order_relaxed);
+    pending_dispatch.store(t_dispatch | 1, std::memory_order_release);
+
+    boot_note_command();
+}
+
+void trace_applied(void)
+{
+    uint32_t t_dispatch = pending_dispatch.exchange(0, std::memory_order_acquire);
+    if (!t_dispatch)
+        return;
+
+    uint32_t t_recv = pending_recv.load(std::memory_order_relaxed);
+    uint16_t seq = pending_seq.load(std::memory_order_relaxed);
+    uint32_t t_apply = trace_now();
+
+    hist_record(&hist[TRACE_APPLY], t_apply - t_dispatch);
+    hist_record(&hist[TRACE_TOTAL], t_apply - t_recv);
+
+    trace_applied_cb_t cb = applied_cb.load(std::memory_order_acquire);
+    if (cb)
+        cb(seq, t_apply - t_recv);
+}
+
+void trace_set_applied_callback(trace_applied_cb_t cb)
+{
+    applied_cb.store(cb, std::memory_order_release);
+}
+
+void trace_get_summary(trace_stage_t stage, trace_summary_t *out)
+{
+    const histogram_t *h = &hist[stage];
+
+    memset(out, 0, sizeof(*out));
+    out->count = h->count;
+    if (!out->count)
+        return;
+
+    out->min_us = h->min_us;
+    out->max_us = h->max_us;
+    out->p50_us = hist_quantile(h, out->count, 500);
+    out->p90_us = hist_quantile(h, out->count, 900);
+    out->p99_us = hist_quantile(h, out->count, 990);
+    out->p999_us = hist_quantile(h, out->count, 999);
+}
+
+uint32_t trace_last_us(trace_stage_t stage)
+{
+    return hist[stage].last_us;
+}
+
+const char *trace_stage_name(trace_stage_t stage)
+{
+    static const char *const names[TRACE_STAGE_COUNT] = {
+        "parse", "dispatch", "apply", "total"
+    };
+    return stage < TRACE_STAGE_COUNT ? names[stage] : "?";
+}
+
+void trace_reset(void)
+{
+    memset(hist, 0, sizeof(hist));
+}
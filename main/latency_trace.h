@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Command pipeline stages, each measured as an interval
+ */
+typedef enum {
+    TRACE_PARSE = 0,    // WS receive -> frame decoded
+    TRACE_DISPATCH,     // decoded -> setpoint published
+    TRACE_APPLY,        // published -> LEDC duty updated
+    TRACE_TOTAL,        // WS receive -> LEDC duty updated
+    TRACE_STAGE_COUNT
+} trace_stage_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t p50_us;
+    uint32_t p90_us;
+    uint32_t p99_us;
+    uint32_t p999_us;
+} trace_summary_t;
+
+/**
+ * @brief Current trace timestamp in microseconds (wraps, use differences)
+ */
+uint32_t trace_now(void);
+
+/**
+ * @brief Record a decoded control command that was just dispatched
+ *
+ * Every accepted command passes through here, so this also feeds the
+ * boot time-to-first-command (boot_note_command()).
+ *
+ * @param t_recv Timestamp taken when the frame arrived
+ * @param t_parse Timestamp taken when the frame was decoded
+ * @param seq Sender sequence number (0 for commands without one)
+ */
+void trace_command(uint32_t t_recv, uint32_t t_parse, uint16_t seq);
+
+/**
+ * @brief Record that the pending command reached the PWM outputs
+ *
+ * Called from the control task right after the duty update. Does
+ * nothing if no traced command is pending.
+ */
+void trace_applied(void);
+
+/** A traced command reached the outputs; total_us is receive -> duty update */
+typedef void (*trace_applied_cb_t)(uint16_t seq, uint32_t total_us);
+
+/**
+ * @brief Report every applied command to cb (NULL to stop)
+ *
+ * Runs on the control task right after the sample is recorded and must
+ * not block. The simulator's output probe uses it to tell external tools
+ * which command an output change belongs to.
+ */
+void trace_set_applied_callback(trace_applied_cb_t cb);
+
+/**
+ * @brief Snapshot the histogram of one stage
+ */
+void trace_get_summary(trace_stage_t stage, trace_summary_t *out);
+
+/**
+ * @brief Most recent sample of one stage (0 before the first)
+ */
+uint32_t trace_last_us(trace_stage_t stage);
+
+/**
+ * @brief Short lowercase name of a stage ("parse", "total", ...)
+ */
+const char *trace_stage_name(trace_stage_t stage);
+
+/**
+ * @brief Clear all histograms
+ */
+void trace_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
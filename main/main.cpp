@@ -12,35 +12,139 @@
 #include "esp_vfs.h"
 #include "esp_littlefs.h"
 
+#include "app_config.h"
+#include "asset_cache.h"
 #include "motor_control.h"
 #include "wifi_config.h"
 #include "web_server.h"
+#include "failsafe.h"
+#include "event_log.h"
+#include "udp_control.h"
+#include "boot.h"
 
 static const char *TAG = "rc_car";
 
 /* =====================================================
- *                  APP MAIN
- * ===================================================== */
+ *                  BOOT STAGES
+ * =====================================================
+ *
+ * Stage      Waits for
+ * nvs        -
+ * fs         -                   (not a stage when WEB_UI_EMBEDDED)
+ * motor      nvs (config)
+ * wifi       nvs (config, radio profile)
+ * server     fs, motor, wifi
+ * udp        motor, wifi
+ */
 
-extern "C" void app_main(void)
+enum {
+    STAGE_NVS,
+#if !WEB_UI_EMBEDDED
+    STAGE_FS,
+#endif
+    STAGE_MOTOR,
+    STAGE_WIFI,
+    STAGE_SERVER,
+    STAGE_UDP,
+};
+
+static void stage_nvs(void)
 {
     // Initialize NVS (non-volatile storage)
     ESP_ERROR_CHECK(nvs_flash_init());
 
-    // Initialize and mount LittleFS for web UI files
+    // Load board and tuning settings once; later reads come from RAM
+    app_config_init();
+}
+
+static esp_err_t register_littlefs(void)
+{
     esp_vfs_littlefs_conf_t fs{};
     fs.base_path = "/littlefs";
     fs.partition_label = "littlefs";
-    ESP_ERROR_CHECK(esp_vfs_littlefs_register(&fs));
+    return esp_vfs_littlefs_register(&fs);
+}
+
+#if WEB_UI_EMBEDDED
+// The page itself is in the app image; LittleFS only holds extra assets,
+// so it is mounted in the background once boot is done
+static bool mount_littlefs(void)
+{
+    esp_err_t err = register_littlefs();
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "LittleFS mount failed: %s", esp_err_to_name(err));
+    return err == ESP_OK;
+}
+
+#define FS_DEP 0
+#else
+static void stage_fs(void)
+{
+    // Initialize and mount LittleFS for web UI files
+    ESP_ERROR_CHECK(register_littlefs());
+}
+
+#define FS_DEP BOOT_DEP(STAGE_FS)
+#endif
+
+static void stage_motor(void)
+{
+    app_config_t cfg;
+    app_config_get(&cfg);
 
-    // Initialize motor driver (GPIO, PWM)
+    // Initialize motor driver (GPIO, PWM) and start the control loop
     motor_init();
+    motor_control_start(cfg.control_rate_hz);
 
+    // Ramp to a stop if the controller goes silent
+    failsafe_init(cfg.failsafe_timeout_ms, cfg.failsafe_ramp_ms);
+}
+
+static void stage_wifi(void)
+{
     // Initialize WiFi access point
     wifi_init_softap();
+}
 
+static void stage_server(void)
+{
     // Start HTTP server with WebSocket support
     start_server();
+}
+
+static void stage_udp(void)
+{
+    // Optional loss-tolerant control path next to the WebSocket
+    udp_control_start(UDP_CONTROL_PORT);
+}
+
+static const boot_stage_t stages[] = {
+    {"nvs", stage_nvs, 0},
+#if !WEB_UI_EMBEDDED
+    {"fs", stage_fs, 0},
+#endif
+    {"motor", stage_motor, BOOT_DEP(STAGE_NVS)},
+    {"wifi", stage_wifi, BOOT_DEP(STAGE_NVS)},
+    {"server", stage_server,
+     FS_DEP | BOOT_DEP(STAGE_MOTOR) | BOOT_DEP(STAGE_WIFI)},
+    {"udp", stage_udp, BOOT_DEP(STAGE_MOTOR) | BOOT_DEP(STAGE_WIFI)},
+};
+
+/* =====================================================
+ *                  APP MAIN
+ * ===================================================== */
+
+extern "C" void app_main(void)
+{
+    // Hot paths log into a ring; a low-priority task prints it
+    event_log_start();
+
+    boot_run(stages, sizeof(stages) / sizeof(stages[0]));
+
+#if WEB_UI_EMBEDDED
+    // Off the httpd task, and out of the way of the boot stages
+    asset_cache_mount_async(mount_littlefs);
+#endif
 
     ESP_LOGI(TAG, "RC CAR READY");
 }
@@ -1,8 +1,19 @@
 #include "motor_control.h"
+#include "latency_trace.h"
+#include "event_log.h"
+#include "app_config.h"
+#include "drive_mixer.h"
+#include "drivetrain.h"
+
+#include <atomic>
+#include <string.h>
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
 #include "driver/ledc.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -10,160 +21,661 @@ static const char *TAG = "motor_ctrl";
 
 /* =====================================================
  *                  TB6612 PIN MAPPING
+ * =====================================================
+ *
+ * Copied from the configuration at init (see app_config.h). Per-wheel
+ * arrays follow drivetrain.wheels, so a 2WD build keeps two of each;
+ * commands and outputs stay indexed by wheel slot.
+ */
+
+static gpio_num_t stby_pin;
+static gpio_num_t in1_pins[DRIVETRAIN_WHEELS], in2_pins[DRIVETRAIN_WHEELS];
+static gpio_num_t pwm_pins[DRIVETRAIN_WHEELS];
+
+/*
+ * Direction pin masks, built once from the pin map. Entry d of
+ * dir_table holds the IN1/IN2 levels for direction bitmap d (bit i
+ * set = wheel i of drivetrain.wheels forward), and wheel_pins[w] covers
+ * both inputs of every wheel in bitmap w. Mirrored wheels have their
+ * inputs swapped here, so forward always means forward. A tick's
+ * update is dir_table[dirs] restricted to wheel_pins[flipping]: two
+ * lookups and ANDs, no per-pin work.
+ */
+#define DIR_COMBOS (1 << DRIVETRAIN_WHEELS)
+
+typedef struct {
+    uint32_t set[2];    // bank 0 (GPIO0-31), bank 1 (GPIO32+)
+    uint32_t clr[2];
+} dir_masks_t;
+
+static dir_masks_t dir_table[DIR_COMBOS];
+static uint32_t wheel_pins[DIR_COMBOS][2];
+
+// Set MOTOR_STBY_SETTLE_MS after STBY goes high; no drive until then
+static std::atomic<bool> driver_ready{false};
+static esp_timer_handle_t settle_timer = NULL;
+
+/* =====================================================
+ *                  PWM CONFIG
  * ===================================================== */
 
-// Shared standby
-#define STBY GPIO_NUM_19
+#define PWM_SRC_CLK_HZ 80000000     // APB, selected explicitly below
 
-// LEFT FRONT
-#define LF_IN1 GPIO_NUM_23
-#define LF_IN2 GPIO_NUM_22
-#define LF_PWM GPIO_NUM_21
+#define PWM_TIMER LEDC_TIMER_0
+#define PWM_MODE LEDC_HIGH_SPEED_MODE
 
-// LEFT BACK
-#define LB_IN1 GPIO_NUM_18
-#define LB_IN2 GPIO_NUM_5
-#define LB_PWM GPIO_NUM_17
+static constexpr ledc_channel_t pwm_channel(size_t i)
+{
+    return (ledc_channel_t)drivetrain.wheels[i].channel;
+}
 
-// RIGHT FRONT
-#define RF_IN1 GPIO_NUM_27
-#define RF_IN2 GPIO_NUM_26
-#define RF_PWM GPIO_NUM_25
+/* =====================================================
+ *                  SLEW PROFILE
+ * =====================================================
+ *
+ * Duty changes run as LEDC hardware fades. The profile is the
+ * time for a full-scale 0 -> max (accel) or max -> 0 (decel)
+ * change; smaller steps get a proportional share of it.
+ */
 
-// RIGHT BACK
-#define RB_IN1 GPIO_NUM_33
-#define RB_IN2 GPIO_NUM_32
-#define RB_PWM GPIO_NUM_14
+static std::atomic<uint32_t> accel_ms{MOTOR_ACCEL_MS};
+static std::atomic<uint32_t> decel_ms{MOTOR_DECEL_MS};
+
+static uint32_t pwm_max_duty = 255; // set from the timer resolution at init
+static uint32_t issued_duty[DRIVETRAIN_WHEELS];    // last fade target per channel
+static int wheel_dir[DRIVETRAIN_WHEELS];            // 1 fwd, 0 rev, -1 not yet set
+
+// Signed Q15 view of issued_duty by wheel slot, for readers on other tasks
+static std::atomic<int16_t> output_q15[WHEEL_SLOTS];
 
 /* =====================================================
- *                  PWM CONFIG
+ *                  CONTROL TASK CONFIG
  * ===================================================== */
 
-#define PWM_FREQ_HZ 10000
-#define PWM_RES LEDC_TIMER_8_BIT
-#define PWM_MAX_DUTY 255
+#define CONTROL_TASK_STACK 3072
+#define CONTROL_TASK_PRIO (configMAX_PRIORITIES - 2)
+#define CONTROL_TASK_CORE 1
 
-#define PWM_TIMER LEDC_TIMER_0
-#define PWM_MODE LEDC_HIGH_SPEED_MODE
+/* =====================================================
+ *              SETPOINT MAILBOX
+ * =====================================================
+ *
+ * Latest-wins mailbox between the command producers (httpd,
+ * WiFi events) and the control task. Speed lives in the high
+ * half-word and steer in the low half-word, so both axes are
+ * published and consumed with a single 32-bit atomic access.
+ */
+
+static std::atomic<uint32_t> setpoint{0};
+
+// Setpoints are Q15: both halves are the signed speed/steer fractions
+
+/*
+ * Wheel commands bypass the mixer through a second, 64-bit word holding
+ * the four Q15 wheel setpoints (LF in the low half-word). wheel_mode
+ * says which word is current. Producers store their word before the
+ * flag, so the control task always sees a word at least as new as the
+ * flag it read. The ESP32 has no 64-bit atomic instructions: IDF backs
+ * this one with a short critical section, still a single access.
+ */
+static std::atomic<uint64_t> wheel_setpoint{0};
+static std::atomic<bool> wheel_mode{false};
+
+// Bumped after every publish, so the control task can tell a repeated
+// command from no command at all
+static std::atomic<uint32_t> publish_gen{0};
+
+// Mixer applied to speed/steer setpoints (drive_mixer_mode_t), live
+static std::atomic<uint8_t> mixer_mode{DRIVE_MIXER_DEFAULT_MODE};
+
+// Pending ramp-down request (duration in ms), consumed by the control task
+static std::atomic<uint32_t> ramp_request_ms{0};
+
+// Set by stop_motors(): the next tick cuts every duty to 0 without a fade
+static std::atomic<bool> stop_request{false};
+
+static TaskHandle_t control_task = NULL;
+static esp_timer_handle_t control_timer = NULL;
+static uint32_t control_rate_hz = MOTOR_CONTROL_RATE_HZ;
+
+// Worst tick period / run time and ticks since the last motor_take_loop_stats()
+static std::atomic<uint32_t> loop_period_max_us{0};
+static std::atomic<uint32_t> loop_work_max_us{0};
+static std::atomic<uint32_t> loop_ticks{0};
+
+static inline uint32_t pack_setpoint(int speed, int steer)
+{
+    return ((uint32_t)(uint16_t)speed << 16) | (uint16_t)steer;
+}
 
-static int speed_cmd = 0;   // -10 .. +10
-static int steer_cmd = 0;   // -10 .. +10
+static inline int setpoint_speed(uint32_t sp)
+{
+    return (int16_t)(sp >> 16);
+}
+
+static inline int setpoint_steer(uint32_t sp)
+{
+    return (int16_t)(sp & 0xffff);
+}
+
+static void publish_speed(int speed)
+{
+    uint32_t cur = setpoint.load(std::memory_order_relaxed);
+    while (!setpoint.compare_exchange_weak(
+        cur, pack_setpoint(speed, setpoint_steer(cur)),
+        std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    wheel_mode.store(false, std::memory_order_release);
+    publish_gen.fetch_add(1, std::memory_order_release);
+}
+
+static void publish_steer(int steer)
+{
+    uint32_t cur = setpoint.load(std::memory_order_relaxed);
+    while (!setpoint.compare_exchange_weak(
+        cur, pack_setpoint(setpoint_speed(cur), steer),
+        std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    wheel_mode.store(false, std::memory_order_release);
+    publish_gen.fetch_add(1, std::memory_order_release);
+}
+
+static inline void publish(int speed, int steer)
+{
+    setpoint.store(pack_setpoint(speed, steer), std::memory_order_release);
+    wheel_mode.store(false, std::memory_order_release);
+    publish_gen.fetch_add(1, std::memory_order_release);
+}
+
+static inline uint64_t pack_wheels(const q15_t w[4])
+{
+    uint64_t v = 0;
+    for (int i = 0; i < 4; i++)
+        v |= (uint64_t)(uint16_t)w[i] << (16 * i);
+    return v;
+}
+
+static inline void unpack_wheels(uint64_t v, q15_t w[4])
+{
+    for (int i = 0; i < 4; i++)
+        w[i] = (q15_t)(uint16_t)(v >> (16 * i));
+}
+
+static void publish_wheels(const q15_t w[4])
+{
+    wheel_setpoint.store(pack_wheels(w), std::memory_order_release);
+    wheel_mode.store(true, std::memory_order_release);
+    publish_gen.fetch_add(1, std::memory_order_release);
+}
+
+// A command as the control task sees it: the word of the mailbox it
+// came from
+typedef struct {
+    bool wheels;        // from the wheel mailbox
+    uint64_t word;
+} command_t;
+
+static inline command_t read_command(void)
+{
+    if (wheel_mode.load(std::memory_order_acquire))
+        return {true, wheel_setpoint.load(std::memory_order_acquire)};
+    return {false, setpoint.load(std::memory_order_acquire)};
+}
+
+static void command_wheels(const command_t &cmd, q15_t out[4])
+{
+    uint32_t word = (uint32_t)cmd.word;
+    if (cmd.wheels)
+        unpack_wheels(cmd.word, out);
+    else
+        drive_mixer_mix((drive_mixer_mode_t)mixer_mode.load(std::memory_order_relaxed),
+                        setpoint_speed(word), setpoint_steer(word), out);
+}
+
+// Zero the mailbox cmd came from, unless a newer command replaced it
+static void park_command(const command_t &cmd)
+{
+    if (cmd.wheels) {
+        uint64_t word = cmd.word;
+        wheel_setpoint.compare_exchange_strong(word, 0);
+    } else {
+        uint32_t word = (uint32_t)cmd.word;
+        setpoint.compare_exchange_strong(word, pack_setpoint(0, 0));
+    }
+}
 
 /* =====================================================
  *              SPEED → PWM CONVERSION
- * ===================================================== */
+ * =====================================================
+ *
+ * |speed| in Q15 maps to duty through a 257-point table built
+ * at init for the active PWM resolution, with linear
+ * interpolation between points. The table folds in:
+ *  - a stick deadband below which the output is 0
+ *  - a minimum duty that just overcomes gearmotor stall
+ *  - a cubic blend flattening the response near the bottom
+ */
+
+#define DUTY_LUT_BITS 8
+#define DUTY_LUT_SHIFT (15 - DUTY_LUT_BITS)
+#define DEADBAND_Q15 (Q15_ONE / 50)     // 2% of stick travel
+
+static uint32_t duty_lut[(1 << DUTY_LUT_BITS) + 1];
+
+static void build_duty_lut(uint32_t min_duty_pct, uint32_t curve_pct)
+{
+    const float min_duty = pwm_max_duty * min_duty_pct / 100.0f;
+    const float c = curve_pct / 100.0f;
+
+    for (int i = 0; i <= (1 << DUTY_LUT_BITS); i++) {
+        int q = i << DUTY_LUT_SHIFT;
+        if (q <= DEADBAND_Q15) {
+            duty_lut[i] = 0;
+            continue;
+        }
+        float x = (float)(q - DEADBAND_Q15) / (float)((Q15_ONE + 1) - DEADBAND_Q15);
+        if (x > 1.0f) x = 1.0f;
+        float y = (1.0f - c) * x + c * x * x * x;
+        duty_lut[i] = (uint32_t)(min_duty + y * (pwm_max_duty - min_duty) + 0.5f);
+    }
+}
+
+static inline uint32_t duty_from_q15(int mag)
+{
+    if (mag <= 0)
+        return 0;
+    if (mag >= Q15_ONE)
+        return duty_lut[1 << DUTY_LUT_BITS];
+
+    int idx = mag >> DUTY_LUT_SHIFT;
+    int frac = mag & ((1 << DUTY_LUT_SHIFT) - 1);
+    uint32_t a = duty_lut[idx];
+    uint32_t b = duty_lut[idx + 1];
+    return a + (uint32_t)(((int32_t)(b - a) * frac) >> DUTY_LUT_SHIFT);
+}
 
-static inline int pwm_from_speed(int speed)
+/*
+ * Finest duty resolution the LEDC counter supports at freq_hz:
+ * the counter has to wrap within one PWM period.
+ */
+static ledc_timer_bit_t resolution_for(uint32_t freq_hz)
 {
-    int s = abs(speed);
-    if (s > 10) s = 10;
-    return (s * PWM_MAX_DUTY) / 10;
+    uint32_t ticks = PWM_SRC_CLK_HZ / freq_hz;
+    int bits = 31 - __builtin_clz(ticks);
+    if (bits > LEDC_TIMER_BIT_MAX - 1)
+        bits = LEDC_TIMER_BIT_MAX - 1;
+    return (ledc_timer_bit_t)bits;
 }
 
 /* =====================================================
  *                  MOTOR INIT
  * ===================================================== */
 
+static inline void mask_add(uint32_t bank[2], gpio_num_t pin)
+{
+    bank[pin >> 5] |= 1u << (pin & 31);
+}
+
+static void build_dir_table(void)
+{
+    memset(dir_table, 0, sizeof(dir_table));
+    memset(wheel_pins, 0, sizeof(wheel_pins));
+
+    for (int d = 0; d < DIR_COMBOS; d++) {
+        for (size_t i = 0; i < DRIVETRAIN_WHEELS; i++) {
+            bool high1 = (bool)(d & (1 << i)) != drivetrain.wheels[i].inverted;
+            mask_add(dir_table[d].set, high1 ? in1_pins[i] : in2_pins[i]);
+            mask_add(dir_table[d].clr, high1 ? in2_pins[i] : in1_pins[i]);
+
+            if (d & (1 << i)) {
+                mask_add(wheel_pins[d], in1_pins[i]);
+                mask_add(wheel_pins[d], in2_pins[i]);
+            }
+        }
+    }
+}
+
+static void settle_cb(void *arg)
+{
+    driver_ready.store(true, std::memory_order_release);
+}
+
+// Slew times and the mixer are the motor settings that change at run time
+static void on_config_change(const app_config_t *cfg)
+{
+    motor_set_slew(cfg->accel_ms, cfg->decel_ms);
+    mixer_mode.store(cfg->mixer, std::memory_order_relaxed);
+}
+
 void motor_init(void)
 {
+    app_config_t cfg;
+    app_config_get(&cfg);
+
+    stby_pin = (gpio_num_t)cfg.pin_stby;
+    uint64_t outputs = 1ULL << stby_pin;
+    for (size_t i = 0; i < DRIVETRAIN_WHEELS; i++) {
+        const app_config_wheel_t &p = cfg.wheel[drivetrain.wheels[i].slot];
+        in1_pins[i] = (gpio_num_t)p.in1;
+        in2_pins[i] = (gpio_num_t)p.in2;
+        pwm_pins[i] = (gpio_num_t)p.pwm;
+        outputs |= (1ULL << in1_pins[i]) | (1ULL << in2_pins[i]);
+        wheel_dir[i] = -1;
+    }
+    build_dir_table();
+
     gpio_config_t io{};
     io.mode = GPIO_MODE_OUTPUT;
-    io.pin_bit_mask =
-        (1ULL << LF_IN1) | (1ULL << LF_IN2) |
-        (1ULL << LB_IN1) | (1ULL << LB_IN2) |
-        (1ULL << RF_IN1) | (1ULL << RF_IN2) |
-        (1ULL << RB_IN1) | (1ULL << RB_IN2) |
-        (1ULL << STBY);
+    io.pin_bit_mask = outputs;
 
     ESP_ERROR_CHECK(gpio_config(&io));
-    gpio_set_level(STBY, 1);
-    vTaskDelay(pdMS_TO_TICKS(100));
+    gpio_set_level(stby_pin, 1);
+
+    // The driver settles while the rest of the system boots; the control
+    // task holds commands back until then instead of init blocking
+    esp_timer_create_args_t settle{};
+    settle.callback = settle_cb;
+    settle.name = "motor_stby";
+    ESP_ERROR_CHECK(esp_timer_create(&settle, &settle_timer));
+    ESP_ERROR_CHECK(esp_timer_start_once(settle_timer, MOTOR_STBY_SETTLE_MS * 1000));
+
+    ledc_timer_bit_t res = resolution_for(cfg.pwm_freq_hz);
+    pwm_max_duty = (1u << res) - 1;
+    build_duty_lut(cfg.min_duty_pct, cfg.curve_pct);
 
     ledc_timer_config_t timer{};
     timer.speed_mode = PWM_MODE;
     timer.timer_num = PWM_TIMER;
-    timer.freq_hz = PWM_FREQ_HZ;
-    timer.duty_resolution = PWM_RES;
-    timer.clk_cfg = LEDC_AUTO_CLK;
+    timer.freq_hz = cfg.pwm_freq_hz;
+    timer.duty_resolution = res;
+    timer.clk_cfg = LEDC_USE_APB_CLK;
     ESP_ERROR_CHECK(ledc_timer_config(&timer));
 
-    const int pwm_gpios[4] = {LF_PWM, LB_PWM, RF_PWM, RB_PWM};
-    const ledc_channel_t chs[4] = {
-        LEDC_CHANNEL_0, LEDC_CHANNEL_1,
-        LEDC_CHANNEL_2, LEDC_CHANNEL_3
-    };
-
-    for (int i = 0; i < 4; i++) {
+    for (size_t i = 0; i < DRIVETRAIN_WHEELS; i++) {
         ledc_channel_config_t ch{};
-        ch.channel = chs[i];
-        ch.gpio_num = pwm_gpios[i];
+        ch.channel = pwm_channel(i);
+        ch.gpio_num = pwm_pins[i];
         ch.speed_mode = PWM_MODE;
         ch.timer_sel = PWM_TIMER;
         ch.duty = 0;
         ESP_ERROR_CHECK(ledc_channel_config(&ch));
     }
 
-    ESP_LOGI(TAG, "Motor driver initialized");
+    // Fade ISR service: ramps run in hardware with no per-step CPU work
+    ESP_ERROR_CHECK(ledc_fade_func_install(0));
+
+    motor_set_slew(cfg.accel_ms, cfg.decel_ms);
+    mixer_mode.store(cfg.mixer, std::memory_order_relaxed);
+    app_config_subscribe(on_config_change);
+
+    ESP_LOGI(TAG, "Motor driver initialized: %s, %u Hz, %d-bit duty, %s mixer",
+             drivetrain.name, (unsigned)cfg.pwm_freq_hz, (int)res,
+             drive_mixer_name((drive_mixer_mode_t)cfg.mixer));
 }
 
 /* =====================================================
  *              LOW LEVEL HELPERS
  * ===================================================== */
 
-#define DIR_PAIR(in1, in2, fwd) \
-    gpio_set_level(in1, fwd);   \
-    gpio_set_level(in2, !fwd)
-
-#define SET_DUTY(ch, val)             \
-    ledc_set_duty(PWM_MODE, ch, val); \
-    ledc_update_duty(PWM_MODE, ch)
+/*
+ * Direction pins go straight to the GPIO set/clear registers, so every
+ * wheel that flips in a tick changes in the same writes instead of two
+ * gpio_set_level() calls per wheel. Lows are written before highs:
+ * between the writes a flipping wheel sees IN1 = IN2 = low (TB6612
+ * stop), never both inputs high or a mix of old and new direction.
+ * With all pins in bank 0 that is exactly two writes.
+ */
+static inline void write_dir_pins(unsigned dirs, unsigned flips)
+{
+    const dir_masks_t *m = &dir_table[dirs];
+    const uint32_t *sel = wheel_pins[flips];
+
+    uint32_t clr0 = m->clr[0] & sel[0], clr1 = m->clr[1] & sel[1];
+    uint32_t set0 = m->set[0] & sel[0], set1 = m->set[1] & sel[1];
+
+    if (clr0)
+        REG_WRITE(GPIO_OUT_W1TC_REG, clr0);
+    if (clr1)
+        REG_WRITE(GPIO_OUT1_W1TC_REG, clr1);
+    if (set0)
+        REG_WRITE(GPIO_OUT_W1TS_REG, set0);
+    if (set1)
+        REG_WRITE(GPIO_OUT1_W1TS_REG, set1);
+}
 
-static inline void set_all_dirs(bool fwd)
+static void set_duty_slewed(size_t i, uint32_t duty)
 {
-    DIR_PAIR(LF_IN1, LF_IN2, fwd);
-    DIR_PAIR(LB_IN1, LB_IN2, fwd);
-    DIR_PAIR(RF_IN1, RF_IN2, fwd);
-    DIR_PAIR(RB_IN1, RB_IN2, fwd);
+    if (duty == issued_duty[i])
+        return;
+
+    ledc_channel_t ch = pwm_channel(i);
+    uint32_t cur = ledc_get_duty(PWM_MODE, ch);
+    bool rising = duty > cur;
+    uint32_t delta = rising ? duty - cur : cur - duty;
+    uint32_t full_ms = rising ? accel_ms.load(std::memory_order_relaxed)
+                              : decel_ms.load(std::memory_order_relaxed);
+    uint32_t ms = (uint32_t)((uint64_t)full_ms * delta / pwm_max_duty);
+
+    // A running fade holds the channel; retarget from the current duty
+    ledc_fade_stop(PWM_MODE, ch);
+
+    if (ms == 0)
+        ledc_set_duty_and_update(PWM_MODE, ch, duty, 0);
+    else
+        ledc_set_fade_time_and_start(PWM_MODE, ch, duty, ms, LEDC_FADE_NO_WAIT);
+
+    issued_duty[i] = duty;
 }
 
-static inline void set_all_pwm(int lf, int lb, int rf, int rb)
+// Hard stop: every channel to 0 at once, whatever fade is running
+static void cut_duty(void)
 {
-    SET_DUTY(LEDC_CHANNEL_0, lf);
-    SET_DUTY(LEDC_CHANNEL_1, lb);
-    SET_DUTY(LEDC_CHANNEL_2, rf);
-    SET_DUTY(LEDC_CHANNEL_3, rb);
+    for (size_t i = 0; i < DRIVETRAIN_WHEELS; i++) {
+        ledc_channel_t ch = pwm_channel(i);
+        ledc_fade_stop(PWM_MODE, ch);
+        ledc_set_duty_and_update(PWM_MODE, ch, 0, 0);
+        issued_duty[i] = 0;
+        output_q15[drivetrain.wheels[i].slot].store(0, std::memory_order_relaxed);
+    }
 }
 
 /* =====================================================
  *              CORE DRIVE MODEL
+ * =====================================================
+ *
+ * Each wheel slot gets a signed Q15 command, from the mixer or from
+ * set_wheels(); slots the chassis does not have are skipped. The
+ * magnitude goes through the duty table, so every wheel gets its own
+ * deadband and stall compensation; the sign picks the H-bridge
+ * direction.
+ *
+ * Returns false while part of the command is still pending, i.e. a
+ * wheel is decelerating before a direction change.
+ */
+static bool apply_wheels(const q15_t cmd[WHEEL_SLOTS])
+{
+    uint32_t duty[DRIVETRAIN_WHEELS];
+    unsigned dirs = 0, flips = 0;
+    bool pending = false;
+
+    for (size_t i = 0; i < DRIVETRAIN_WHEELS; i++) {
+        q15_t c = cmd[drivetrain.wheels[i].slot];
+        bool fwd = c >= 0;
+        duty[i] = duty_from_q15(abs(c));
+        if (duty[i] == 0 || wheel_dir[i] == (int)fwd)
+            continue;
+
+        // Never flip an H-bridge under load: ramp that wheel to zero first
+        if (wheel_dir[i] >= 0) {
+            set_duty_slewed(i, 0);
+            if (ledc_get_duty(PWM_MODE, pwm_channel(i)) != 0) {
+                duty[i] = 0;
+                pending = true;
+                continue;
+            }
+        }
+
+        dirs |= (unsigned)fwd << i;
+        flips |= 1u << i;
+        wheel_dir[i] = fwd;
+        EVLOG_D(EVT_MOTOR_REVERSE, drivetrain.wheels[i].slot, fwd);
+    }
+
+    if (flips)
+        write_dir_pins(dirs, flips);
+
+    int32_t signed_duty[WHEEL_SLOTS] = {0, 0, 0, 0};
+    for (size_t i = 0; i < DRIVETRAIN_WHEELS; i++) {
+        unsigned slot = drivetrain.wheels[i].slot;
+        set_duty_slewed(i, duty[i]);
+
+        int q = (int)((uint64_t)issued_duty[i] * Q15_ONE / pwm_max_duty);
+        output_q15[slot].store((int16_t)(wheel_dir[i] == 0 ? -q : q),
+                               std::memory_order_relaxed);
+        signed_duty[slot] = wheel_dir[i] == 0 ? -(int32_t)duty[i] : (int32_t)duty[i];
+    }
+
+    if (pending)
+        return false;
+
+    // Runs at the control rate: record the event, the drain task prints it
+    EVLOG_I(EVT_MOTOR_APPLY, signed_duty[0], signed_duty[1], signed_duty[2], signed_duty[3]);
+    return true;
+}
+
+/* =====================================================
+ *              CONTROL TASK
  * ===================================================== */
 
-static void apply_drive(void)
+// Only the control task raises the maximum; a concurrent reset may be
+// lost, which just carries the old maximum into the next window
+static inline void update_max(std::atomic<uint32_t> &max, uint32_t v)
 {
-    bool forward = speed_cmd >= 0;
-    int base = pwm_from_speed(speed_cmd);
-
-    int steer = steer_cmd;
-    if (steer > 10) steer = 10;
-    if (steer < -10) steer = -10;
+    if (v > max.load(std::memory_order_relaxed))
+        max.store(v, std::memory_order_relaxed);
+}
 
-    int diff = (abs(steer) * base) / 10;
+static void control_tick(void *arg)
+{
+    xTaskNotifyGive(control_task);
+}
 
-    int lf = base, lb = base, rf = base, rb = base;
+static bool wheels_moving(const q15_t w[4])
+{
+    return w[0] || w[1] || w[2] || w[3];
+}
 
-    if (steer < 0) {        // left
-        lf -= diff;
-        lb -= diff;
-    } else if (steer > 0) { // right
-        rf -= diff;
-        rb -= diff;
+static void control_task_fn(void *arg)
+{
+    q15_t applied[4] = {0, 0, 0, 0};
+
+    // Active ramp-down: the publish generation it started from and
+    // ticks remaining
+    uint32_t ramp_gen = 0;
+    uint32_t ramp_ticks = 0;
+    uint32_t ramp_left = 0;
+
+    int64_t last_wake = 0;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        int64_t wake = esp_timer_get_time();
+        if (last_wake)
+            update_max(loop_period_max_us, (uint32_t)(wake - last_wake));
+        last_wake = wake;
+
+        // Everything published since the last tick collapses into one update
+        uint32_t gen = publish_gen.load(std::memory_order_acquire);
+        command_t cmd = read_command();
+        q15_t target[4];
+        command_wheels(cmd, target);
+
+        // stop_motors() published zero before raising the flag, so a
+        // command that follows the stop is still applied, from a standstill
+        if (stop_request.exchange(false, std::memory_order_acquire)) {
+            cut_duty();
+            memset(applied, 0, sizeof(applied));
+            ramp_left = 0;
+        }
+
+        uint32_t ramp_ms = ramp_request_ms.exchange(0, std::memory_order_relaxed);
+        if (ramp_ms && wheels_moving(target)) {
+            ramp_gen = gen;
+            ramp_ticks = ramp_left = ramp_ms * control_rate_hz / 1000 + 1;
+        }
+
+        // Any command accepted since the ramp began takes over, even one
+        // repeating the value the ramp started from
+        if (ramp_left && gen != ramp_gen)
+            ramp_left = 0;
+
+        if (ramp_left) {
+            ramp_left--;
+            for (int i = 0; i < 4; i++)
+                target[i] = (q15_t)(target[i] * (int)ramp_left / (int)ramp_ticks);
+
+            // Park the mailbox at zero unless a new command raced the ramp
+            if (!ramp_left && publish_gen.load(std::memory_order_acquire) == ramp_gen)
+                park_command(cmd);
+        }
+
+        // Retried every tick until the driver is out of standby and a
+        // pending direction change completes
+        bool same = !memcmp(target, applied, sizeof(applied));
+        if (!same && driver_ready.load(std::memory_order_acquire) &&
+            apply_wheels(target)) {
+            memcpy(applied, target, sizeof(applied));
+            same = true;
+        }
+
+        // A command that did not change the setpoint is "applied" as well
+        if (same)
+            trace_applied();
+
+        update_max(loop_work_max_us, (uint32_t)(esp_timer_get_time() - wake));
+        loop_ticks.fetch_add(1, std::memory_order_relaxed);
     }
+}
 
-    set_all_dirs(forward);
-    set_all_pwm(lf, lb, rf, rb);
+void motor_control_start(uint32_t rate_hz)
+{
+    if (rate_hz == 0)
+        rate_hz = MOTOR_CONTROL_RATE_HZ;
+    control_rate_hz = rate_hz;
+
+    xTaskCreatePinnedToCore(control_task_fn, "motor_ctrl", CONTROL_TASK_STACK,
+                            NULL, CONTROL_TASK_PRIO, &control_task,
+                            CONTROL_TASK_CORE);
+
+    // FreeRTOS ticks are too coarse for 200 Hz; pace the task from esp_timer
+    esp_timer_create_args_t args{};
+    args.callback = control_tick;
+    args.name = "motor_tick";
+    ESP_ERROR_CHECK(esp_timer_create(&args, &control_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(control_timer, 1000000ULL / rate_hz));
+
+    ESP_LOGI(TAG, "Control task running at %u Hz", (unsigned)rate_hz);
+}
 
-    ESP_LOGI(TAG, "APPLY speed=%d steer=%d | L=%d R=%d",
-             speed_cmd, steer_cmd, lf, rf);
+void motor_take_loop_stats(motor_loop_stats_t *out)
+{
+    out->period_max_us = loop_period_max_us.exchange(0, std::memory_order_relaxed);
+    out->work_max_us = loop_work_max_us.exchange(0, std::memory_order_relaxed);
+    out->ticks = loop_ticks.exchange(0, std::memory_order_relaxed);
+}
+
+void motor_get_outputs(q15_t duty[4])
+{
+    for (int i = 0; i < 4; i++)
+        duty[i] = output_q15[i].load(std::memory_order_relaxed);
+}
+
+uint32_t motor_duty_for(q15_t mag, uint32_t *max_duty)
+{
+    if (max_duty)
+        *max_duty = pwm_max_duty;
+    return duty_from_q15(mag);
 }
 
 /* =====================================================
@@ -172,39 +684,91 @@ static void apply_drive(void)
 
 void set_speed(int speed)
 {
-    speed_cmd = speed;
-    apply_drive();
+    publish_speed(q15_from_cmd(speed));
 }
 
 void stop_motors(void)
 {
-    speed_cmd = 0;
-    steer_cmd = 0;
-    set_all_pwm(0, 0, 0, 0);
+    publish(0, 0);
+    stop_request.store(true, std::memory_order_release);
+}
+
+void motor_set_slew(uint32_t accel, uint32_t decel)
+{
+    accel_ms.store(accel, std::memory_order_relaxed);
+    decel_ms.store(decel, std::memory_order_relaxed);
+}
+
+void ramp_stop_motors(uint32_t ramp_ms)
+{
+    ramp_request_ms.store(ramp_ms ? ramp_ms : 1, std::memory_order_relaxed);
 }
 
 void forward(int speed)
 {
-    speed_cmd = speed;
-    apply_drive();
+    publish_speed(q15_from_cmd(speed));
 }
 
 void turn_left(int speed)
 {
-    speed_cmd = speed;
-    steer_cmd = -10;
-    apply_drive();
+    publish(q15_from_cmd(speed), -Q15_ONE);
 }
 
 void turn_right(int speed)
 {
-    speed_cmd = speed;
-    steer_cmd = 10;
-    apply_drive();
+    publish(q15_from_cmd(speed), Q15_ONE);
 }
 
 void set_steer(int steer)
 {
-    steer_cmd = steer;
-    apply_drive();
+    publish_steer(q15_from_cmd(steer));
+}
+
+bool set_drive(int speed, int steer, uint16_t seq, drive_seq_t *src)
+{
+    return set_drive_q15(q15_from_cmd(speed), q15_from_cmd(steer), seq, src);
+}
+
+bool set_drive_q15(q15_t speed, q15_t steer, uint16_t seq, drive_seq_t *src)
+{
+    // The source belongs to the calling task; only the mailbox is shared
+    if (src->valid && (int16_t)(seq - src->last) <= 0)
+        return false;   // stale or duplicate
+    src->last = seq;
+    src->valid = true;
+
+    publish(speed, steer);
+    return true;
+}
+
+void set_wheels(int lf, int lb, int rf, int rb)
+{
+    // Slots without a wheel read as stopped
+    constexpr unsigned fitted = drivetrain_slot_mask();
+    const q15_t w[WHEEL_SLOTS] = {
+        (fitted & (1u << WHEEL_LF)) ? q15_from_cmd(lf) : (q15_t)0,
+        (fitted & (1u << WHEEL_LB)) ? q15_from_cmd(lb) : (q15_t)0,
+        (fitted & (1u << WHEEL_RF)) ? q15_from_cmd(rf) : (q15_t)0,
+        (fitted & (1u << WHEEL_RB)) ? q15_from_cmd(rb) : (q15_t)0,
+    };
+    publish_wheels(w);
+}
+
+bool set_wheels_q15(q15_t lf, q15_t lb, q15_t rf, q15_t rb, uint16_t seq, drive_seq_t *src)
+{
+    if (src->valid && (int16_t)(seq - src->last) <= 0)
+        return false;   // stale or duplicate
+    src->last = seq;
+    src->valid = true;
+
+    constexpr unsigned fitted = drivetrain_slot_mask();
+    const q15_t w[WHEEL_SLOTS] = {
+        (fitted & (1u << WHEEL_LF)) ? lf : (q15_t)0,
+        (fitted & (1u << WHEEL_LB)) ? lb : (q15_t)0,
+        (fitted & (1u << WHEEL_RF)) ? rf : (q15_t)0,
+        (fitted & (1u << WHEEL_RB)) ? rb : (q15_t)0,
+    };
+    publish_wheels(w);
+    return true;
 }
+
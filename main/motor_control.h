@@ -1,14 +1,96 @@
 #pragma once
 
+#include <stdint.h>
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
  * @brief Initialize motor driver (GPIO, PWM timers, channels)
+ *
+ * Pins, PWM frequency and duty table come from app_config_get(), so
+ * app_config_init() must have run.
  */
 void motor_init(void);
 
+/**
+ * Q15 fixed point: -Q15_ONE .. +Q15_ONE is -100% .. +100%.
+ * The integer API below uses the legacy -10 .. +10 command range.
+ */
+typedef int16_t q15_t;
+#define Q15_ONE 32767
+
+/** Convert a -10 .. +10 command (fractions allowed) to Q15, clamped */
+static inline q15_t q15_from_cmd(double cmd)
+{
+    if (cmd > 10) cmd = 10;
+    if (cmd < -10) cmd = -10;
+    double q = cmd * (Q15_ONE / 10.0);
+    return (q15_t)(q < 0 ? q - 0.5 : q + 0.5);
+}
+
+/**
+ * Default PWM carrier frequency. The LEDC timer runs at the finest duty
+ * resolution this allows (12 bit at 10 kHz, 11 bit at 20 kHz).
+ */
+#define MOTOR_PWM_FREQ_HZ 10000
+
+/** TB6612 settle time after leaving standby, before the first drive */
+#define MOTOR_STBY_SETTLE_MS 100
+
+/** Default control loop rate */
+#define MOTOR_CONTROL_RATE_HZ 200
+
+/** Default slew profile: full-scale duty change time in ms */
+#define MOTOR_ACCEL_MS 400
+#define MOTOR_DECEL_MS 200
+
+/** Default duty table shape */
+#define MOTOR_MIN_DUTY_PCT 12       // TB6612 + TT gearmotor stall
+#define MOTOR_CURVE_PCT 30          // 0 = linear, 100 = cubic
+
+/**
+ * @brief Start the fixed-rate motor control task
+ *
+ * Speed/steer calls only publish a setpoint; the control task applies
+ * the latest one to GPIO/LEDC once per tick.
+ *
+ * @param rate_hz Control loop rate (0 = MOTOR_CONTROL_RATE_HZ)
+ */
+void motor_control_start(uint32_t rate_hz);
+
+typedef struct {
+    uint32_t period_max_us;     // longest interval between control ticks
+    uint32_t work_max_us;       // longest time spent inside one tick
+    uint32_t ticks;             // ticks run
+} motor_loop_stats_t;
+
+/**
+ * @brief Read and reset the control loop timing maxima and tick count
+ */
+void motor_take_loop_stats(motor_loop_stats_t *out);
+
+/**
+ * @brief Duty last issued to each wheel (LF, LB, RF, RB)
+ *
+ * Q15 of full-scale duty, negative while that wheel runs in reverse.
+ * This is the fade target; the LEDC output may still be ramping to it.
+ */
+void motor_get_outputs(q15_t duty[4]);
+
+/**
+ * @brief Duty the speed table gives for a Q15 magnitude
+ *
+ * Raw LEDC counts at the active resolution, before slewing. For
+ * diagnostics and the host tests.
+ *
+ * @param mag Speed magnitude in Q15 (negative counts as 0)
+ * @param max_duty If not NULL, receives the full-scale duty
+ */
+uint32_t motor_duty_for(q15_t mag, uint32_t *max_duty);
+
 /**
  * @brief Set motor speed (-10 to +10)
  * @param speed Speed command in range [-10, 10]
@@ -16,10 +98,35 @@ void motor_init(void);
 void set_speed(int speed);
 
 /**
- * @brief Stop all motors
+ * @brief Stop all motors at once
+ *
+ * An emergency stop: on the next control tick every duty drops to 0
+ * with no fade, whatever motor_set_slew() configured. WebSocket close,
+ * STA disconnect, "move:stop" and the binary STOP flag all come here.
+ * Use ramp_stop_motors() for a controlled slow-down.
  */
 void stop_motors(void);
 
+/**
+ * @brief Set the PWM slew profile
+ *
+ * Duty changes are executed by the LEDC fade engine. A step takes a
+ * share of the full-scale time proportional to its size; 0 makes that
+ * direction instantaneous.
+ *
+ * @param accel_ms Time for a 0 -> max duty change
+ * @param decel_ms Time for a max -> 0 duty change
+ */
+void motor_set_slew(uint32_t accel_ms, uint32_t decel_ms);
+
+/**
+ * @brief Ramp the current speed down to zero over ramp_ms
+ *
+ * Any speed/steer/drive/wheel command accepted during the ramp takes
+ * over, even one repeating the value the ramp started from.
+ */
+void ramp_stop_motors(uint32_t ramp_ms);
+
 /**
  * @brief Move forward at given speed
  * @param speed Speed command in range [0, 10]
@@ -44,6 +151,76 @@ void turn_right(int speed);
  */
 void set_steer(int steer);
 
+/**
+ * @brief Sequence state of one command source
+ *
+ * Each sender (a WebSocket session, a UDP peer) keeps its own, so senders
+ * never reject each other's frames. Zero-initialise it for a source that
+ * has not sent a drive command yet. Only the task serving the source may
+ * pass it in.
+ */
+typedef struct {
+    uint16_t last;      // last accepted sequence number
+    bool valid;         // false until the first accepted command
+} drive_seq_t;
+
+/**
+ * @brief Set speed and steering together as one setpoint
+ *
+ * Both axes are published atomically, so the control task never applies
+ * a mix of old speed and new steer. Commands whose sequence number is not
+ * newer than the last one accepted from the same source (16-bit serial
+ * arithmetic) are dropped.
+ *
+ * @param speed Speed command in range [-10, 10]
+ * @param steer Steering command in range [-10, 10]
+ * @param seq Sender sequence number
+ * @param src Sequence state of the sending source
+ * @return true if the command was accepted
+ */
+bool set_drive(int speed, int steer, uint16_t seq, drive_seq_t *src);
+
+/**
+ * @brief Q15 variant of set_drive() for analog inputs
+ * @param speed Speed in Q15
+ * @param steer Steering in Q15 (negative = left)
+ * @param seq Sender sequence number
+ * @param src Sequence state of the sending source
+ * @return true if the command was accepted
+ */
+bool set_drive_q15(q15_t speed, q15_t steer, uint16_t seq, drive_seq_t *src);
+
+/**
+ * @brief Drive each wheel directly, bypassing the speed/steer mixer
+ *
+ * Published as one setpoint like set_drive(); the next speed, steer or
+ * drive command hands control back to the mixer. Each wheel changes
+ * direction on its own, after its duty has ramped to zero.
+ *
+ * @param lf Left front command in range [-10, 10], negative = reverse
+ * @param lb Left back
+ * @param rf Right front
+ * @param rb Right back
+ */
+void set_wheels(int lf, int lb, int rf, int rb);
+
+/**
+ * @brief Q15 variant of set_wheels() for remote senders
+ *
+ * Drops commands whose sequence number is not newer than the last one
+ * accepted from src, sharing that sequence with set_drive(). Values
+ * reach the control task at full Q15 resolution.
+ *
+ * @param lf Left front in Q15, negative = reverse
+ * @param lb Left back
+ * @param rf Right front
+ * @param rb Right back
+ * @param seq Sender sequence number
+ * @param src Sequence state of the sending source
+ * @return true if the command was accepted
+ */
+bool set_wheels_q15(q15_t lf, q15_t lb, q15_t rf, q15_t rb, uint16_t seq, drive_seq_t *src);
+
 #ifdef __cplusplus
 }
 #endif
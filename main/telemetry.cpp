@@ -0,0 +1,163 @@
+#include "telemetry.h"
+#include "control_protocol.h"
+#include "motor_control.h"
+#include "latency_trace.h"
+#include "failsafe.h"
+#include "wifi_config.h"
+
+#include <atomic>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "lwip/sockets.h"
+
+static const char *TAG = "telemetry";
+
+/* =====================================================
+ *              TELEMETRY STATE
+ * =====================================================
+ *
+ * One frame buffer shared by all clients. The timer only refills it
+ * while no send is in flight, so the httpd task never sees a frame
+ * change underneath it.
+ */
+
+// Station RSSI is refreshed about once a second; it changes slowly
+#define RSSI_PERIOD_MS 1000
+
+static httpd_handle_t server = NULL;
+static esp_timer_handle_t tick_timer = NULL;
+static uint32_t rssi_every = 1;
+
+static uint8_t frame_buf[CTRL_TELEM_SIZE];
+static std::atomic<bool> sending{false};
+
+static uint16_t seq = 0;
+static int8_t rssi = 0;
+static telemetry_stats_t stats;
+
+static uint16_t sat_u16(uint32_t v)
+{
+    return v > 0xffff ? 0xffff : (uint16_t)v;
+}
+
+static void snapshot(ctrl_telemetry_t *t)
+{
+    t->seq = seq++;
+    t->t_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    motor_get_outputs(t->duty);
+
+    trace_summary_t s;
+    trace_get_summary(TRACE_TOTAL, &s);
+    t->lat_us = sat_u16(trace_last_us(TRACE_TOTAL));
+    t->lat_p99_us = sat_u16(s.p99_us);
+
+    t->heap_free = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_8BIT);
+
+    if (stats.ticks % rssi_every == 0)
+        rssi = wifi_get_sta_rssi();
+    t->rssi = rssi;
+
+    failsafe_stats_t fs;
+    failsafe_get_stats(&fs);
+    t->flags = fs.tripped ? CTRL_TELEM_FLAG_FAILSAFE : 0;
+
+    motor_loop_stats_t ls;
+    motor_take_loop_stats(&ls);
+    t->loop_max_us = sat_u16(ls.period_max_us);
+    t->work_max_us = sat_u16(ls.work_max_us);
+}
+
+/* =====================================================
+ *              BROADCAST
+ * ===================================================== */
+
+// Zero-timeout select: a full send buffer means the client is not reading
+// fast enough, and a blocking send would stall every other session
+static bool writable(int fd)
+{
+    fd_set wr;
+    FD_ZERO(&wr);
+    FD_SET(fd, &wr);
+    struct timeval tv = {0, 0};
+    return select(fd + 1, NULL, &wr, NULL, &tv) > 0 && FD_ISSET(fd, &wr);
+}
+
+// Runs on the httpd task, which owns the sessions
+static void broadcast(void *arg)
+{
+    size_t n = TELEMETRY_MAX_CLIENTS;
+    int fds[TELEMETRY_MAX_CLIENTS];
+
+    if (httpd_get_client_list(server, &n, fds) == ESP_OK) {
+        httpd_ws_frame_t out{};
+        out.type = HTTPD_WS_TYPE_BINARY;
+        out.payload = frame_buf;
+        out.len = sizeof(frame_buf);
+
+        for (size_t i = 0; i < n; i++) {
+            if (httpd_ws_get_fd_info(server, fds[i]) != HTTPD_WS_CLIENT_WEBSOCKET)
+                continue;
+            // Telemetry is a snapshot; a late frame is worth less than none
+            if (!writable(fds[i])) {
+                stats.dropped++;
+                continue;
+            }
+            if (httpd_ws_send_frame_async(server, fds[i], &out) == ESP_OK)
+                stats.frames++;
+            else
+                stats.send_errors++;
+        }
+    }
+
+    sending.store(false, std::memory_order_release);
+}
+
+static void tick(void *arg)
+{
+    // The httpd task is busy with other work; skip rather than queue up
+    if (sending.load(std::memory_order_acquire)) {
+        stats.skipped++;
+        return;
+    }
+
+    ctrl_telemetry_t t;
+    snapshot(&t);
+    stats.ticks++;
+    ctrl_encode_telemetry(&t, frame_buf);
+
+    sending.store(true, std::memory_order_relaxed);
+    if (httpd_queue_work(server, broadcast, NULL) != ESP_OK) {
+        sending.store(false, std::memory_order_relaxed);
+        stats.send_errors++;
+    }
+}
+
+/* =====================================================
+ *              TELEMETRY API
+ * ===================================================== */
+
+void telemetry_start(httpd_handle_t hd, uint32_t rate_hz)
+{
+    if (rate_hz == 0)
+        rate_hz = TELEMETRY_RATE_HZ;
+    server = hd;
+    rssi_every = rate_hz * RSSI_PERIOD_MS / 1000;
+    if (rssi_every == 0)
+        rssi_every = 1;
+
+    esp_timer_create_args_t args{};
+    args.callback = tick;
+    args.name = "telemetry";
+    ESP_ERROR_CHECK(esp_timer_create(&args, &tick_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(tick_timer, 1000000ULL / rate_hz));
+
+    ESP_LOGI(TAG, "Telemetry at %u Hz", (unsigned)rate_hz);
+}
+
+void telemetry_get_stats(telemetry_stats_t *out)
+{
+    *out = stats;
+}
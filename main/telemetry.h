@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Default telemetry push rate */
+#define TELEMETRY_RATE_HZ 10
+
+/** Upper bound on sessions scanned per tick (>= httpd max_open_sockets) */
+#define TELEMETRY_MAX_CLIENTS 8
+
+typedef struct {
+    uint32_t ticks;         // snapshots taken
+    uint32_t frames;        // frames handed to the server, summed over clients
+    uint32_t send_errors;   // frames the server refused
+    uint32_t skipped;       // ticks dropped because the previous one was still sending
+    uint32_t dropped;       // frames not sent because the client's socket buffer was full
+} telemetry_stats_t;
+
+/**
+ * @brief Push telemetry frames to every WebSocket client of server
+ *
+ * A timer snapshots the drive state once per tick and encodes a single
+ * CTRL_TELEM_SIZE frame; the httpd task then sends it to each open
+ * WebSocket session. Nothing runs on the control task. A session whose
+ * send buffer is full misses the frame (counted as dropped) instead of
+ * blocking the httpd task for everyone else.
+ *
+ * @param server Running HTTP server
+ * @param rate_hz Push rate (0 = TELEMETRY_RATE_HZ)
+ */
+void telemetry_start(httpd_handle_t server, uint32_t rate_hz);
+
+/**
+ * @brief Snapshot telemetry counters
+ */
+void telemetry_get_stats(telemetry_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,127 @@
+#include "udp_control.h"
+#include "control_protocol.h"
+#include "motor_control.h"
+#include "latency_trace.h"
+#include "event_log.h"
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+
+static const char *TAG = "udp_control";
+
+/* =====================================================
+ *              UDP TASK CONFIG
+ * ===================================================== */
+
+#define UDP_TASK_STACK 3072
+#define UDP_TASK_PRIO 6     // above httpd (5), below the control task
+
+static int sock = -1;
+static udp_control_stats_t stats;
+
+/* =====================================================
+ *              RECEIVE LOOP
+ * =====================================================
+ *
+ * No retransmission and no ordering: every datagram carries a full
+ * setpoint and a sequence number, so a lost one is simply superseded
+ * and a late one is rejected by its sequence number.
+ */
+
+static void udp_task_fn(void *arg)
+{
+    struct sockaddr_in peer{};
+    drive_seq_t peer_seq{};
+    bool held = false;      // peer holds the link
+    int64_t last_rx_us = 0;
+    uint8_t buf[CTRL_FRAME_MAX + 1];    // one spare byte to detect oversize
+
+    for (;;) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        int len = recvfrom(sock, buf, sizeof(buf), 0,
+                           (struct sockaddr *)&from, &from_len);
+        if (len < 0)
+            continue;
+
+        uint32_t t_recv = trace_now();
+        stats.packets++;
+
+        ctrl_frame_t cf;
+        if (!ctrl_decode_binary(buf, (size_t)len, &cf)) {
+            stats.bad++;
+            continue;
+        }
+
+        // One sender holds the link at a time. Another is ignored until
+        // the holder has been silent for UDP_SESSION_IDLE_MS: two
+        // controllers would otherwise both steer, and each would reset
+        // the other's sequence on every datagram
+        int64_t now_us = esp_timer_get_time();
+        bool same = from.sin_addr.s_addr == peer.sin_addr.s_addr &&
+                    from.sin_port == peer.sin_port;
+        bool idle = !held || now_us - last_rx_us > (int64_t)UDP_SESSION_IDLE_MS * 1000;
+        if (!same && !idle) {
+            stats.busy++;
+            continue;
+        }
+        if (!same || idle) {
+            peer = from;
+            peer_seq = drive_seq_t{};
+            held = true;
+            stats.sessions++;
+            EVLOG_I(EVT_UDP_SESSION, ntohs(from.sin_port));
+        }
+        last_rx_us = now_us;
+
+        uint32_t t_parse = trace_now();
+        if (ctrl_dispatch_frame(&cf, &peer_seq)) {
+            stats.accepted++;
+            trace_command(t_recv, t_parse, cf.seq);
+        } else if (!(cf.flags & CTRL_FLAG_HEARTBEAT)) {
+            stats.stale++;
+        }
+    }
+}
+
+/* =====================================================
+ *              UDP CONTROL API
+ * ===================================================== */
+
+void udp_control_start(uint16_t port)
+{
+    if (port == 0)
+        port = UDP_CONTROL_PORT;
+
+    sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "socket() failed");
+        return;
+    }
+
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "bind to port %u failed", (unsigned)port);
+        close(sock);
+        sock = -1;
+        return;
+    }
+
+    xTaskCreate(udp_task_fn, "udp_ctrl", UDP_TASK_STACK, NULL,
+                UDP_TASK_PRIO, NULL);
+
+    ESP_LOGI(TAG, "UDP control on port %u", (unsigned)port);
+}
+
+void udp_control_get_stats(udp_control_stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * UDP control port. Each datagram is one binary control frame
+ * (CTRL_FRAME_SIZE bytes, see control_protocol.h); there is no
+ * handshake and no reply.
+ */
+#define UDP_CONTROL_PORT 4210
+
+/**
+ * A sender holds the link until it has been silent this long; it then
+ * starts a new drive sequence when it returns, and another may take over
+ */
+#define UDP_SESSION_IDLE_MS 1000
+
+typedef struct {
+    uint32_t packets;       // datagrams received
+    uint32_t accepted;      // frames that changed the setpoint
+    uint32_t stale;         // drive frames dropped by sequence number
+    uint32_t bad;           // wrong size or unsupported version
+    uint32_t sessions;      // sequence resets (new sender or idle gap)
+    uint32_t busy;          // frames ignored from a sender other than the link holder
+} udp_control_stats_t;
+
+/**
+ * @brief Start the UDP control task
+ *
+ * Frames feed the same setpoint mailbox and failsafe as the WebSocket
+ * path, so a controller may use either transport. Lost datagrams are
+ * not retransmitted: the next frame carries a newer setpoint anyway.
+ *
+ * @param port UDP port to listen on (0 = UDP_CONTROL_PORT)
+ */
+void udp_control_start(uint16_t port);
+
+/**
+ * @brief Snapshot receive counters
+ */
+void udp_control_get_stats(udp_control_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
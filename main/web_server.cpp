@@ -1,8 +1,24 @@
 #include "web_server.h"
 #include "motor_control.h"
+#include "control_protocol.h"
+#include "latency_trace.h"
+#include "asset_cache.h"
+#include "failsafe.h"
+#include "json_arena.h"
+#include "event_log.h"
+#include "telemetry.h"
+#include "udp_control.h"
+#include "wifi_config.h"
+#include "app_config.h"
+#include "boot.h"
+
+#include <stdlib.h>
+#include <strings.h>
 
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include "esp_http_server.h"
+#include "esp_random.h"
 
 extern "C" {
 #include "cJSON.h"
@@ -14,37 +30,719 @@ static const char *TAG = "web_server";
  *              FILE SERVER
  * ===================================================== */
 
-static esp_err_t static_file_handler(httpd_req_t *req)
+#ifndef WEB_ROOT
+#define WEB_ROOT "/littlefs"
+#endif
+
+#if WEB_UI_EMBEDDED
+// data/index.html, gzipped at build time and linked into the app image
+extern const uint8_t index_html_gz_start[] asm("_binary_index_html_gz_start");
+extern const uint8_t index_html_gz_end[] asm("_binary_index_html_gz_end");
+#endif
+
+typedef struct {
+    const char *ext;
+    const char *mime;
+    const char *cache_control;
+} mime_entry_t;
+
+// HTML is always revalidated (cheap 304); other assets may be reused
+static const mime_entry_t mime_table[] = {
+    {".html", "text/html; charset=utf-8", "no-cache"},
+    {".htm", "text/html; charset=utf-8", "no-cache"},
+    {".css", "text/css", "public, max-age=86400"},
+    {".js", "application/javascript", "public, max-age=86400"},
+    {".json", "application/json", "no-cache"},
+    {".svg", "image/svg+xml", "public, max-age=86400"},
+    {".png", "image/png", "public, max-age=86400"},
+    {".jpg", "image/jpeg", "public, max-age=86400"},
+    {".ico", "image/x-icon", "public, max-age=86400"},
+};
+
+static const mime_entry_t mime_default = {
+    "", "application/octet-stream", "no-cache"
+};
+
+static const mime_entry_t *mime_for(const char *path)
+{
+    const char *dot = strrchr(path, '.');
+    if (dot) {
+        for (const auto &m : mime_table) {
+            if (!strcasecmp(dot, m.ext))
+                return &m;
+        }
+    }
+    return &mime_default;
+}
+
+static bool accepts_encoding(const char *header, const char *enc)
+{
+    size_t n = strlen(enc);
+    for (const char *p = header; (p = strstr(p, enc)) != NULL; p += n) {
+        bool start = p == header || p[-1] == ',' || p[-1] == ' ';
+        bool end = p[n] == 0 || p[n] == ',' || p[n] == ';' || p[n] == ' ';
+        if (start && end)
+            return true;
+    }
+    return false;
+}
+
+// Assets the cache does not hold (over budget, long path) are streamed
+// from flash
+static esp_err_t stream_file(httpd_req_t *req, const char *path)
 {
-    char path[256];
-    strcpy(path, "/littlefs");
-    strncat(path,
-            strcmp(req->uri, "/") == 0 ? "/index.html" : req->uri,
-            sizeof(path) - strlen(path) - 1);
+    char full[128];
+    snprintf(full, sizeof(full), WEB_ROOT "%s", path);
 
-    FILE *f = fopen(path, "r");
+    FILE *f = fopen(full, "r");
     if (!f)
         return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
 
-    httpd_resp_set_type(req, "text/html");
     char buf[512];
     size_t r;
     while ((r = fread(buf, 1, sizeof(buf), f)) > 0)
         httpd_resp_send_chunk(req, buf, r);
 
     fclose(f);
-    httpd_resp_send_chunk(req, NULL, 0);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// Best pre-compressed variant the client accepts that lookup can find;
+// leaves its name in path and returns the encoding, or NULL
+static const char *pick_encoding(char *path, size_t uri_len, const char *accept,
+                                 asset_result_t (*lookup)(const char *, asset_t *),
+                                 asset_t *asset, asset_result_t *res)
+{
+    static const char *const encodings[][2] = {{"br", ".br"}, {"gzip", ".gz"}};
+    for (const auto &enc : encodings) {
+        if (!accepts_encoding(accept, enc[0]))
+            continue;
+        strcpy(path + uri_len, enc[1]);
+        *res = lookup(path, asset);
+        if (*res != ASSET_NOT_FOUND)
+            return enc[0];
+    }
+    return NULL;
+}
+
+static esp_err_t static_file_handler(httpd_req_t *req)
+{
+    char path[ASSET_PATH_MAX];
+    const char *uri = strcmp(req->uri, "/") == 0 ? "/index.html" : req->uri;
+    size_t uri_len = strcspn(uri, "?#");
+    if (uri_len + 4 > sizeof(path) || strstr(uri, ".."))
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+    snprintf(path, sizeof(path), "%.*s", (int)uri_len, uri);
+
+    const mime_entry_t *mime = mime_for(path);
+
+    // Pick the best pre-compressed variant the client accepts
+    char accept[64] = "";
+    httpd_req_get_hdr_value_str(req, "Accept-Encoding", accept, sizeof(accept));
+
+    asset_result_t res = ASSET_NOT_FOUND;
+    asset_t asset;
+
+    // Variants linked into the firmware win, so serving them never probes
+    // the filesystem. Anything else is a 404 until the background mount
+    // is done
+    const char *encoding = pick_encoding(path, uri_len, accept, asset_cache_get_static, &asset, &res);
+    if (!encoding)
+        encoding = pick_encoding(path, uri_len, accept, asset_cache_get, &asset, &res);
+    if (!encoding) {
+        path[uri_len] = 0;
+        res = asset_cache_get(path, &asset);
+    }
+
+    if (res == ASSET_NOT_FOUND)
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+
+    httpd_resp_set_type(req, mime->mime);
+    httpd_resp_set_hdr(req, "Cache-Control", mime->cache_control);
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    if (encoding)
+        httpd_resp_set_hdr(req, "Content-Encoding", encoding);
+
+    if (res == ASSET_TOO_LARGE || res == ASSET_UNCACHED)
+        return stream_file(req, path);
+
+    httpd_resp_set_hdr(req, "ETag", asset.etag);
+
+    char inm[64] = "";
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", inm, sizeof(inm)) == ESP_OK &&
+        strstr(inm, asset.etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    return httpd_resp_send(req, (const char *)asset.data, asset.size);
+}
+
+/* =====================================================
+ *              METRICS
+ * ===================================================== */
+
+static esp_err_t metrics_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    httpd_resp_sendstr_chunk(req,
+        "# HELP rc_cmd_latency_us Control command latency per pipeline stage\n"
+        "# TYPE rc_cmd_latency_us summary\n");
+
+    char line[160];
+    for (int i = 0; i < TRACE_STAGE_COUNT; i++) {
+        trace_summary_t s;
+        trace_get_summary((trace_stage_t)i, &s);
+        const char *name = trace_stage_name((trace_stage_t)i);
+
+        const struct { const char *q; uint32_t v; } qs[] = {
+            {"0.5", s.p50_us}, {"0.9", s.p90_us},
+            {"0.99", s.p99_us}, {"0.999", s.p999_us},
+        };
+        for (const auto &q : qs) {
+            snprintf(line, sizeof(line),
+                     "rc_cmd_latency_us{stage=\"%s\",quantile=\"%s\"} %u\n",
+                     name, q.q, (unsigned)q.v);
+            httpd_resp_sendstr_chunk(req, line);
+        }
+        snprintf(line, sizeof(line),
+                 "rc_cmd_latency_us_max{stage=\"%s\"} %u\n"
+                 "rc_cmd_latency_us_count{stage=\"%s\"} %u\n",
+                 name, (unsigned)s.max_us, name, (unsigned)s.count);
+        httpd_resp_sendstr_chunk(req, line);
+    }
+
+    failsafe_stats_t fs;
+    failsafe_get_stats(&fs);
+    snprintf(line, sizeof(line),
+             "rc_failsafe_trips %u\n"
+             "rc_failsafe_last_gap_ms %u\n"
+             "rc_failsafe_tripped %d\n",
+             (unsigned)fs.trips, (unsigned)fs.last_gap_ms, fs.tripped ? 1 : 0);
+    httpd_resp_sendstr_chunk(req, line);
+
+    asset_cache_stats_t cs;
+    asset_cache_get_stats(&cs);
+    snprintf(line, sizeof(line),
+             "rc_asset_cache_hits %u\n"
+             "rc_asset_cache_misses %u\n"
+             "rc_asset_cache_evictions %u\n"
+             "rc_asset_cache_bytes %u\n"
+             "rc_asset_static_hits %u\n",
+             (unsigned)cs.hits, (unsigned)cs.misses,
+             (unsigned)cs.evictions, (unsigned)cs.bytes, (unsigned)cs.static_hits);
+    httpd_resp_sendstr_chunk(req, line);
+
+    snprintf(line, sizeof(line),
+             "rc_asset_fs_mounted %d\n"
+             "rc_asset_fs_mount_ms %u\n"
+             "rc_asset_fs_deferred %u\n",
+             cs.fs_mounted ? 1 : 0, (unsigned)(cs.mount_us / 1000),
+             (unsigned)cs.fs_deferred);
+    httpd_resp_sendstr_chunk(req, line);
+
+    json_arena_stats_t js;
+    json_arena_get_stats(&js);
+    snprintf(line, sizeof(line),
+             "rc_json_frames %u\n"
+             "rc_json_arena_allocs %u\n"
+             "rc_json_heap_fallbacks %u\n"
+             "rc_json_arena_exhausted %u\n",
+             (unsigned)js.frames, (unsigned)js.allocs,
+             (unsigned)js.fallbacks, (unsigned)js.exhausted);
+    httpd_resp_sendstr_chunk(req, line);
+    snprintf(line, sizeof(line),
+             "rc_json_arena_peak_bytes %u\n",
+             (unsigned)js.peak_bytes);
+    httpd_resp_sendstr_chunk(req, line);
+
+    ws_rx_stats_t rs;
+    ws_get_rx_stats(&rs);
+    snprintf(line, sizeof(line),
+             "rc_ws_rx_rejected{reason=\"oversized\"} %u\n"
+             "rc_ws_rx_rejected{reason=\"truncated\"} %u\n"
+             "rc_ws_rx_rejected{reason=\"bad_binary\"} %u\n",
+             (unsigned)rs.oversized, (unsigned)rs.truncated,
+             (unsigned)rs.bad_binary);
+    httpd_resp_sendstr_chunk(req, line);
+    snprintf(line, sizeof(line),
+             "rc_ws_rx_rejected{reason=\"fragmented\"} %u\n"
+             "rc_ws_rx_rejected{reason=\"binary_in_json\"} %u\n"
+             "rc_ws_rx_rejected{reason=\"bad_decode\"} %u\n",
+             (unsigned)rs.fragmented, (unsigned)rs.binary_in_json,
+             (unsigned)rs.bad_decode);
+    httpd_resp_sendstr_chunk(req, line);
+
+    telemetry_stats_t ts;
+    telemetry_get_stats(&ts);
+    snprintf(line, sizeof(line),
+             "rc_telemetry_ticks %u\n"
+             "rc_telemetry_frames %u\n"
+             "rc_telemetry_send_errors %u\n"
+             "rc_telemetry_skipped %u\n",
+             (unsigned)ts.ticks, (unsigned)ts.frames,
+             (unsigned)ts.send_errors, (unsigned)ts.skipped);
+    httpd_resp_sendstr_chunk(req, line);
+    snprintf(line, sizeof(line), "rc_telemetry_dropped %u\n", (unsigned)ts.dropped);
+    httpd_resp_sendstr_chunk(req, line);
+
+    udp_control_stats_t us;
+    udp_control_get_stats(&us);
+    snprintf(line, sizeof(line),
+             "rc_udp_packets %u\n"
+             "rc_udp_accepted %u\n"
+             "rc_udp_stale %u\n"
+             "rc_udp_bad %u\n"
+             "rc_udp_sessions %u\n",
+             (unsigned)us.packets, (unsigned)us.accepted, (unsigned)us.stale,
+             (unsigned)us.bad, (unsigned)us.sessions);
+    httpd_resp_sendstr_chunk(req, line);
+    snprintf(line, sizeof(line), "rc_udp_busy %u\n", (unsigned)us.busy);
+    httpd_resp_sendstr_chunk(req, line);
+
+    wifi_status_t ws;
+    wifi_get_status(&ws);
+    snprintf(line, sizeof(line),
+             "rc_wifi_profile{name=\"%s\"} 1\n"
+             "rc_wifi_channel %u\n"
+             "rc_wifi_scan_aps %u\n"
+             "rc_wifi_scan_ms %u\n",
+             wifi_profile_name(ws.profile.mode), (unsigned)ws.channel,
+             (unsigned)ws.scan_aps, (unsigned)ws.scan_ms);
+    httpd_resp_sendstr_chunk(req, line);
+    snprintf(line, sizeof(line),
+             "rc_wifi_beacon_interval_tu %u\n"
+             "rc_wifi_dtim_period %u\n"
+             "rc_wifi_power_save %d\n"
+             "rc_wifi_max_tx_power_qdbm %d\n",
+             (unsigned)ws.profile.beacon_interval, (unsigned)ws.profile.dtim_period,
+             ws.profile.power_save ? 1 : 0, ws.profile.max_tx_power);
+    httpd_resp_sendstr_chunk(req, line);
+    snprintf(line, sizeof(line),
+             "rc_wifi_ampdu_tx %d\n"
+             "rc_wifi_ampdu_rx %d\n"
+             "rc_wifi_bandwidth_mhz %u\n",
+             ws.profile.ampdu_tx ? 1 : 0, ws.profile.ampdu_rx ? 1 : 0,
+             (unsigned)ws.profile.bandwidth_mhz);
+    httpd_resp_sendstr_chunk(req, line);
+
+    app_config_t cfg;
+    app_config_get(&cfg);
+    app_config_stats_t gs;
+    app_config_get_stats(&gs);
+    snprintf(line, sizeof(line),
+             "rc_config_version %u\n"
+             "rc_config_updates %u\n"
+             "rc_config_rejected %u\n"
+             "rc_config_nvs_errors %u\n",
+             (unsigned)cfg.version, (unsigned)gs.updates,
+             (unsigned)gs.rejected, (unsigned)gs.nvs_errors);
+    httpd_resp_sendstr_chunk(req, line);
+
+    boot_stage_time_t bt;
+    for (size_t i = 0; boot_get_stage_time(i, &bt); i++) {
+        snprintf(line, sizeof(line),
+                 "rc_boot_stage_start_ms{stage=\"%s\"} %u\n"
+                 "rc_boot_stage_ms{stage=\"%s\"} %u\n",
+                 bt.name, (unsigned)(bt.start_us / 1000),
+                 bt.name, (unsigned)((bt.end_us - bt.start_us) / 1000));
+        httpd_resp_sendstr_chunk(req, line);
+    }
+    snprintf(line, sizeof(line),
+             "rc_boot_ready_ms %u\n"
+             "rc_boot_first_command_ms %u\n",
+             (unsigned)(boot_ready_us() / 1000),
+             (unsigned)(boot_first_command_us() / 1000));
+    httpd_resp_sendstr_chunk(req, line);
+
+    event_log_stats_t es;
+    event_log_get_stats(&es);
+    snprintf(line, sizeof(line),
+             "rc_event_log_written %u\n"
+             "rc_event_log_dropped %u\n",
+             (unsigned)es.written, (unsigned)es.dropped);
+    httpd_resp_sendstr_chunk(req, line);
+
+    // Free heap and largest free block; their ratio tracks fragmentation
+    snprintf(line, sizeof(line),
+             "rc_heap_free_bytes %u\n"
+             "rc_heap_largest_free_block %u\n"
+             "rc_heap_min_free_bytes %u\n",
+             (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+             (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+             (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+    httpd_resp_sendstr_chunk(req, line);
+
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/* =====================================================
+ *              CONFIGURATION
+ * ===================================================== */
+
+// {"ok":..,"reboot":..,"error":..,"config":{..}}; error only on failure
+static esp_err_t send_config_result(httpd_req_t *req, esp_err_t result,
+                                    const char *error, bool reboot)
+{
+    static char buf[APP_CONFIG_JSON_MAX + 160];   // httpd task only
+
+    int n = snprintf(buf, sizeof(buf), "{\"ok\":%s,\"reboot\":%s,",
+                     result == ESP_OK ? "true" : "false", reboot ? "true" : "false");
+    if (result != ESP_OK)
+        n += snprintf(buf + n, sizeof(buf) - n, "\"error\":\"%s\",", error);
+    n += snprintf(buf + n, sizeof(buf) - n, "\"config\":");
+
+    app_config_t cfg;
+    app_config_get(&cfg);
+    n += app_config_to_json(&cfg, buf + n, sizeof(buf) - n - 1);
+    if (n > (int)sizeof(buf) - 2)
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Config too large");
+    buf[n++] = '}';
+
+    if (result == ESP_ERR_INVALID_VERSION)
+        httpd_resp_set_status(req, "409 Conflict");
+    else if (result == ESP_ERR_INVALID_STATE)
+        httpd_resp_set_status(req, "423 Locked");
+    else if (result == ESP_ERR_INVALID_ARG)
+        httpd_resp_set_status(req, "400 Bad Request");
+    else if (result != ESP_OK)
+        httpd_resp_set_status(req, "500 Internal Server Error");
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, buf, n);
+}
+
+static esp_err_t config_get_handler(httpd_req_t *req)
+{
+    return send_config_result(req, ESP_OK, NULL, false);
+}
+
+// Token for POST /config while the AP is open, made at server start and
+// only ever shown on the console. With a password set, it is the token
+static char open_ap_token[17];
+
+// Compares the whole expected length whatever got holds, so timing does
+// not tell how much of a guess was right. got must be as large as want
+static bool token_matches(const char *got, const char *want)
+{
+    size_t n = strlen(want);
+    uint8_t diff = strlen(got) != n;
+    for (size_t i = 0; i < n; i++)
+        diff |= (uint8_t)(got[i] ^ want[i]);
+    return !diff;
+}
+
+// Partial update: only the members present change. Send the last seen
+// "version" along to make the update conditional. Anyone who joins the
+// AP can reach this, so writes need the X-Config-Token header, and are
+// refused while a controller is driving
+static esp_err_t config_post_handler(httpd_req_t *req)
+{
+    static char body[APP_CONFIG_JSON_MAX];
+
+    if (req->content_len >= sizeof(body))
+        return httpd_resp_send_err(req, HTTPD_413_CONTENT_TOO_LARGE, "Config too large");
+
+    size_t got = 0;
+    while (got < req->content_len) {
+        int r = httpd_req_recv(req, body + got, req->content_len - got);
+        if (r == HTTPD_SOCK_ERR_TIMEOUT)
+            continue;
+        if (r <= 0)
+            return ESP_FAIL;
+        got += r;
+    }
+
+    char token[sizeof(app_config_t::password)] = "";
+    if (httpd_req_get_hdr_value_str(req, "X-Config-Token", token, sizeof(token)) != ESP_OK)
+        token[0] = 0;
+    app_config_t cfg;
+    app_config_get(&cfg);
+    if (!token_matches(token, cfg.password[0] ? cfg.password : open_ap_token)) {
+        httpd_resp_set_status(req, "403 Forbidden");
+        httpd_resp_set_type(req, "application/json");
+        return httpd_resp_sendstr(req, "{\"ok\":false,\"error\":\"missing or wrong X-Config-Token\"}");
+    }
+    if (failsafe_armed())
+        return send_config_result(req, ESP_ERR_INVALID_STATE, "drive session active", false);
+
+    char error[64] = "";
+    bool reboot = false;
+    esp_err_t err = app_config_update_json(body, got, error, sizeof(error), &reboot);
+    return send_config_result(req, err, error, reboot);
+}
+
+/* =====================================================
+ *              EVENT LOG
+ * ===================================================== */
+
+// Recent events, oldest first, one "<seq> <line>" per line. ?from=N
+// skips events before sequence number N for incremental polling
+static esp_err_t log_handler(httpd_req_t *req)
+{
+    uint32_t end = event_log_head();
+    uint32_t seq = end > EVENT_LOG_ENTRIES ? end - EVENT_LOG_ENTRIES : 0;
+
+    char query[32], val[12];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "from", val, sizeof(val)) == ESP_OK) {
+        uint32_t from = (uint32_t)strtoul(val, NULL, 10);
+        if (from > seq)
+            seq = from < end ? from : end;
+    }
+
+    httpd_resp_set_type(req, "text/plain");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+    char line[160];
+    for (; seq != end; seq++) {
+        evlog_event_t e;
+        if (!event_log_read(seq, &e))
+            continue;
+        int n = snprintf(line, sizeof(line), "%u ", (unsigned)seq);
+        n += event_log_format(&e, line + n, sizeof(line) - n - 1);
+        if (n > (int)sizeof(line) - 2)
+            n = sizeof(line) - 2;
+        line[n++] = '\n';
+        line[n] = 0;
+        if (httpd_resp_send_chunk(req, line, n) != ESP_OK)
+            return ESP_FAIL;
+    }
+
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static void format_latency_json(char *buf, size_t len)
+{
+    int n = snprintf(buf, len, "{\"cmd\":\"metrics\",\"latency\":{");
+    for (int i = 0; i < TRACE_STAGE_COUNT && n < (int)len; i++) {
+        trace_summary_t s;
+        trace_get_summary((trace_stage_t)i, &s);
+        n += snprintf(buf + n, len - n,
+                      "%s\"%s\":{\"n\":%u,\"p50\":%u,\"p99\":%u,\"max\":%u}",
+                      i ? "," : "", trace_stage_name((trace_stage_t)i),
+                      (unsigned)s.count, (unsigned)s.p50_us,
+                      (unsigned)s.p99_us, (unsigned)s.max_us);
+    }
+    if (n < (int)len)
+        snprintf(buf + n, len - n, "}}");
+}
+
+/* =====================================================
+ *              WEBSOCKET SESSION STATE
+ * ===================================================== */
+
+enum ws_proto_t : uint8_t {
+    WS_PROTO_JSON = 0,
+    WS_PROTO_BINARY,
+};
+
+// Allocated once per connection; frames are received into rx. Each
+// connection checks drive sequence numbers against its own last one
+typedef struct {
+    ws_proto_t proto;
+    drive_seq_t seq;
+    uint8_t rx[WS_MAX_FRAME_LEN + 1];
+} ws_session_t;
+
+static ws_rx_stats_t rx_stats;
+
+static ws_session_t *ws_session_get(httpd_req_t *req)
+{
+    if (!req->sess_ctx) {
+        req->sess_ctx = calloc(1, sizeof(ws_session_t));
+        if (!req->sess_ctx)
+            return NULL;
+    }
+    return (ws_session_t *)req->sess_ctx;
+}
+
+static esp_err_t ws_send_text(httpd_req_t *req, const char *text)
+{
+    httpd_ws_frame_t out{};
+    out.type = HTTPD_WS_TYPE_TEXT;
+    out.payload = (uint8_t *)text;
+    out.len = strlen(text);
+    return httpd_ws_send_frame(req, &out);
+}
+
+/* =====================================================
+ *              BINARY CONTROL FRAMES
+ * ===================================================== */
+
+static esp_err_t ws_handle_binary(httpd_req_t *req, ws_session_t *sess,
+                                  httpd_ws_frame_t *frame, uint32_t t_recv)
+{
+    // Control frames come in two fixed sizes; anything else is a
+    // protocol error
+    if (frame->len != CTRL_FRAME_SIZE && frame->len != CTRL_WHEELS_FRAME_SIZE) {
+        rx_stats.bad_binary++;
+        EVLOG_W(EVT_WS_BAD_BINARY, frame->len);
+        return ESP_FAIL;
+    }
+
+    frame->payload = sess->rx;
+    if (httpd_ws_recv_frame(req, frame, CTRL_FRAME_MAX) != ESP_OK) {
+        rx_stats.truncated++;
+        return ESP_FAIL;
+    }
+
+    // Dropped, but the connection stays up: a client may race its first
+    // frames against the hello reply, or speak a newer version
+    if (sess->proto != WS_PROTO_BINARY) {
+        rx_stats.binary_in_json++;
+        return ESP_OK;
+    }
+
+    ctrl_frame_t cf;
+    if (!ctrl_decode_binary(sess->rx, frame->len, &cf)) {
+        rx_stats.bad_decode++;
+        return ESP_OK;
+    }
+
+    uint32_t t_parse = trace_now();
+    if (ctrl_dispatch_frame(&cf, &sess->seq))
+        trace_command(t_recv, t_parse, cf.seq);
+
     return ESP_OK;
 }
 
+/* =====================================================
+ *              JSON COMMANDS
+ * ===================================================== */
+
+// Fallback for frames the specialised parser does not handle. The tree
+// lives in the JSON arena and is dropped with it (no cJSON_Delete)
+static bool parse_cjson(const char *buf, ctrl_command_t *out)
+{
+    json_arena_begin();
+    cJSON *root = cJSON_Parse(buf);
+    if (!root) {
+        json_arena_end();
+        return false;
+    }
+
+    memset(out, 0, sizeof(*out));
+
+    cJSON *cmd = cJSON_GetObjectItem(root, "cmd");
+    if (cJSON_IsString(cmd))
+        out->cmd = ctrl_cmd_lookup(cmd->valuestring, strlen(cmd->valuestring));
+
+    const struct { const char *key; uint32_t field; double *dst; } nums[] = {
+        {"value", CTRL_FIELD_VALUE, &out->value},
+        {"angle", CTRL_FIELD_ANGLE, &out->angle},
+        {"speed", CTRL_FIELD_SPEED, &out->speed},
+        {"steer", CTRL_FIELD_STEER, &out->steer},
+        {"seq", CTRL_FIELD_SEQ, &out->seq},
+    };
+    for (const auto &n : nums) {
+        cJSON *item = cJSON_GetObjectItem(root, n.key);
+        if (cJSON_IsNumber(item)) {
+            *n.dst = item->valuedouble;
+            out->fields |= n.field;
+        }
+    }
+
+    const struct { const char *key; uint32_t field; char *dst; } strs[] = {
+        {"dir", CTRL_FIELD_DIR, out->dir},
+        {"proto", CTRL_FIELD_PROTO, out->proto},
+    };
+    for (const auto &n : strs) {
+        cJSON *item = cJSON_GetObjectItem(root, n.key);
+        if (cJSON_IsString(item) && strlen(item->valuestring) < CTRL_STR_MAX) {
+            strcpy(n.dst, item->valuestring);
+            out->fields |= n.field;
+        }
+    }
+
+    json_arena_end();
+    return true;
+}
+
+static void dispatch_command(httpd_req_t *req, ws_session_t *sess,
+                             const ctrl_command_t *c, uint32_t t_recv,
+                             uint32_t t_parse)
+{
+    if (c->cmd == CTRL_CMD_NONE)
+        return;
+
+    // Any well-formed command keeps the dead-man watchdog fed
+    failsafe_feed();
+
+    switch (c->cmd) {
+    case CTRL_CMD_SET:
+        if (c->fields & CTRL_FIELD_VALUE) {
+            set_speed(ctrl_number_to_int(c->value));
+            trace_command(t_recv, t_parse, 0);
+        }
+        break;
+
+    case CTRL_CMD_STEER:
+        if (c->fields & CTRL_FIELD_ANGLE) {
+            set_steer(ctrl_number_to_int(c->angle));
+            trace_command(t_recv, t_parse, 0);
+        }
+        break;
+
+    case CTRL_CMD_DRIVE: {
+        // {"cmd":"drive","speed":s,"steer":t,"seq":n}
+        const uint32_t need = CTRL_FIELD_SPEED | CTRL_FIELD_STEER | CTRL_FIELD_SEQ;
+        if ((c->fields & need) == need &&
+            set_drive_q15(q15_from_cmd(c->speed), q15_from_cmd(c->steer),
+                          (uint16_t)ctrl_number_to_int(c->seq), &sess->seq))
+            trace_command(t_recv, t_parse, (uint16_t)ctrl_number_to_int(c->seq));
+        break;
+    }
+
+    case CTRL_CMD_MOVE:
+        if ((c->fields & CTRL_FIELD_DIR) && !strcmp(c->dir, "stop")) {
+            stop_motors();
+            trace_command(t_recv, t_parse, 0);
+        }
+        break;
+
+    case CTRL_CMD_METRICS: {
+        // Telemetry snapshot of the latency histograms
+        char out[512];
+        format_latency_json(out, sizeof(out));
+        ws_send_text(req, out);
+        break;
+    }
+
+    case CTRL_CMD_HELLO:
+        // Protocol negotiation: {"cmd":"hello","proto":"bin"}
+        if ((c->fields & CTRL_FIELD_PROTO) && !strcmp(c->proto, "bin")) {
+            sess->proto = WS_PROTO_BINARY;
+            ws_send_text(req, "{\"cmd\":\"hello\",\"proto\":\"bin\",\"ver\":2}");
+        } else {
+            sess->proto = WS_PROTO_JSON;
+            ws_send_text(req, "{\"cmd\":\"hello\",\"proto\":\"json\"}");
+        }
+        break;
+
+    default:
+        // "ping" and unknown commands: heartbeat only
+        break;
+    }
+}
+
 /* =====================================================
  *              WEBSOCKET HANDLER
  * ===================================================== */
 
 static esp_err_t ws_handler(httpd_req_t *req)
 {
-    if (req->method == HTTP_GET && req->content_len == 0)
-        return ESP_OK;
+    if (req->method == HTTP_GET && req->content_len == 0) {
+        // Handshake: the session, its receive buffer and its drive
+        // sequence are allocated here, once; calloc starts it in JSON
+        // mode with no sequence number seen yet
+        return ws_session_get(req) ? ESP_OK : ESP_ERR_NO_MEM;
+    }
+
+    ws_session_t *sess = ws_session_get(req);
+    if (!sess)
+        return ESP_ERR_NO_MEM;
 
     httpd_ws_frame_t frame{};
     frame.type = HTTPD_WS_TYPE_TEXT;
@@ -52,69 +750,83 @@ static esp_err_t ws_handler(httpd_req_t *req)
     if (httpd_ws_recv_frame(req, &frame, 0) != ESP_OK)
         return ESP_FAIL;
 
+    uint32_t t_recv = trace_now();
+
     // Check for WebSocket close frame
     if (frame.type == HTTPD_WS_TYPE_CLOSE) {
-        ESP_LOGW(TAG, "WS close frame received - stopping motors");
+        EVLOG_W(EVT_WS_CLOSE, httpd_req_to_sockfd(req));
         stop_motors();
         return ESP_FAIL;
     }
 
-    uint8_t *buf = (uint8_t *)malloc(frame.len + 1);
-    frame.payload = buf;
-    httpd_ws_recv_frame(req, &frame, frame.len);
-    buf[frame.len] = 0;
-
-    cJSON *root = cJSON_Parse((char *)buf);
-    if (!root) {
-        free(buf);
-        return ESP_OK;
+    // Control messages are small; no client fragments them, and
+    // reassembly would need a second buffer per session
+    if (frame.fragmented) {
+        rx_stats.fragmented++;
+        EVLOG_W(EVT_WS_FRAGMENTED, frame.len);
+        return ESP_FAIL;
     }
 
-    cJSON *cmd = cJSON_GetObjectItem(root, "cmd");
-
-    if (cJSON_IsString(cmd)) {
-
-        if (!strcmp(cmd->valuestring, "set")) {
-            cJSON *v = cJSON_GetObjectItem(root, "value");
-            if (cJSON_IsNumber(v))
-                set_speed(v->valueint);
-        }
+    // Nothing larger than the session buffer is read, let alone allocated
+    if (frame.len > WS_MAX_FRAME_LEN) {
+        rx_stats.oversized++;
+        EVLOG_W(EVT_WS_OVERSIZED, frame.len);
+        return ESP_FAIL;
+    }
 
-        else if (!strcmp(cmd->valuestring, "steer")) {
-            cJSON *a = cJSON_GetObjectItem(root, "angle");
-            if (cJSON_IsNumber(a)) {
-                set_steer(a->valueint);
-            }
-        }
+    if (frame.type == HTTPD_WS_TYPE_BINARY)
+        return ws_handle_binary(req, sess, &frame, t_recv);
 
-        else if (!strcmp(cmd->valuestring, "move")) {
-            cJSON *d = cJSON_GetObjectItem(root, "dir");
-            if (cJSON_IsString(d) && !strcmp(d->valuestring, "stop"))
-                stop_motors();
-        }
+    frame.payload = sess->rx;
+    if (frame.len && httpd_ws_recv_frame(req, &frame, WS_MAX_FRAME_LEN) != ESP_OK) {
+        rx_stats.truncated++;
+        return ESP_FAIL;
     }
+    sess->rx[frame.len] = 0;
+
+    // Known command shapes are decoded in place; anything else goes
+    // through cJSON so unusual but valid JSON behaves as before
+    ctrl_command_t cmd;
+    if (ctrl_parse_json((const char *)sess->rx, frame.len, &cmd) ||
+        parse_cjson((const char *)sess->rx, &cmd))
+        dispatch_command(req, sess, &cmd, t_recv, trace_now());
 
-    cJSON_Delete(root);
-    free(buf);
     return ESP_OK;
 }
 
+void ws_get_rx_stats(ws_rx_stats_t *out)
+{
+    *out = rx_stats;
+}
+
 /* =====================================================
  *              HTTP SERVER
  * ===================================================== */
 
 void start_server(void)
 {
+    uint8_t r[(sizeof(open_ap_token) - 1) / 2];
+    esp_fill_random(r, sizeof(r));
+    for (size_t i = 0; i < sizeof(r); i++)
+        snprintf(open_ap_token + 2 * i, 3, "%02x", r[i]);
+    app_config_t app;
+    app_config_get(&app);
+    if (!app.password[0])
+        ESP_LOGI(TAG, "Open AP: POST /config needs X-Config-Token: %s", open_ap_token);
+
+    asset_cache_init(WEB_ROOT, ASSET_CACHE_MAX_BYTES);
+#if WEB_UI_EMBEDDED
+    asset_cache_add_static("/index.html.gz", index_html_gz_start,
+                           index_html_gz_end - index_html_gz_start);
+#endif
+    json_arena_init();
+
     httpd_handle_t server;
     httpd_config_t cfg = HTTPD_DEFAULT_CONFIG();
+    cfg.uri_match_fn = httpd_uri_match_wildcard;
     ESP_ERROR_CHECK(httpd_start(&server, &cfg));
 
-    httpd_uri_t root{};
-    root.uri = "/";
-    root.method = HTTP_GET;
-    root.handler = static_file_handler;
-    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &root));
-
+    // Handlers match in registration order; the file server catch-all is last
     httpd_uri_t ws{};
     ws.uri = "/ws";
     ws.method = HTTP_GET;
@@ -122,5 +834,38 @@ void start_server(void)
     ws.is_websocket = true;
     ESP_ERROR_CHECK(httpd_register_uri_handler(server, &ws));
 
+    httpd_uri_t metrics{};
+    metrics.uri = "/metrics";
+    metrics.method = HTTP_GET;
+    metrics.handler = metrics_handler;
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &metrics));
+
+    httpd_uri_t events{};
+    events.uri = "/log";
+    events.method = HTTP_GET;
+    events.handler = log_handler;
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &events));
+
+    httpd_uri_t config_get{};
+    config_get.uri = "/config";
+    config_get.method = HTTP_GET;
+    config_get.handler = config_get_handler;
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &config_get));
+
+    httpd_uri_t config_post{};
+    config_post.uri = "/config";
+    config_post.method = HTTP_POST;
+    config_post.handler = config_post_handler;
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &config_post));
+
+    httpd_uri_t files{};
+    files.uri = "/*";
+    files.method = HTTP_GET;
+    files.handler = static_file_handler;
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &files));
+
+    // Server -> client status stream on the same sockets
+    telemetry_start(server, TELEMETRY_RATE_HZ);
+
     ESP_LOGI(TAG, "HTTP server started");
 }
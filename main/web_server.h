@@ -1,14 +1,43 @@
 #pragma once
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * 1 when the build links a gzipped data/index.html into the app image
+ * (RC_EMBED_WEB_UI in main/CMakeLists.txt). The page is then served from
+ * flash without filesystem I/O, and LittleFS is only mounted when another
+ * asset is first requested.
+ */
+#ifndef WEB_UI_EMBEDDED
+#define WEB_UI_EMBEDDED 0
+#endif
+
+/** Largest WebSocket frame accepted; sizes the per-session receive buffer */
+#define WS_MAX_FRAME_LEN 256
+
+typedef struct {
+    uint32_t oversized;     // frames longer than WS_MAX_FRAME_LEN
+    uint32_t truncated;     // payload could not be read in full
+    uint32_t bad_binary;    // binary frames of neither control frame size
+    uint32_t fragmented;    // fragmented messages (not supported)
+    uint32_t binary_in_json;    // control frames before the switch to binary
+    uint32_t bad_decode;    // control frames of the right size that do not decode
+} ws_rx_stats_t;
+
 /**
  * @brief Start HTTP server with file serving and WebSocket support
  */
 void start_server(void);
 
+/**
+ * @brief Snapshot WebSocket receive reject counters
+ */
+void ws_get_rx_stats(ws_rx_stats_t *out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,13 +1,17 @@
 #include "wifi_config.h"
 #include "motor_control.h"
+#include "app_config.h"
 
 #include "esp_log.h"
 #include "esp_event.h"
+#include "esp_timer.h"
 #include "esp_netif.h"
 #include "esp_wifi.h"
 
 static const char *TAG = "wifi_config";
 
+static wifi_status_t status;
+
 /* =====================================================
  *              WiFi EVENT HANDLER
  * ===================================================== */
@@ -21,28 +25,126 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
     }
 }
 
+/* =====================================================
+ *              CHANNEL SCAN
+ * ===================================================== */
+
+// Runs in STA mode before the AP exists; leaves the radio stopped
+static uint8_t scan_for_channel(void)
+{
+    static wifi_ap_record_t records[WIFI_SCAN_MAX_APS];
+    static wifi_scan_entry_t entries[WIFI_SCAN_MAX_APS];
+
+    int64_t t0 = esp_timer_get_time();
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_start());
+
+    wifi_scan_config_t sc{};
+    sc.show_hidden = true;
+    sc.scan_type = WIFI_SCAN_TYPE_ACTIVE;
+    sc.scan_time.active.min = WIFI_SCAN_DWELL_MS / 2;
+    sc.scan_time.active.max = WIFI_SCAN_DWELL_MS;
+
+    uint16_t n = WIFI_SCAN_MAX_APS;
+    esp_err_t err = esp_wifi_scan_start(&sc, true);
+    if (err == ESP_OK)
+        err = esp_wifi_scan_get_ap_records(&n, records);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Channel scan failed: %s", esp_err_to_name(err));
+        n = 0;
+    }
+    ESP_ERROR_CHECK(esp_wifi_stop());
+
+    for (uint16_t i = 0; i < n; i++) {
+        entries[i].channel = records[i].primary;
+        entries[i].rssi = records[i].rssi;
+    }
+    uint8_t ch = wifi_profile_pick_channel(entries, n);
+
+    status.scan_aps = n;
+    status.scan_ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+    ESP_LOGI(TAG, "Scan: %u APs in %u ms, using channel %u",
+             (unsigned)n, (unsigned)status.scan_ms, ch);
+    return ch;
+}
+
+/* =====================================================
+ *              SOFT-AP
+ * ===================================================== */
+
 void wifi_init_softap(void)
 {
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
     esp_netif_create_default_wifi_ap();
 
+    app_config_t app;
+    app_config_get(&app);
+
+    wifi_profile_t &p = status.profile;
+    esp_err_t err = wifi_profile_load((wifi_profile_mode_t)app.wifi_profile, &p);
+    if (err != ESP_OK)
+        ESP_LOGW(TAG, "Wi-Fi profile partly from defaults: %s", esp_err_to_name(err));
+
+    // A-MPDU can only be chosen before the driver starts
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    cfg.ampdu_tx_enable = p.ampdu_tx;
+    cfg.ampdu_rx_enable = p.ampdu_rx;
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
 
+    status.channel = p.channel ? p.channel : scan_for_channel();
+
     wifi_config_t ap{};
-    strcpy((char *)ap.ap.ssid, "RC-ESP32");
-    ap.ap.authmode = WIFI_AUTH_OPEN;
-    ap.ap.password[0] = 0;
-    ap.ap.max_connection = 4;
+    // Full-length SSID (32) and PSK (64) fill the field without a NUL
+    ap.ap.ssid_len = (uint8_t)strlen(app.ssid);
+    memcpy(ap.ap.ssid, app.ssid, ap.ap.ssid_len);
+    memcpy(ap.ap.password, app.password, strlen(app.password));
+    ap.ap.authmode = app.password[0] ? WIFI_AUTH_WPA2_PSK : WIFI_AUTH_OPEN;
+    ap.ap.max_connection = app.max_connection;
+    ap.ap.channel = status.channel;
+    if (p.beacon_interval)
+        ap.ap.beacon_interval = p.beacon_interval;
+    if (p.dtim_period)
+        ap.ap.dtim_period = p.dtim_period;
 
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &ap));
+    if (p.bandwidth_mhz)
+        ESP_ERROR_CHECK(esp_wifi_set_bandwidth(WIFI_IF_AP, p.bandwidth_mhz == 40
+                                               ? WIFI_BW_HT40 : WIFI_BW_HT20));
     ESP_ERROR_CHECK(esp_wifi_start());
 
+    // Power save and TX power only stick once the driver is running
+    ESP_ERROR_CHECK(esp_wifi_set_ps(p.power_save ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE));
+    if (p.max_tx_power) {
+        err = esp_wifi_set_max_tx_power(p.max_tx_power);
+        if (err != ESP_OK)
+            ESP_LOGW(TAG, "TX power %d rejected: %s", p.max_tx_power, esp_err_to_name(err));
+    }
+
     // Register WiFi event handler for station disconnect
     ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_AP_STADISCONNECTED,
                                                &wifi_event_handler, NULL));
 
-    ESP_LOGI(TAG, "WiFi AP initialized - SSID: RC-ESP32");
+    ESP_LOGI(TAG, "WiFi AP initialized - SSID: %s, profile %s, channel %u",
+             app.ssid, wifi_profile_name(p.mode), status.channel);
+}
+
+void wifi_get_status(wifi_status_t *out)
+{
+    *out = status;
+}
+
+int8_t wifi_get_sta_rssi(void)
+{
+    wifi_sta_list_t list;
+    if (esp_wifi_ap_get_sta_list(&list) != ESP_OK)
+        return 0;
+
+    int8_t best = 0;
+    for (int i = 0; i < list.num; i++) {
+        if (best == 0 || list.sta[i].rssi > best)
+            best = list.sta[i].rssi;
+    }
+    return best;
 }
@@ -1,16 +1,48 @@
 #pragma once
 
+#include <stdint.h>
+
+#include "wifi_profile.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** Startup scan dwell per channel (active probe), ms */
+#define WIFI_SCAN_DWELL_MS 60
+/** Scan results kept for channel selection */
+#define WIFI_SCAN_MAX_APS 20
+
+typedef struct {
+    wifi_profile_t profile;     // selected profile with its NVS overrides
+    uint8_t channel;            // channel the AP actually runs on
+    uint16_t scan_aps;          // access points heard by the startup scan
+    uint32_t scan_ms;           // startup scan duration, 0 if not scanned
+} wifi_status_t;
+
 /**
  * @brief Initialize WiFi in AP (access point) mode
- * SSID: "RC-ESP32"
- * Security: Open (no password)
+ *
+ * SSID, password (WPA2, or open when empty) and the client limit come
+ * from app_config_get(); the default is the open network "RC-ESP32".
+ *
+ * Radio settings come from the profile selected by the "wifi_profile"
+ * config field, with the overrides stored in NVS (see wifi_profile.h).
+ * With channel 0 a short scan runs first to pick the quietest channel.
  */
 void wifi_init_softap(void);
 
+/**
+ * @brief Radio settings in effect since wifi_init_softap()
+ */
+void wifi_get_status(wifi_status_t *out);
+
+/**
+ * @brief Signal strength of the strongest associated station
+ * @return RSSI in dBm, 0 if no station is connected
+ */
+int8_t wifi_get_sta_rssi(void);
+
 #ifdef __cplusplus
 }
 #endif
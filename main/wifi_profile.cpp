@@ -0,0 +1,212 @@
+#include "wifi_profile.h"
+
+#include "nvs.h"
+
+/* =====================================================
+ *              BUILT-IN PROFILES
+ * =====================================================
+ *
+ * Low latency:
+ *  - modem power save off, so the radio never dozes between beacons
+ *  - channel picked by a startup scan instead of the crowded default 1
+ *  - 100 TU beacons with DTIM 1: every beacon is a DTIM, so a phone
+ *    in power save learns about buffered downlink frames within one
+ *    beacon (~102 ms). Shorter intervals cost airtime, and some phones
+ *    handle them badly
+ *  - no A-MPDU: control frames are tiny, and the receive reorder
+ *    buffer holds later frames back behind a lost one
+ *  - 20 MHz channel, which degrades less with neighbours nearby
+ *  - full TX power (20 dBm) to keep retransmissions down
+ */
+
+void wifi_profile_defaults(wifi_profile_mode_t mode, wifi_profile_t *out)
+{
+    *out = wifi_profile_t{};
+    out->mode = mode;
+
+    switch (mode) {
+    case WIFI_PROFILE_LOW_LATENCY:
+        out->channel = 0;
+        out->beacon_interval = 100;
+        out->dtim_period = 1;
+        out->max_tx_power = 80;
+        out->power_save = false;
+        out->ampdu_tx = false;
+        out->ampdu_rx = false;
+        out->bandwidth_mhz = 20;
+        break;
+
+    default:
+        out->mode = WIFI_PROFILE_DEFAULT;
+        out->channel = 1;
+        out->power_save = true;
+        out->ampdu_tx = true;
+        out->ampdu_rx = true;
+        break;
+    }
+}
+
+const char *wifi_profile_name(wifi_profile_mode_t mode)
+{
+    switch (mode) {
+    case WIFI_PROFILE_DEFAULT: return "default";
+    case WIFI_PROFILE_LOW_LATENCY: return "low_latency";
+    default: return "?";
+    }
+}
+
+/* =====================================================
+ *              CHANNEL SELECTION
+ * ===================================================== */
+
+// Neighbouring 20 MHz channels overlap up to four channels away
+#define CHANNEL_SPREAD 5
+
+// Signal above a -95 dBm noise floor, in dB
+static inline int ap_weight(int8_t rssi)
+{
+    return rssi > -95 ? rssi + 95 : 0;
+}
+
+static uint32_t channel_load(uint8_t channel, const wifi_scan_entry_t *aps, size_t n)
+{
+    uint32_t load = 0;
+    for (size_t i = 0; i < n; i++) {
+        int d = aps[i].channel > channel ? aps[i].channel - channel
+                                         : channel - aps[i].channel;
+        if (d < CHANNEL_SPREAD)
+            load += (uint32_t)(ap_weight(aps[i].rssi) * (CHANNEL_SPREAD - d));
+    }
+    return load;
+}
+
+uint8_t wifi_profile_pick_channel(const wifi_scan_entry_t *aps, size_t n)
+{
+    // Non-overlapping channels first, so they win ties
+    static const uint8_t order[] = {1, 6, 11, 2, 3, 4, 5, 7, 8, 9, 10};
+
+    uint8_t best = 0;
+    uint32_t best_load = 0;
+    for (uint8_t ch : order) {
+        if (ch < WIFI_CHANNEL_MIN || ch > WIFI_CHANNEL_MAX)
+            continue;
+        uint32_t load = channel_load(ch, aps, n);
+        if (!best || load < best_load) {
+            best = ch;
+            best_load = load;
+        }
+    }
+    return best ? best : 1;
+}
+
+/* =====================================================
+ *              NVS STORAGE
+ * ===================================================== */
+
+// Keeps the first real error; "not found" just means "use the default"
+static void note(esp_err_t *status, esp_err_t err)
+{
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND && *status == ESP_OK)
+        *status = err;
+}
+
+static void load_bool(nvs_handle_t h, const char *key, bool *v, esp_err_t *status)
+{
+    uint8_t u;
+    esp_err_t err = nvs_get_u8(h, key, &u);
+    if (err == ESP_OK)
+        *v = u != 0;
+    note(status, err);
+}
+
+// Stored values outside the field's range keep the profile default;
+// 0 always means "driver default" and is accepted
+static bool valid_or_zero(uint32_t v, uint32_t min, uint32_t max)
+{
+    return v == 0 || (v >= min && v <= max);
+}
+
+static void load_u8(nvs_handle_t h, const char *key, uint8_t *v,
+                    uint32_t min, uint32_t max, esp_err_t *status)
+{
+    uint8_t u;
+    esp_err_t err = nvs_get_u8(h, key, &u);
+    if (err == ESP_OK && !valid_or_zero(u, min, max))
+        err = ESP_ERR_INVALID_ARG;
+    if (err == ESP_OK)
+        *v = u;
+    note(status, err);
+}
+
+esp_err_t wifi_profile_load(wifi_profile_mode_t mode, wifi_profile_t *out)
+{
+    if ((unsigned)mode >= WIFI_PROFILE_COUNT)
+        mode = WIFI_PROFILE_DEFAULT_MODE;
+    wifi_profile_defaults(mode, out);
+
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(WIFI_PROFILE_NVS_NAMESPACE, NVS_READONLY, &h);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+        return ESP_OK;
+    if (err != ESP_OK)
+        return err;
+
+    esp_err_t status = ESP_OK;
+
+    load_u8(h, "channel", &out->channel, WIFI_CHANNEL_MIN, WIFI_CHANNEL_MAX, &status);
+    load_u8(h, "dtim", &out->dtim_period, 1, 10, &status);
+
+    uint16_t beacon;
+    err = nvs_get_u16(h, "beacon", &beacon);
+    if (err == ESP_OK && !valid_or_zero(beacon, 100, 60000))
+        err = ESP_ERR_INVALID_ARG;
+    if (err == ESP_OK)
+        out->beacon_interval = beacon;
+    note(&status, err);
+
+    int8_t tx_power;
+    err = nvs_get_i8(h, "tx_power", &tx_power);
+    if (err == ESP_OK && (tx_power < 0 || !valid_or_zero((uint32_t)tx_power, 8, 84)))
+        err = ESP_ERR_INVALID_ARG;
+    if (err == ESP_OK)
+        out->max_tx_power = tx_power;
+    note(&status, err);
+
+    load_bool(h, "power_save", &out->power_save, &status);
+    load_bool(h, "ampdu_tx", &out->ampdu_tx, &status);
+    load_bool(h, "ampdu_rx", &out->ampdu_rx, &status);
+
+    uint8_t bw;
+    err = nvs_get_u8(h, "bandwidth", &bw);
+    if (err == ESP_OK && bw != 0 && bw != 20 && bw != 40)
+        err = ESP_ERR_INVALID_ARG;
+    if (err == ESP_OK)
+        out->bandwidth_mhz = bw;
+    note(&status, err);
+
+    nvs_close(h);
+    return status;
+}
+
+esp_err_t wifi_profile_save(const wifi_profile_t *p)
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(WIFI_PROFILE_NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK)
+        return err;
+
+    esp_err_t status = ESP_OK;
+    note(&status, nvs_set_u8(h, "channel", p->channel));
+    note(&status, nvs_set_u16(h, "beacon", p->beacon_interval));
+    note(&status, nvs_set_u8(h, "dtim", p->dtim_period));
+    note(&status, nvs_set_i8(h, "tx_power", p->max_tx_power));
+    note(&status, nvs_set_u8(h, "power_save", p->power_save));
+    note(&status, nvs_set_u8(h, "ampdu_tx", p->ampdu_tx));
+    note(&status, nvs_set_u8(h, "ampdu_rx", p->ampdu_rx));
+    note(&status, nvs_set_u8(h, "bandwidth", p->bandwidth_mhz));
+    if (status == ESP_OK)
+        status = nvs_commit(h);
+
+    nvs_close(h);
+    return status;
+}
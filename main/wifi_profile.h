@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* =====================================================
+ *              SOFT-AP RADIO PROFILE
+ * =====================================================
+ *
+ * A profile is a set of radio parameters applied by wifi_init_softap().
+ * The profile is selected by the app_config field "wifi_profile"; any
+ * per-field overrides live in the "wifi" NVS namespace. Fields without a
+ * valid stored value come from the profile's defaults. This module only
+ * computes and stores settings and makes no Wi-Fi calls, so it runs
+ * unchanged on the host.
+ */
+
+typedef enum {
+    WIFI_PROFILE_DEFAULT = 0,       // driver defaults, as before profiles existed
+    WIFI_PROFILE_LOW_LATENCY,       // no power save, scanned channel, short beacons
+    WIFI_PROFILE_COUNT
+} wifi_profile_mode_t;
+
+/**
+ * Profile used when the configuration does not select one. Low latency
+ * is opt-in: its channel scan sits on the boot's critical path.
+ */
+#define WIFI_PROFILE_DEFAULT_MODE WIFI_PROFILE_DEFAULT
+
+#define WIFI_PROFILE_NVS_NAMESPACE "wifi"
+
+/** Channels considered by the startup scan (1 .. 11 is legal everywhere) */
+#define WIFI_CHANNEL_MIN 1
+#define WIFI_CHANNEL_MAX 11
+
+typedef struct {
+    wifi_profile_mode_t mode;
+    uint8_t channel;            // 0 = least congested channel from a startup scan
+    uint16_t beacon_interval;   // TU (1.024 ms), 0 = driver default
+    uint8_t dtim_period;        // beacons per DTIM, 0 = driver default
+    int8_t max_tx_power;        // 0.25 dBm units (8 .. 84), 0 = driver default
+    bool power_save;            // modem power save
+    bool ampdu_tx;              // A-MPDU aggregation on transmit
+    bool ampdu_rx;              // A-MPDU reordering on receive
+    uint8_t bandwidth_mhz;      // 20 or 40, 0 = driver default
+} wifi_profile_t;
+
+typedef struct {
+    uint8_t channel;
+    int8_t rssi;
+} wifi_scan_entry_t;
+
+/**
+ * @brief Fill out with the built-in settings of a profile
+ */
+void wifi_profile_defaults(wifi_profile_mode_t mode, wifi_profile_t *out);
+
+/**
+ * @brief Load a profile's defaults with the stored overrides applied
+ *
+ * Missing keys are not an error: with an empty namespace the result is
+ * wifi_profile_defaults(mode). A stored value outside its field's range
+ * (0 = driver default is always valid) keeps the default for that field:
+ *   channel 1 .. 11, beacon 100 .. 60000 TU, dtim 1 .. 10,
+ *   tx_power 8 .. 84, bandwidth 20 or 40
+ *
+ * @param mode Profile to start from (out of range = WIFI_PROFILE_DEFAULT_MODE)
+ * @param out Resulting settings
+ * @return ESP_OK, ESP_ERR_INVALID_ARG if a stored value was out of range,
+ *         or an NVS error other than "not found"
+ */
+esp_err_t wifi_profile_load(wifi_profile_mode_t mode, wifi_profile_t *out);
+
+/**
+ * @brief Store every field of p as an override, applied on next boot
+ *
+ * The mode is not stored; the "wifi_profile" config field selects it.
+ */
+esp_err_t wifi_profile_save(const wifi_profile_t *p);
+
+/**
+ * @brief Least congested channel in WIFI_CHANNEL_MIN .. WIFI_CHANNEL_MAX
+ *
+ * Every access point loads its own channel and, decreasingly, the four
+ * on either side (2.4 GHz channels overlap), weighted by signal
+ * strength. Ties go to 1, 6 and 11, then to the lower channel.
+ *
+ * @param aps Scan results
+ * @param n Number of entries in aps
+ * @return Channel number; 1 if nothing was heard
+ */
+uint8_t wifi_profile_pick_channel(const wifi_scan_entry_t *aps, size_t n);
+
+/**
+ * @brief Lowercase profile name ("default", "low_latency")
+ */
+const char *wifi_profile_name(wifi_profile_mode_t mode);
+
+#ifdef __cplusplus
+}
+#endif
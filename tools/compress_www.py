@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""
+Stage the web UI for the LittleFS image.
+
+Copies every file from the source directory into the output directory and,
+for compressible text assets, writes pre-compressed `.gz` (and `.br` when the
+`brotli` module is available) siblings. The firmware picks the best variant
+based on the request's Accept-Encoding header.
+
+With --gzip, only writes the gzip-compressed copy of a single file; the
+firmware build uses this for the copy of index.html linked into the app.
+
+Usage: compress_www.py <src_dir> <out_dir>
+       compress_www.py --gzip <src_file> <out_file>
+"""
+
+import gzip
+import os
+import shutil
+import sys
+
+try:
+    import brotli
+except ImportError:
+    brotli = None
+
+COMPRESSIBLE = ('.html', '.htm', '.css', '.js', '.json', '.svg', '.txt', '.ico')
+
+
+def write_if_smaller(path, data, original_size):
+    if len(data) < original_size:
+        with open(path, 'wb') as f:
+            f.write(data)
+
+
+def gzip_bytes(raw):
+    # mtime=0 keeps the output (and therefore the ETag) reproducible
+    return gzip.compress(raw, 9, mtime=0)
+
+
+def gzip_file(src, dst):
+    with open(src, 'rb') as f:
+        raw = f.read()
+    with open(dst, 'wb') as f:
+        f.write(gzip_bytes(raw))
+
+
+def stage(src_dir, out_dir):
+    if os.path.isdir(out_dir):
+        shutil.rmtree(out_dir)
+
+    for root, _, files in os.walk(src_dir):
+        rel = os.path.relpath(root, src_dir)
+        dst_root = os.path.normpath(os.path.join(out_dir, rel))
+        os.makedirs(dst_root, exist_ok=True)
+
+        for name in files:
+            src = os.path.join(root, name)
+            dst = os.path.join(dst_root, name)
+            shutil.copyfile(src, dst)
+
+            if not name.lower().endswith(COMPRESSIBLE):
+                continue
+
+            with open(src, 'rb') as f:
+                raw = f.read()
+
+            write_if_smaller(dst + '.gz', gzip_bytes(raw), len(raw))
+            if brotli is not None:
+                write_if_smaller(dst + '.br', brotli.compress(raw, quality=11), len(raw))
+
+
+if __name__ == '__main__':
+    if len(sys.argv) == 4 and sys.argv[1] == '--gzip':
+        gzip_file(sys.argv[2], sys.argv[3])
+    elif len(sys.argv) == 3:
+        stage(sys.argv[1], sys.argv[2])
+    else:
+        sys.exit(__doc__)
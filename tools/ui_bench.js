@@ -0,0 +1,301 @@
+#!/usr/bin/env node
+/*
+ * Headless benchmark of the web UI control sender.
+ *
+ * Runs the <script> of data/index.html unchanged in a Node vm against a
+ * minimal DOM stub (elements, listeners, localStorage), a fake WebSocket
+ * that records every frame, and a simulated clock that drives
+ * setTimeout/setInterval and 60 Hz requestAnimationFrame. No browser and
+ * no npm packages are needed; jsdom would only add layout the page does
+ * not use.
+ *
+ * A synthetic drag moves the steering joystick (touchmove at --touch-hz)
+ * while the speed slider fires input events (--slider-hz). The report
+ * compares the control frames the UI emits with the one-frame-per-event
+ * sender it replaced, whose rate equals the input event rate.
+ *
+ * Usage: ui_bench.js [--html data/index.html] [--duration 5]
+ *                    [--touch-hz 240] [--slider-hz 120] [--bin|--json]
+ *                    [--max-fps 61]
+ *
+ * --max-fps makes the run fail (exit 1) if control frames exceed the
+ * given rate, for use as a regression check.
+ */
+
+'use strict';
+
+const fs = require('fs');
+const path = require('path');
+const vm = require('vm');
+
+function parseArgs(argv) {
+  const args = {
+    html: path.join(__dirname, '..', 'data', 'index.html'),
+    duration: 5, touchHz: 240, sliderHz: 120, proto: 'bin', maxFps: 0,
+  };
+  for (let i = 2; i < argv.length; i++) {
+    const a = argv[i];
+    if (a === '--html') args.html = argv[++i];
+    else if (a === '--duration') args.duration = parseFloat(argv[++i]);
+    else if (a === '--touch-hz') args.touchHz = parseFloat(argv[++i]);
+    else if (a === '--slider-hz') args.sliderHz = parseFloat(argv[++i]);
+    else if (a === '--bin') args.proto = 'bin';
+    else if (a === '--json') args.proto = 'json';
+    else if (a === '--max-fps') args.maxFps = parseFloat(argv[++i]);
+    else {
+      console.error('unknown argument ' + a);
+      process.exit(2);
+    }
+  }
+  return args;
+}
+
+// ---------- Simulated clock ----------
+
+class Clock {
+  constructor() {
+    this.now = 0;
+    this.nextId = 1;
+    this.timers = new Map();   // id -> {at, fn, every}
+    this.frames = [];          // pending requestAnimationFrame callbacks
+    this.frameMs = 1000 / 60;
+  }
+
+  setTimeout(fn, ms) {
+    const id = this.nextId++;
+    this.timers.set(id, { at: this.now + Math.max(0, ms || 0), fn, every: 0 });
+    return id;
+  }
+
+  setInterval(fn, ms) {
+    const id = this.nextId++;
+    const every = Math.max(1, ms || 0);
+    this.timers.set(id, { at: this.now + every, fn, every });
+    return id;
+  }
+
+  clear(id) {
+    this.timers.delete(id);
+  }
+
+  requestAnimationFrame(fn) {
+    this.frames.push(fn);
+    return this.frames.length;
+  }
+
+  // Runs timers and animation frames in time order up to t
+  advanceTo(t) {
+    for (;;) {
+      let next = null;
+      let nextId = 0;
+      for (const [id, tm] of this.timers) {
+        if (!next || tm.at < next.at) {
+          next = tm;
+          nextId = id;
+        }
+      }
+      const vsync = (Math.floor(this.now / this.frameMs) + 1) * this.frameMs;
+      const frameDue = this.frames.length && vsync <= t;
+      if (frameDue && (!next || vsync <= next.at)) {
+        this.now = vsync;
+        const fns = this.frames;
+        this.frames = [];
+        fns.forEach(fn => fn(this.now));
+        continue;
+      }
+      if (!next || next.at > t)
+        break;
+      this.now = next.at;
+      if (next.every) next.at += next.every;
+      else this.timers.delete(nextId);
+      next.fn();
+    }
+    this.now = t;
+  }
+}
+
+// ---------- DOM stub ----------
+
+class Listeners {
+  constructor() { this.map = new Map(); }
+  addEventListener(type, fn) {
+    if (!this.map.has(type)) this.map.set(type, []);
+    this.map.get(type).push(fn);
+  }
+  removeEventListener(type, fn) {
+    const l = this.map.get(type);
+    if (l) this.map.set(type, l.filter(f => f !== fn));
+  }
+  dispatch(type, ev, self) {
+    ev.type = type;
+    ev.preventDefault = () => {};
+    ev.stopPropagation = () => {};
+    for (const fn of (this.map.get(type) || []).slice())
+      fn.call(self, ev);
+  }
+}
+
+class Element extends Listeners {
+  constructor(id) {
+    super();
+    this.id = id;
+    this.style = {};
+    this.textContent = '';
+    this.value = '0';
+    this.offsetLeft = 0;
+    this.offsetTop = 0;
+    this.classList = { add() {}, remove() {} };
+    // Joystick 200 px wide at x=100, slider 200 px tall at y=100
+    this.rect = { left: 100, top: 100, width: 200, height: 200 };
+  }
+  getBoundingClientRect() { return this.rect; }
+}
+
+function makeWindow(clock, sent) {
+  const elements = new Map();
+  const document = new Listeners();
+  document.getElementById = (id) => {
+    if (!elements.has(id)) elements.set(id, new Element(id));
+    return elements.get(id);
+  };
+
+  const window = new Listeners();
+  const store = new Map();
+
+  class FakeWebSocket {
+    constructor(url) {
+      this.url = url;
+      this.readyState = FakeWebSocket.CONNECTING;
+      clock.setTimeout(() => {
+        this.readyState = FakeWebSocket.OPEN;
+        this.onopen && this.onopen();
+      }, 1);
+    }
+    send(data) {
+      sent.push({ t: clock.now, data });
+      // Answer the protocol negotiation like the firmware does
+      if (typeof data === 'string' && JSON.parse(data).cmd === 'hello') {
+        const proto = this.wantProto;
+        clock.setTimeout(() => this.onmessage && this.onmessage({
+          data: JSON.stringify({ cmd: 'hello', proto }),
+        }), 1);
+      }
+    }
+    close() {}
+  }
+  FakeWebSocket.CONNECTING = 0;
+  FakeWebSocket.OPEN = 1;
+
+  const sandbox = {
+    document, window, WebSocket: FakeWebSocket,
+    location: { host: 'bench.local' },
+    localStorage: {
+      getItem: k => (store.has(k) ? store.get(k) : null),
+      setItem: (k, v) => store.set(k, String(v)),
+    },
+    performance: { now: () => clock.now },
+    setTimeout: (fn, ms) => clock.setTimeout(fn, ms),
+    setInterval: (fn, ms) => clock.setInterval(fn, ms),
+    clearTimeout: id => clock.clear(id),
+    clearInterval: id => clock.clear(id),
+    requestAnimationFrame: fn => clock.requestAnimationFrame(fn),
+    console: { log() {}, warn() {}, error() {} },
+    JSON, Math, Array, ArrayBuffer, DataView, parseInt, parseFloat,
+  };
+  return { sandbox, document, window, elements, FakeWebSocket };
+}
+
+// ---------- Benchmark ----------
+
+function isControlFrame(data) {
+  if (typeof data === 'string') {
+    const cmd = JSON.parse(data).cmd;
+    return cmd === 'drive' || cmd === 'set' || cmd === 'steer';
+  }
+  const v = new DataView(data);
+  return (v.getUint8(1) & 2) === 0;   // not CTRL_FLAG_HEARTBEAT
+}
+
+function run(args) {
+  const html = fs.readFileSync(args.html, 'utf8');
+  const m = html.match(/<script>([\s\S]*?)<\/script>/);
+  if (!m) throw new Error('no inline <script> in ' + args.html);
+
+  const clock = new Clock();
+  const sent = [];
+  const env = makeWindow(clock, sent);
+  env.FakeWebSocket.prototype.wantProto = args.proto;
+  vm.runInNewContext(m[1], env.sandbox, { filename: args.html });
+
+  env.window.dispatch('load', {}, env.window);
+  clock.advanceTo(100);   // connect and negotiate
+
+  const joystick = env.document.getElementById('steering-joystick');
+  const slider = env.document.getElementById('speed-slider');
+  const start = clock.now;
+  const end = start + args.duration * 1000;
+  let events = 0;
+
+  // Joystick: touch down, then a 1.3 Hz sweep with sub-pixel jitter
+  const touchAt = (t) => 200 + 80 * Math.sin(2 * Math.PI * 1.3 * (t - start) / 1000) +
+                         0.3 * Math.sin(t * 7.1);
+  joystick.dispatch('touchstart', {
+    touches: [{ identifier: 1, clientX: touchAt(start) }],
+    changedTouches: [{ identifier: 1, clientX: touchAt(start) }],
+  }, joystick);
+  events++;
+
+  const touchMs = 1000 / args.touchHz;
+  const sliderMs = 1000 / args.sliderHz;
+  let nextTouch = start + touchMs;
+  let nextSlider = start + sliderMs;
+
+  while (Math.min(nextTouch, nextSlider) < end) {
+    if (nextTouch <= nextSlider) {
+      clock.advanceTo(nextTouch);
+      env.document.dispatch('touchmove', {
+        touches: [{ identifier: 1, clientX: touchAt(nextTouch) }],
+      }, env.document);
+      nextTouch += touchMs;
+    } else {
+      clock.advanceTo(nextSlider);
+      // Ramp that holds each whole step for a while, like a thumb resting
+      const v = Math.round(8 * Math.sin(2 * Math.PI * 0.4 * (nextSlider - start) / 1000));
+      slider.value = String(v);
+      slider.dispatch('input', {}, slider);
+      nextSlider += sliderMs;
+    }
+    events++;
+  }
+  clock.advanceTo(end);
+
+  const during = sent.filter(f => f.t >= start && f.t <= end);
+  const control = during.filter(f => isControlFrame(f.data)).length;
+  const heartbeats = during.length - control;
+  const secs = args.duration;
+
+  return {
+    proto: args.proto,
+    duration_s: secs,
+    input_events: events,
+    input_events_per_s: +(events / secs).toFixed(1),
+    legacy_frames_per_s: +(events / secs).toFixed(1),
+    control_frames: control,
+    control_frames_per_s: +(control / secs).toFixed(1),
+    heartbeat_frames: heartbeats,
+    reduction: +(events / Math.max(1, control)).toFixed(1),
+    tx_rate_display: env.document.getElementById('tx-rate').textContent,
+  };
+}
+
+function main() {
+  const args = parseArgs(process.argv);
+  const result = run(args);
+  console.log(JSON.stringify(result, null, 2));
+  if (args.maxFps && result.control_frames_per_s > args.maxFps) {
+    console.error(`control frames ${result.control_frames_per_s}/s exceed ${args.maxFps}/s`);
+    process.exit(1);
+  }
+}
+
+main();
@@ -0,0 +1,565 @@
+#!/usr/bin/env python3
+"""
+WebSocket load generator and control latency benchmark.
+
+Opens N WebSocket clients against the firmware (normally the host
+simulator, see host/), streams joystick frames at a fixed rate in JSON or
+binary, and reports throughput, dropped frames and end-to-end latency from
+the moment a frame is sent to the moment the motor output changes.
+--proto udp sends the same binary frames as datagrams to the UDP control
+port instead.
+
+--loss P runs the uplink through an in-process lossy shim. A lost datagram
+is simply gone. A lost WebSocket frame is modelled the way TCP delivers it:
+it arrives one retransmission timeout (--rto-ms) late, and every frame
+written after it waits behind it (head-of-line blocking).
+
+Motor outputs are observed through the simulator's probe
+(RC_SIM_PROBE=127.0.0.1:<probe-port>), which timestamps every LEDC duty
+change and every command the control task applies on CLOCK_MONOTONIC -
+the same clock as time.monotonic_ns() here.
+
+Attribution: each "applied" probe event carries the sequence number of
+the command that reached the outputs (the latency trace's
+trace_applied()). Client i numbers its frames from i * SEQ_STRIDE, so a
+sequence number names one frame; the event is charged to the latest frame
+sent with it. Commands superseded within one control tick are never
+applied on their own and count as coalesced, not as misses. Applied
+events that match no frame are reported as unmatched_applied, and a
+match rate below --min-match prints a warning (or fails with --strict).
+
+Several clients at once used to share one sequence space in the
+firmware, so they rejected each other's frames as stale and most output
+changes could not be attributed. Sequence state is per session now; a
+low match rate points at a real problem again.
+
+Traces are synthetic (phase-shifted sine per client) or a CSV file with
+lines "t_ms,speed,steer" in UI units (-10 .. 10), looped.
+
+Usage: ws_bench.py [--sim build-host/rc_car_sim] [--clients 4] [--rate 100]
+                   [--duration 10] [--proto bin|json|udp] [--trace file.csv]
+                   [--loss 0.02] [--rto-ms 200] [--seed 1]
+                   [--min-match 0.9] [--strict] [--out result.json]
+"""
+
+import argparse
+import asyncio
+import base64
+import bisect
+import csv
+import json
+import math
+import os
+import random
+import re
+import struct
+import subprocess
+import sys
+import time
+import urllib.request
+
+Q15_ONE = 32767
+CTRL_PROTO_VERSION = 2
+CTRL_FLAG_STOP = 1 << 0
+
+# Sequence numbers per client before the next client's range starts
+SEQ_STRIDE = 16384
+
+# Applied commands further than this from their frame are not charged
+MATCH_WINDOW_NS = 250_000_000
+
+
+# =====================================================
+#               MINIMAL WEBSOCKET CLIENT
+# =====================================================
+
+class WsClient:
+    def __init__(self, reader, writer):
+        self.reader = reader
+        self.writer = writer
+
+    @classmethod
+    async def connect(cls, host, port, path):
+        reader, writer = await asyncio.open_connection(host, port)
+        key = base64.b64encode(os.urandom(16)).decode()
+        writer.write((f'GET {path} HTTP/1.1\r\nHost: {host}:{port}\r\n'
+                      'Upgrade: websocket\r\nConnection: Upgrade\r\n'
+                      f'Sec-WebSocket-Key: {key}\r\n'
+                      'Sec-WebSocket-Version: 13\r\n\r\n').encode())
+        head = await reader.readuntil(b'\r\n\r\n')
+        if b' 101 ' not in head.split(b'\r\n', 1)[0]:
+            writer.close()
+            raise ConnectionError(head.split(b'\r\n', 1)[0].decode(errors='replace'))
+        return cls(reader, writer)
+
+    def send(self, opcode, payload):
+        mask = os.urandom(4)
+        n = len(payload)
+        if n < 126:
+            hdr = struct.pack('!BB', 0x80 | opcode, 0x80 | n)
+        else:
+            hdr = struct.pack('!BBH', 0x80 | opcode, 0x80 | 126, n)
+        masked = bytes(b ^ mask[i & 3] for i, b in enumerate(payload))
+        self.writer.write(hdr + mask + masked)
+
+    async def recv(self):
+        b0, b1 = await self.reader.readexactly(2)
+        n = b1 & 0x7f
+        if n == 126:
+            n = struct.unpack('!H', await self.reader.readexactly(2))[0]
+        elif n == 127:
+            n = struct.unpack('!Q', await self.reader.readexactly(8))[0]
+        return b0 & 0x0f, await self.reader.readexactly(n)
+
+    async def close(self):
+        try:
+            self.send(0x8, struct.pack('!H', 1000))
+            await self.writer.drain()
+            self.writer.close()
+        except (ConnectionError, OSError):
+            pass
+
+
+class UdpClient:
+    """Datagram transport with the same send() shape as WsClient"""
+
+    def __init__(self, transport):
+        self.transport = transport
+
+    @classmethod
+    async def connect(cls, host, port):
+        transport, _ = await asyncio.get_running_loop().create_datagram_endpoint(
+            asyncio.DatagramProtocol, remote_addr=(host, port))
+        return cls(transport)
+
+    def send(self, opcode, payload):
+        self.transport.sendto(payload)
+
+    async def close(self):
+        self.transport.close()
+
+
+class LossyLink:
+    """In-process lossy uplink in front of a WsClient or UdpClient"""
+
+    def __init__(self, inner, loss, rto_s, rng, stream):
+        self.inner = inner
+        self.loss = loss
+        self.rto_s = rto_s
+        self.rng = rng
+        self.stream = stream
+        self.held = []      # frames queued behind a lost stream segment
+        self.lost = 0
+
+    def send(self, opcode, payload):
+        if self.held:
+            self.held.append((opcode, payload))
+            return
+        if self.rng.random() >= self.loss:
+            self.inner.send(opcode, payload)
+            return
+        self.lost += 1
+        if self.stream:
+            self.held.append((opcode, payload))
+            asyncio.get_running_loop().call_later(self.rto_s, self.release)
+
+    def release(self):
+        held, self.held = self.held, []
+        for opcode, payload in held:
+            self.inner.send(opcode, payload)
+
+
+class Controller:
+    """One joystick client speaking the firmware's control protocol"""
+
+    def __init__(self, conn, proto, seq_base):
+        self.conn = conn
+        self.link = conn
+        self.proto = proto
+        self.seq = seq_base
+
+    @classmethod
+    async def open(cls, args, index):
+        seq_base = index * SEQ_STRIDE
+        if args.proto == 'udp':
+            return cls(await UdpClient.connect(args.host, args.udp_port), args.proto,
+                       seq_base)
+
+        ws = await WsClient.connect(args.host, args.port, '/ws')
+        ctl = cls(ws, args.proto, seq_base)
+        if args.proto == 'bin':
+            ws.send(0x1, b'{"cmd":"hello","proto":"bin"}')
+            while True:
+                op, data = await ws.recv()
+                if op == 0x1 and b'"hello"' in data:
+                    break
+        return ctl
+
+    def make_lossy(self, args, rng):
+        self.link = LossyLink(self.conn, args.loss, args.rto_ms / 1000, rng,
+                              stream=self.proto != 'udp')
+
+    def drive(self, speed_q15, steer_q15, flags=0):
+        # 0 is what the firmware traces for commands without a sequence
+        self.seq = (self.seq + 1) & 0xffff or 1
+        if self.proto in ('bin', 'udp'):
+            self.link.send(0x2, struct.pack('<BBhhH', CTRL_PROTO_VERSION, flags,
+                                            speed_q15, steer_q15, self.seq))
+        elif flags & CTRL_FLAG_STOP:
+            self.link.send(0x1, b'{"cmd":"move","dir":"stop"}')
+        else:
+            # 6 decimals survive q15_from_cmd() without changing the value
+            msg = '{"cmd":"drive","speed":%.6f,"steer":%.6f,"seq":%d}' % (
+                speed_q15 * 10 / Q15_ONE, steer_q15 * 10 / Q15_ONE, self.seq)
+            self.link.send(0x1, msg.encode())
+
+    async def flush(self):
+        if isinstance(self.conn, WsClient):
+            await self.conn.writer.drain()
+
+    async def close(self):
+        await self.conn.close()
+
+    async def drain(self):
+        # Telemetry and replies; datagram controllers get nothing back
+        if not isinstance(self.conn, WsClient):
+            return
+        try:
+            while True:
+                await self.conn.recv()
+        except (asyncio.IncompleteReadError, ConnectionError, OSError):
+            pass
+
+
+# =====================================================
+#               OUTPUT PROBE
+# =====================================================
+
+class Probe(asyncio.DatagramProtocol):
+    def __init__(self):
+        self.events = []    # (t_ns, channel, duty)
+        self.applied = []   # (t_ns, seq, firmware total_us)
+
+    def datagram_received(self, data, addr):
+        for line in data.decode(errors='replace').splitlines():
+            parts = line.split()
+            if len(parts) == 5 and parts[0] == 'ledc':
+                self.events.append((int(parts[1]), int(parts[2]), int(parts[3])))
+            elif len(parts) == 4 and parts[0] == 'applied':
+                self.applied.append((int(parts[1]), int(parts[2]), int(parts[3])))
+
+    def clear(self):
+        self.events.clear()
+        self.applied.clear()
+
+
+# =====================================================
+#               TRACES
+# =====================================================
+
+def to_q15(v):
+    """UI fraction (-1 .. 1) -> Q15, clamped"""
+    return round(max(-1.0, min(1.0, v)) * Q15_ONE)
+
+
+def synthetic_trace(client):
+    phase = client * math.pi / 2
+
+    def sample(t):
+        speed = 0.6 + 0.35 * math.sin(2 * math.pi * 0.5 * t + phase)
+        steer = 0.5 * math.sin(2 * math.pi * 0.2 * t + phase)
+        return speed, steer
+    return sample
+
+
+def csv_trace(path):
+    rows = []
+    with open(path, newline='') as f:
+        for row in csv.reader(f):
+            if not row or row[0].lstrip().startswith('#'):
+                continue
+            try:
+                rows.append((float(row[0]) / 1000, float(row[1]) / 10, float(row[2]) / 10))
+            except (ValueError, IndexError):
+                continue
+    if not rows:
+        sys.exit(f'{path}: no samples')
+    times = [r[0] for r in rows]
+    period = times[-1] + (times[-1] - times[-2] if len(times) > 1 else 1.0)
+
+    def sample(t):
+        i = max(0, bisect.bisect_right(times, t % period) - 1)
+        return rows[i][1], rows[i][2]
+    return sample
+
+
+# =====================================================
+#               METRICS SCRAPE
+# =====================================================
+
+def scrape_metrics(args):
+    url = f'http://{args.host}:{args.port}/metrics'
+    with urllib.request.urlopen(url, timeout=5) as resp:
+        text = resp.read().decode()
+
+    out = {}
+    for m in re.finditer(r'^(\w+)(?:\{([^}]*)\})? (\S+)$', text, re.M):
+        labels = dict(re.findall(r'(\w+)="([^"]*)"', m.group(2) or ''))
+        key = (m.group(1), tuple(sorted(labels.items())))
+        out[key] = float(m.group(3))
+    return out
+
+
+def accepted_count(metrics):
+    return int(metrics.get(('rc_cmd_latency_us_count', (('stage', 'dispatch'),)), 0))
+
+
+def metric(metrics, name):
+    return int(metrics.get((name, ()), 0))
+
+
+def heap_and_allocs(before, after):
+    """Heap state around the run and control-path allocations during it"""
+    delta = {key: metric(after, name) - metric(before, name) for key, name in (
+        ('json_frames', 'rc_json_frames'),
+        ('arena_allocs', 'rc_json_arena_allocs'),
+        ('heap_allocs', 'rc_json_heap_fallbacks'),
+        ('arena_exhausted', 'rc_json_arena_exhausted'))}
+    delta['arena_peak_bytes'] = metric(after, 'rc_json_arena_peak_bytes')
+    heap = {}
+    for label, m in (('before', before), ('after', after)):
+        free = metric(m, 'rc_heap_free_bytes')
+        largest = metric(m, 'rc_heap_largest_free_block')
+        heap[label] = {
+            'free': free,
+            'largest_free_block': largest,
+            # 0 = one contiguous block, towards 1 = badly fragmented
+            'fragmentation': round(1 - largest / free, 3) if free else None,
+        }
+    return delta, heap
+
+
+def firmware_latency(metrics):
+    stages = {}
+    for (name, labels), value in metrics.items():
+        labels = dict(labels)
+        stage = labels.get('stage')
+        if not stage:
+            continue
+        s = stages.setdefault(stage, {})
+        if name == 'rc_cmd_latency_us':
+            s['p' + labels['quantile'][2:].ljust(2, '0')] = int(value)
+        elif name == 'rc_cmd_latency_us_max':
+            s['max'] = int(value)
+    return stages
+
+
+# =====================================================
+#               BENCHMARK PHASES
+# =====================================================
+
+async def run_client(args, index, start, frames, stats):
+    sample = csv_trace(args.trace) if args.trace else synthetic_trace(index)
+    st = stats[index]
+    try:
+        ctl = await Controller.open(args, index)
+    except (ConnectionError, OSError, asyncio.IncompleteReadError) as e:
+        st['error'] = str(e)
+        return
+    if args.loss:
+        ctl.make_lossy(args, random.Random(args.seed + index))
+    drain = asyncio.ensure_future(ctl.drain())
+
+    period = 1.0 / args.rate
+    count = int(args.duration * args.rate)
+    loop = asyncio.get_running_loop()
+    try:
+        for i in range(count):
+            due = start + i * period
+            delay = due - loop.time()
+            if delay > 0:
+                await asyncio.sleep(delay)
+            elif delay < -period:
+                st['late'] += 1
+
+            speed, steer = sample(i * period)
+
+            t = time.monotonic_ns()
+            ctl.drive(to_q15(speed), to_q15(steer))
+            await ctl.flush()
+            frames.append((t, ctl.seq))
+            st['sent'] += 1
+    except (ConnectionError, OSError) as e:
+        st['error'] = str(e)
+    finally:
+        drain.cancel()
+        if isinstance(ctl.link, LossyLink):
+            st['lost'] = ctl.link.lost
+        await ctl.close()
+
+
+def attribute(frames, applied, t_end):
+    """Charge each applied command to the frame that carried its sequence"""
+    by_seq = {}
+    for t, seq in sorted(frames):
+        by_seq.setdefault(seq, []).append(t)
+
+    latencies = []
+    matched = set()
+    unmatched = 0
+    for t, seq, _ in applied:
+        if t > t_end:
+            continue
+        sent = by_seq.get(seq, [])
+        j = bisect.bisect_right(sent, t) - 1
+        if j < 0 or t - sent[j] > MATCH_WINDOW_NS or (seq, j) in matched:
+            unmatched += 1
+            continue
+        matched.add((seq, j))
+        latencies.append((t - sent[j]) / 1000)
+    return latencies, unmatched
+
+
+def percentiles(values):
+    if not values:
+        return None
+    v = sorted(values)
+
+    def q(p):
+        return round(v[min(len(v) - 1, max(0, math.ceil(p * len(v)) - 1))], 1)
+    return {'count': len(v), 'min': round(v[0], 1), 'p50': q(0.5), 'p90': q(0.9),
+            'p99': q(0.99), 'p999': q(0.999), 'max': round(v[-1], 1)}
+
+
+async def bench(args):
+    loop = asyncio.get_running_loop()
+    transport, probe = await loop.create_datagram_endpoint(
+        Probe, local_addr=('127.0.0.1', args.probe_port))
+
+    await asyncio.sleep(0.3)
+
+    before = scrape_metrics(args)
+    probe.clear()
+
+    frames = []
+    stats = [{'sent': 0, 'late': 0} for _ in range(args.clients)]
+    start = loop.time() + 0.2
+    t0 = time.monotonic_ns()
+    await asyncio.gather(*(run_client(args, i, start, frames, stats)
+                           for i in range(args.clients)))
+    elapsed = (time.monotonic_ns() - t0) / 1e9
+    await asyncio.sleep(0.2)
+    t_end = time.monotonic_ns()
+
+    after = scrape_metrics(args)
+    transport.close()
+
+    sent = sum(s['sent'] for s in stats)
+    accepted = accepted_count(after) - accepted_count(before)
+    applied = [a for a in probe.applied if a[0] <= t_end]
+    latencies, unmatched = attribute(frames, applied, t_end)
+    allocs, heap = heap_and_allocs(before, after)
+    match_rate = round(len(latencies) / len(applied), 3) if applied else None
+
+    return {
+        'config': {
+            'clients': args.clients, 'rate_hz': args.rate, 'duration_s': args.duration,
+            'proto': args.proto, 'trace': args.trace or 'synthetic',
+            'loss': args.loss, 'rto_ms': args.rto_ms if args.loss else None,
+        },
+        'sent': sent,
+        'accepted': accepted,
+        'dropped': max(0, sent - accepted),
+        'throughput_hz': round(sent / elapsed, 1) if elapsed else 0,
+        'accepted_hz': round(accepted / elapsed, 1) if elapsed else 0,
+        'output_events': len(probe.events),
+        'applied': len(applied),
+        'coalesced': max(0, accepted - len(applied)),
+        'unmatched_applied': unmatched,
+        'match_rate': match_rate,
+        'e2e_latency_us': percentiles(latencies),
+        'firmware_latency_us': firmware_latency(after),
+        'json_allocations': allocs,
+        'heap': heap,
+        'clients': stats,
+    }
+
+
+# =====================================================
+#               ENTRY POINT
+# =====================================================
+
+def wait_for_port(host, port, proc, timeout=5.0):
+    import socket
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        if proc and proc.poll() is not None:
+            sys.exit('simulator exited during startup')
+        try:
+            socket.create_connection((host, port), timeout=0.2).close()
+            return
+        except OSError:
+            time.sleep(0.05)
+    sys.exit(f'nothing listening on {host}:{port}')
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    ap.add_argument('--host', default='127.0.0.1')
+    ap.add_argument('--port', type=int, default=8080)
+    ap.add_argument('--udp-port', type=int, default=4210, help='firmware UDP control port')
+    ap.add_argument('--probe-port', type=int, default=9999)
+    ap.add_argument('--sim', help='start this simulator binary with the probe enabled')
+    ap.add_argument('--clients', type=int, default=4)
+    ap.add_argument('--rate', type=float, default=100, help='frames per second per client')
+    ap.add_argument('--duration', type=float, default=10, help='seconds')
+    ap.add_argument('--proto', choices=('bin', 'json', 'udp'), default='bin')
+    ap.add_argument('--trace', help='CSV joystick trace: t_ms,speed,steer')
+    ap.add_argument('--loss', type=float, default=0.0,
+                    help='uplink frame loss probability (in-process shim)')
+    ap.add_argument('--rto-ms', type=float, default=200,
+                    help='TCP retransmission delay modelled for lost WS frames')
+    ap.add_argument('--seed', type=int, default=1, help='loss shim random seed')
+    ap.add_argument('--min-match', type=float, default=0.9,
+                    help='warn when fewer applied commands than this match a frame')
+    ap.add_argument('--strict', action='store_true',
+                    help='exit 1 instead of warning on a low match rate')
+    ap.add_argument('--out', help='write the JSON result here instead of stdout')
+    args = ap.parse_args()
+
+    proc = None
+    if args.sim:
+        env = dict(os.environ,
+                   RC_SIM_PORT=str(args.port),
+                   RC_SIM_PROBE=f'127.0.0.1:{args.probe_port}',
+                   RC_SIM_LOG_LEVEL=os.environ.get('RC_SIM_LOG_LEVEL', '2'))
+        proc = subprocess.Popen([args.sim], env=env)
+    try:
+        wait_for_port(args.host, args.port, proc)
+        result = asyncio.run(bench(args))
+    finally:
+        if proc:
+            proc.terminate()
+            proc.wait()
+
+    text = json.dumps(result, indent=2)
+    if args.out:
+        with open(args.out, 'w') as f:
+            f.write(text + '\n')
+    else:
+        print(text)
+
+    rate = result['match_rate']
+    if rate is None:
+        print('warning: no applied-command probe events; is RC_SIM_PROBE set?',
+              file=sys.stderr)
+    elif rate < args.min_match:
+        print(f'warning: only {rate:.1%} of applied commands matched a sent frame '
+              f'(--min-match {args.min_match:.0%}); latencies are not representative',
+              file=sys.stderr)
+    if args.strict and (rate is None or rate < args.min_match):
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()